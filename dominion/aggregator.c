@@ -0,0 +1,417 @@
+#include "aggregator.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define AGGREGATOR_MAGIC "DOMAGGR"
+
+static const double gamma_ = (1 + SKETCH_ACCURACY) / (1 - SKETCH_ACCURACY);
+
+static void initMetric(struct metric *m, double lo, double width) {
+  memset(m, 0, sizeof(struct metric));
+  m->histogram.lo = lo;
+  m->histogram.width = width;
+}
+
+void initAggregator(struct aggregator *agg) {
+  memset(agg, 0, sizeof(struct aggregator));
+  //a score of -10 to 117 and up to 127 turns get their own bucket
+  initMetric(&agg->score, -10, 2);
+  initMetric(&agg->turns, 0, 2);
+}
+
+static int sketchBucket(double x) {
+  int i = (int)ceil(log(x) / log(gamma_));
+  if (i < 0)
+    i = 0;
+  return i < SKETCH_BUCKETS ? i : SKETCH_BUCKETS - 1;
+}
+
+/* Midpoint, in relative terms, of bucket i */
+static double sketchValue(int i) {
+  return 2 * pow(gamma_, i) / (gamma_ + 1);
+}
+
+void addSample(struct metric *m, long x) {
+  struct moments *s = &m->moments;
+  struct histogram *h = &m->histogram;
+  long b;
+
+  s->n++;
+  s->sum += x;
+  s->sumSquares += x * x;
+  if (s->n == 1 || x < s->min)
+    s->min = x;
+  if (s->n == 1 || x > s->max)
+    s->max = x;
+
+  if (x < h->lo)
+    h->below++;
+  else
+    {
+      b = (long)((x - h->lo) / h->width);
+      if (b >= HISTOGRAM_BUCKETS)
+	h->above++;
+      else
+	h->counts[b]++;
+    }
+
+  if (x == 0)
+    m->sketch.zeros++;
+  else if (x > 0)
+    m->sketch.positive[sketchBucket(x)]++;
+  else
+    m->sketch.negative[sketchBucket(-x)]++;
+}
+
+void aggregateGame(struct aggregator *agg, const int strategyIds[],
+		   const struct gameResult *result) {
+  int shared = 0;
+  int p;
+
+  agg->games++;
+  if (!result->finished)
+    agg->unfinished++;
+  for (p = 0; p < result->numPlayers; p++)
+    shared += result->winners[p];
+
+  for (p = 0; p < result->numPlayers; p++)
+    {
+      agg->seats[strategyIds[p]]++;
+      if (result->winners[p])
+	{
+	  if (shared > 1)
+	    agg->ties[strategyIds[p]]++;
+	  else
+	    agg->wins[strategyIds[p]]++;
+	}
+      addSample(&agg->score, result->scores[p]);
+    }
+  addSample(&agg->turns, result->turns);
+}
+
+static void mergeMoments(struct moments *into, const struct moments *from) {
+  if (from->n == 0)
+    return;
+  if (into->n == 0)
+    {
+      *into = *from;
+      return;
+    }
+  into->n += from->n;
+  into->sum += from->sum;
+  into->sumSquares += from->sumSquares;
+  if (from->min < into->min)
+    into->min = from->min;
+  if (from->max > into->max)
+    into->max = from->max;
+}
+
+static int mergeMetric(struct metric *into, const struct metric *from) {
+  int i;
+
+  if (into->histogram.lo != from->histogram.lo
+      || into->histogram.width != from->histogram.width)
+    return -1;
+  mergeMoments(&into->moments, &from->moments);
+  into->histogram.below += from->histogram.below;
+  into->histogram.above += from->histogram.above;
+  for (i = 0; i < HISTOGRAM_BUCKETS; i++)
+    into->histogram.counts[i] += from->histogram.counts[i];
+  into->sketch.zeros += from->sketch.zeros;
+  for (i = 0; i < SKETCH_BUCKETS; i++)
+    {
+      into->sketch.positive[i] += from->sketch.positive[i];
+      into->sketch.negative[i] += from->sketch.negative[i];
+    }
+  return 0;
+}
+
+int mergeAggregator(struct aggregator *into, const struct aggregator *from) {
+  int i;
+
+  if (into->score.histogram.lo != from->score.histogram.lo
+      || into->score.histogram.width != from->score.histogram.width
+      || into->turns.histogram.lo != from->turns.histogram.lo
+      || into->turns.histogram.width != from->turns.histogram.width)
+    return -1;
+  into->games += from->games;
+  into->unfinished += from->unfinished;
+  for (i = 0; i < MAX_STRATEGIES; i++)
+    {
+      into->seats[i] += from->seats[i];
+      into->wins[i] += from->wins[i];
+      into->ties[i] += from->ties[i];
+    }
+  mergeMetric(&into->score, &from->score);
+  mergeMetric(&into->turns, &from->turns);
+  return 0;
+}
+
+double metricMean(const struct metric *m) {
+  if (m->moments.n == 0)
+    return 0;
+  return (double)m->moments.sum / m->moments.n;
+}
+
+double metricVariance(const struct metric *m) {
+  const struct moments *s = &m->moments;
+  long double mean;
+
+  if (s->n < 2)
+    return 0;
+  mean = (long double)s->sum / s->n;
+  return (double)(((long double)s->sumSquares - mean * s->sum) / (s->n - 1));
+}
+
+double metricQuantile(const struct metric *m, double q) {
+  const struct quantileSketch *s = &m->sketch;
+  long n = m->moments.n;
+  long rank;
+  long seen = 0;
+  int i;
+
+  if (n == 0)
+    return 0;
+  if (q <= 0)
+    return m->moments.min;
+  if (q >= 1)
+    return m->moments.max;
+  rank = (long)(q * (n - 1));
+
+  //most negative first
+  for (i = SKETCH_BUCKETS - 1; i >= 0; i--)
+    {
+      seen += s->negative[i];
+      if (seen > rank)
+	return -sketchValue(i);
+    }
+  seen += s->zeros;
+  if (seen > rank)
+    return 0;
+  for (i = 0; i < SKETCH_BUCKETS; i++)
+    {
+      seen += s->positive[i];
+      if (seen > rank)
+	return sketchValue(i);
+    }
+  return m->moments.max;
+}
+
+/* Serialization */
+/* --------------------------------------------------------------- */
+
+/* Walks every field in a fixed order, either writing them to p, reading
+   them from p, or, with p NULL, only counting bytes */
+struct cursor {
+  unsigned char *p;
+  int loading;
+  size_t bytes;
+};
+
+static void transferWord(struct cursor *c, uint64_t *u) {
+  int i;
+
+  if (c->p != NULL)
+    {
+      if (c->loading)
+	{
+	  *u = 0;
+	  for (i = 0; i < 8; i++)
+	    *u |= (uint64_t)c->p[i] << (8 * i);
+	}
+      else
+	{
+	  for (i = 0; i < 8; i++)
+	    c->p[i] = (unsigned char)(*u >> (8 * i));
+	}
+      c->p += 8;
+    }
+  c->bytes += 8;
+}
+
+static void transferLongs(struct cursor *c, long *v, int n) {
+  uint64_t u;
+  int i;
+
+  for (i = 0; i < n; i++)
+    {
+      u = (uint64_t)v[i];
+      transferWord(c, &u);
+      v[i] = (long)u;
+    }
+}
+
+static void transferDouble(struct cursor *c, double *d) {
+  uint64_t u;
+
+  memcpy(&u, d, sizeof(u));
+  transferWord(c, &u);
+  memcpy(d, &u, sizeof(u));
+}
+
+static void transferMetric(struct cursor *c, struct metric *m) {
+  transferLongs(c, &m->moments.n, 1);
+  transferLongs(c, &m->moments.sum, 1);
+  transferLongs(c, &m->moments.sumSquares, 1);
+  transferLongs(c, &m->moments.min, 1);
+  transferLongs(c, &m->moments.max, 1);
+  transferDouble(c, &m->histogram.lo);
+  transferDouble(c, &m->histogram.width);
+  transferLongs(c, &m->histogram.below, 1);
+  transferLongs(c, &m->histogram.above, 1);
+  transferLongs(c, m->histogram.counts, HISTOGRAM_BUCKETS);
+  transferLongs(c, &m->sketch.zeros, 1);
+  transferLongs(c, m->sketch.positive, SKETCH_BUCKETS);
+  transferLongs(c, m->sketch.negative, SKETCH_BUCKETS);
+}
+
+static void transferAggregator(struct cursor *c, struct aggregator *agg) {
+  long header[4] = {AGGREGATOR_VERSION, MAX_STRATEGIES, HISTOGRAM_BUCKETS,
+		    SKETCH_BUCKETS};
+
+  if (c->p != NULL)
+    {
+      if (!c->loading)
+	memcpy(c->p, AGGREGATOR_MAGIC, sizeof(AGGREGATOR_MAGIC));
+      c->p += sizeof(AGGREGATOR_MAGIC);
+    }
+  c->bytes += sizeof(AGGREGATOR_MAGIC);
+  transferLongs(c, header, 4);
+  transferLongs(c, &agg->games, 1);
+  transferLongs(c, &agg->unfinished, 1);
+  transferLongs(c, agg->seats, MAX_STRATEGIES);
+  transferLongs(c, agg->wins, MAX_STRATEGIES);
+  transferLongs(c, agg->ties, MAX_STRATEGIES);
+  transferMetric(c, &agg->score);
+  transferMetric(c, &agg->turns);
+}
+
+size_t aggregatorSize(void) {
+  struct cursor c = {NULL, 0, 0};
+  struct aggregator agg;
+
+  transferAggregator(&c, &agg);
+  return c.bytes;
+}
+
+int serializeAggregator(const struct aggregator *agg, unsigned char *buffer,
+			size_t size) {
+  struct cursor c = {buffer, 0, 0};
+
+  if (size < aggregatorSize())
+    return -1;
+  transferAggregator(&c, (struct aggregator*)agg);
+  return 0;
+}
+
+int deserializeAggregator(const unsigned char *buffer, size_t size,
+			  struct aggregator *agg) {
+  struct cursor c = {(unsigned char*)buffer + sizeof(AGGREGATOR_MAGIC), 1, 0};
+  long header[4];
+
+  if (size < aggregatorSize()
+      || memcmp(buffer, AGGREGATOR_MAGIC, sizeof(AGGREGATOR_MAGIC)) != 0)
+    return -1;
+  transferLongs(&c, header, 4);
+  if (header[0] != AGGREGATOR_VERSION || header[1] != MAX_STRATEGIES
+      || header[2] != HISTOGRAM_BUCKETS || header[3] != SKETCH_BUCKETS)
+    return -1;
+
+  c.p = (unsigned char*)buffer;
+  transferAggregator(&c, agg);
+  return 0;
+}
+
+int writeAggregatorFile(const char *path, const struct aggregator *agg) {
+  unsigned char *buffer;
+  FILE *out;
+  int r = -1;
+
+  buffer = malloc(aggregatorSize());
+  if (buffer == NULL)
+    return -1;
+  serializeAggregator(agg, buffer, aggregatorSize());
+  out = fopen(path, "wb");
+  if (out != NULL)
+    {
+      if (fwrite(buffer, 1, aggregatorSize(), out) == aggregatorSize())
+	r = 0;
+      if (fclose(out) != 0)
+	r = -1;
+    }
+  free(buffer);
+  return r;
+}
+
+int readAggregatorFile(const char *path, struct aggregator *agg) {
+  unsigned char *buffer;
+  FILE *in;
+  int r = -1;
+
+  buffer = malloc(aggregatorSize());
+  if (buffer == NULL)
+    return -1;
+  in = fopen(path, "rb");
+  if (in != NULL)
+    {
+      if (fread(buffer, 1, aggregatorSize(), in) == aggregatorSize())
+	r = deserializeAggregator(buffer, aggregatorSize(), agg);
+      fclose(in);
+    }
+  free(buffer);
+  return r;
+}
+
+/* Report */
+/* --------------------------------------------------------------- */
+
+static void printMetric(FILE *out, const char *label, const struct metric *m) {
+  const struct histogram *h = &m->histogram;
+  long peak = 0;
+  int first = HISTOGRAM_BUCKETS;
+  int last = -1;
+  int i;
+
+  fprintf(out, "%s: mean %.4f sd %.4f min %ld max %ld\n", label,
+	  metricMean(m), sqrt(metricVariance(m)), m->moments.min, m->moments.max);
+  fprintf(out, "  quantiles 1%% %.1f  10%% %.1f  50%% %.1f  90%% %.1f  99%% %.1f\n",
+	  metricQuantile(m, 0.01), metricQuantile(m, 0.10), metricQuantile(m, 0.50),
+	  metricQuantile(m, 0.90), metricQuantile(m, 0.99));
+
+  for (i = 0; i < HISTOGRAM_BUCKETS; i++)
+    if (h->counts[i] > 0)
+      {
+	if (i < first)
+	  first = i;
+	last = i;
+	if (h->counts[i] > peak)
+	  peak = h->counts[i];
+      }
+  if (h->below > 0)
+    fprintf(out, "  %8s < %-6g %10ld\n", "", h->lo, h->below);
+  for (i = first; i <= last; i++)
+    fprintf(out, "  [%6g, %6g) %10ld %.*s\n", h->lo + i * h->width,
+	    h->lo + (i + 1) * h->width, h->counts[i],
+	    (int)(40 * h->counts[i] / peak), "########################################");
+  if (h->above > 0)
+    fprintf(out, "  %8s >= %-6g %9ld\n", "", h->lo + HISTOGRAM_BUCKETS * h->width,
+	    h->above);
+}
+
+void printAggregator(FILE *out, const struct aggregator *agg) {
+  int i;
+
+  fprintf(out, "%ld games", agg->games);
+  if (agg->unfinished > 0)
+    fprintf(out, ", %ld hit the %d turn limit", agg->unfinished, MAX_GAME_TURNS);
+  fprintf(out, "\n");
+  for (i = 0; i < MAX_STRATEGIES; i++)
+    if (agg->seats[i] > 0)
+      fprintf(out, "%-16s %10ld seats, won %6.2f%%, tied %5.2f%%\n",
+	      i < numStrategies() ? getStrategy(i)->name : "?", agg->seats[i],
+	      100.0 * agg->wins[i] / agg->seats[i], 100.0 * agg->ties[i] / agg->seats[i]);
+  printMetric(out, "Final score per seat", &agg->score);
+  printMetric(out, "Game length in turns", &agg->turns);
+}
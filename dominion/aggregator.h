@@ -0,0 +1,99 @@
+#ifndef _AGGREGATOR_H
+#define _AGGREGATOR_H
+
+/* Mergeable summaries of many games in constant memory.
+
+   An aggregator holds exact counts per strategy and, for final scores
+   (one sample per seat) and game lengths, a metric: integer sums for
+   the moments, a fixed-bucket histogram and a quantile sketch.  Any two
+   aggregators merge into the summary of both sets of games, so worker
+   threads, separate processes and resumed runs combine into one report.
+   Every field is an integer count or sum, so merging is exact: however
+   the games are split and in whatever order the parts are merged, the
+   result is bit-identical to aggregating them all in one place.
+
+   The quantile sketch buckets values by the logarithm of their size, as
+   DDSketch does: a bucket's values differ by at most SKETCH_ACCURACY
+   relative to each other, so every quantile is within that relative
+   error, and merging adds bucket counts exactly.
+
+   Serialized aggregators are little-endian whatever the host. */
+
+#include <stddef.h>
+#include <stdio.h>
+#include "strategy.h"
+#include "simulate.h"
+
+#define AGGREGATOR_VERSION 2
+#define HISTOGRAM_BUCKETS 64
+#define SKETCH_BUCKETS 512        /* per sign; larger values share the last */
+#define SKETCH_ACCURACY 0.01
+
+struct moments {
+  long n;
+  long sum;
+  long sumSquares;
+  long min;
+  long max;
+};
+
+struct histogram {
+  double lo;                      //lower edge of bucket 0
+  double width;
+  long below;                     //samples under lo
+  long above;                     //samples past the last bucket
+  long counts[HISTOGRAM_BUCKETS];
+};
+
+struct quantileSketch {
+  long zeros;                     //samples with |x| < 1
+  long positive[SKETCH_BUCKETS];  //bucket i holds (gamma^(i-1), gamma^i]
+  long negative[SKETCH_BUCKETS];  //the same, for -x
+};
+
+struct metric {
+  struct moments moments;
+  struct histogram histogram;
+  struct quantileSketch sketch;
+};
+
+struct aggregator {
+  long games;
+  long unfinished;                //games that hit MAX_GAME_TURNS
+  long seats[MAX_STRATEGIES];     //seats played by each strategy
+  long wins[MAX_STRATEGIES];      //outright wins
+  long ties[MAX_STRATEGIES];      //shared wins
+  struct metric score;
+  struct metric turns;
+};
+
+void initAggregator(struct aggregator *agg);
+
+void aggregateGame(struct aggregator *agg, const int strategyIds[],
+		   const struct gameResult *result);
+
+int mergeAggregator(struct aggregator *into, const struct aggregator *from);
+/* Adds from's games to into; -1 if their histograms are bucketed
+   differently */
+
+void addSample(struct metric *m, long x);
+double metricMean(const struct metric *m);
+double metricVariance(const struct metric *m);
+/* Sample variance, 0 for fewer than two samples */
+double metricQuantile(const struct metric *m, double q);
+/* Estimate of the q quantile, 0 <= q <= 1 */
+
+size_t aggregatorSize(void);
+/* Bytes of every serialized aggregator */
+int serializeAggregator(const struct aggregator *agg, unsigned char *buffer,
+			size_t size);
+int deserializeAggregator(const unsigned char *buffer, size_t size,
+			  struct aggregator *agg);
+
+int writeAggregatorFile(const char *path, const struct aggregator *agg);
+int readAggregatorFile(const char *path, struct aggregator *agg);
+
+void printAggregator(FILE *out, const struct aggregator *agg);
+/* Report of the counts and both metrics */
+
+#endif
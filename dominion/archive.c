@@ -0,0 +1,422 @@
+#define _DEFAULT_SOURCE
+#include "archive.h"
+#include "gamerecord.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static int writeBytes(struct archiveWriter *writer, const void *data,
+		      size_t length) {
+  if (fwrite(data, 1, length, writer->out) != length)
+    return -1;
+  writer->offset += length;
+  return 0;
+}
+
+static int alignOutput(struct archiveWriter *writer) {
+  static const unsigned char zeros[8];
+  size_t pad = (size_t)(-writer->offset & 7);
+  return writeBytes(writer, zeros, pad);
+}
+
+static int writeVarint(struct archiveWriter *writer, uint64_t value) {
+  unsigned char bytes[10];
+  size_t n = 0;
+
+  while (value >= 0x80)
+    {
+      bytes[n++] = (unsigned char)(value | 0x80);
+      value >>= 7;
+    }
+  bytes[n++] = (unsigned char)value;
+  return writeBytes(writer, bytes, n);
+}
+
+/* Keyframes (see archive.h) */
+/* --------------------------------------------------------------- */
+
+static int putInts(struct gameRecord *frame, const int *values, int count) {
+  int i;
+  for (i = 0; i < count; i++)
+    if (putSignedVarint(frame, values[i]) < 0)
+      return -1;
+  return 0;
+}
+
+static int putCards(struct gameRecord *frame, const int *cards, int count) {
+  if (putSignedVarint(frame, count) < 0)
+    return -1;
+  return putInts(frame, cards, count);
+}
+
+static int encodeKeyframe(struct gameRecord *frame, uint32_t turn,
+			  size_t actionOffset, const struct rngPosition *rng,
+			  const struct gameState *state) {
+  int scalars[7] = {state->outpostPlayed, state->outpostTurn, state->whoseTurn,
+		    state->phase, state->numActions, state->coins, state->numBuys};
+  int p;
+
+  frame->length = 0;
+  if (putVarint(frame, turn) < 0
+      || putVarint(frame, actionOffset) < 0
+      || putVarint(frame, (unsigned long)rng->game) < 0
+      || putVarint(frame, MAX_PLAYERS) < 0)
+    return -1;
+  for (p = 0; p < MAX_PLAYERS; p++)
+    if (putVarint(frame, (unsigned long)rng->players[p]) < 0)
+      return -1;
+
+  if (putInts(frame, &state->numPlayers, 1) < 0
+      || putInts(frame, state->supplyCount, treasure_map + 1) < 0
+      || putInts(frame, state->embargoTokens, treasure_map + 1) < 0
+      || putInts(frame, scalars, 7) < 0)
+    return -1;
+  for (p = 0; p < state->numPlayers; p++)
+    if (putCards(frame, state->hand[p], state->handCount[p]) < 0
+	|| putCards(frame, state->deck[p], state->deckCount[p]) < 0
+	|| putCards(frame, state->discard[p], state->discardCount[p]) < 0)
+      return -1;
+  if (putCards(frame, state->playedCards, state->playedCardCount) < 0)
+    return -1;
+  return putInts(frame, &state->rngMode, 1);
+}
+
+static int getInts(const unsigned char *data, size_t length, size_t *offset,
+		   int *values, int count) {
+  int i;
+  for (i = 0; i < count; i++)
+    if (getSignedVarint(data, length, offset, &values[i]) < 0)
+      return -1;
+  return 0;
+}
+
+/* A count of at most max and that many cards, each a real card */
+static int getCards(const unsigned char *data, size_t length, size_t *offset,
+		    int *cards, int *count, int max) {
+  int i;
+
+  if (getSignedVarint(data, length, offset, count) < 0
+      || *count < 0 || *count > max
+      || getInts(data, length, offset, cards, *count) < 0)
+    return -1;
+  for (i = 0; i < *count; i++)
+    if (cards[i] < curse || cards[i] > treasure_map)
+      return -1;
+  return 0;
+}
+
+/* Decodes the keyframe in data[*offset, length); -1 if it is malformed
+   or holds counts, cards or streams this engine could not use */
+static int decodeKeyframe(const unsigned char *data, size_t length,
+			  size_t *offset, unsigned long *turn,
+			  unsigned long *actionOffset, struct rngPosition *rng,
+			  struct gameState *state) {
+  unsigned long u;
+  int scalars[7];
+  int p;
+
+  if (getVarint(data, length, offset, turn) < 0
+      || getVarint(data, length, offset, actionOffset) < 0
+      || getVarint(data, length, offset, &u) < 0)
+    return -1;
+  rng->game = (long)u;
+  if (getVarint(data, length, offset, &u) < 0 || u != MAX_PLAYERS)
+    return -1;
+  for (p = 0; p < MAX_PLAYERS; p++)
+    {
+      if (getVarint(data, length, offset, &u) < 0)
+	return -1;
+      rng->players[p] = (long)u;
+    }
+
+  memset(state, 0, sizeof(struct gameState));
+  if (getInts(data, length, offset, &state->numPlayers, 1) < 0
+      || state->numPlayers < 2 || state->numPlayers > MAX_PLAYERS
+      || getInts(data, length, offset, state->supplyCount, treasure_map + 1) < 0
+      || getInts(data, length, offset, state->embargoTokens, treasure_map + 1) < 0
+      || getInts(data, length, offset, scalars, 7) < 0)
+    return -1;
+  state->outpostPlayed = scalars[0];
+  state->outpostTurn = scalars[1];
+  state->whoseTurn = scalars[2];
+  state->phase = scalars[3];
+  state->numActions = scalars[4];
+  state->coins = scalars[5];
+  state->numBuys = scalars[6];
+  if (state->whoseTurn < 0 || state->whoseTurn >= state->numPlayers)
+    return -1;
+  for (p = 0; p < state->numPlayers; p++)
+    if (getCards(data, length, offset, state->hand[p], &state->handCount[p],
+		 MAX_HAND) < 0
+	|| getCards(data, length, offset, state->deck[p], &state->deckCount[p],
+		    MAX_DECK) < 0
+	|| getCards(data, length, offset, state->discard[p],
+		    &state->discardCount[p], MAX_DECK) < 0)
+      return -1;
+  if (getCards(data, length, offset, state->playedCards,
+	       &state->playedCardCount, MAX_DECK) < 0
+      || getInts(data, length, offset, &state->rngMode, 1) < 0)
+    return -1;
+  return state->rngMode == RNG_SHARED || state->rngMode == RNG_PER_PLAYER ? 0 : -1;
+}
+
+/* Archives */
+/* --------------------------------------------------------------- */
+
+static void writeHeader(struct archiveFileHeader *header,
+			const struct archiveWriter *writer) {
+  memset(header, 0, sizeof(*header));
+  strncpy(header->magic, ARCHIVE_MAGIC, sizeof(header->magic));
+  header->version = ARCHIVE_VERSION;
+  header->keyframeInterval = writer->keyframeInterval;
+  header->numGames = writer->numGames;
+  header->indexOffset = writer->offset;
+}
+
+int openArchiveWriter(struct archiveWriter *writer, const char *path,
+		      int keyframeInterval) {
+  struct archiveFileHeader header;
+
+  if (keyframeInterval < 0)
+    return -1;
+  memset(writer, 0, sizeof(*writer));
+  writer->keyframeInterval = keyframeInterval;
+  writer->out = fopen(path, "wb");
+  if (writer->out == NULL)
+    return -1;
+
+  //placeholder until closeArchiveWriter knows where the index is
+  writeHeader(&header, writer);
+  if (writeBytes(writer, &header, sizeof(header)) < 0)
+    {
+      fclose(writer->out);
+      writer->out = NULL;
+      return -1;
+    }
+  return 0;
+}
+
+int archiveAppend(struct archiveWriter *writer, const unsigned char *data,
+		  size_t length) {
+  struct archiveEntry entry;
+  struct gameState *state;
+  struct gameRecord frame;
+  struct rngPosition rng;
+  struct recordHeader header;
+  struct archiveEntry *grown;
+  size_t offset;
+  uint64_t capacity;
+  uint32_t turn;
+  int r = 0;
+
+  if (writer->numGames == writer->capacity)
+    {
+      capacity = writer->capacity ? writer->capacity * 2 : 1024;
+      grown = realloc(writer->index, capacity * sizeof(struct archiveEntry));
+      if (grown == NULL)
+	return -1;
+      writer->index = grown;
+      writer->capacity = capacity;
+    }
+
+  memset(&entry, 0, sizeof(entry));
+  entry.recordOffset = writer->offset;
+  entry.recordLength = (uint32_t)length;
+  if (length > UINT32_MAX || writeBytes(writer, data, length) < 0)
+    return -1;
+  entry.keyframeOffset = writer->offset;
+
+  if (writer->keyframeInterval > 0)
+    {
+      state = malloc(sizeof(struct gameState));
+      if (state == NULL)
+	return -1;
+      initGameRecord(&frame);
+      if (startReplay(data, length, &header, state) < 0)
+	r = -1;
+      else
+	offset = header.actionsOffset;
+      turn = 0;
+      while (r == 0)
+	{
+	  if (replayActions(data, length, &offset, writer->keyframeInterval,
+			    state, NULL, NULL) < 0)
+	    {
+	      r = -1;
+	      break;
+	    }
+	  //no keyframe for the finished game, nothing is left to replay
+	  if (offset >= length)
+	    break;
+	  turn += writer->keyframeInterval;
+	  saveRngPosition(&rng);
+	  if (encodeKeyframe(&frame, turn, offset, &rng, state) < 0
+	      || writeVarint(writer, frame.length) < 0
+	      || writeBytes(writer, frame.data, frame.length) < 0)
+	    r = -1;
+	  entry.numKeyframes++;
+	}
+      freeGameRecord(&frame);
+      free(state);
+      if (r < 0)
+	return -1;
+    }
+
+  writer->index[writer->numGames++] = entry;
+  return 0;
+}
+
+int closeArchiveWriter(struct archiveWriter *writer) {
+  struct archiveFileHeader header;
+  int r = 0;
+
+  if (alignOutput(writer) < 0)
+    r = -1;
+  writeHeader(&header, writer);
+  if (r < 0
+      || writeBytes(writer, writer->index,
+		 writer->numGames * sizeof(struct archiveEntry)) < 0
+      || fseek(writer->out, 0, SEEK_SET) != 0
+      || fwrite(&header, sizeof(header), 1, writer->out) != 1)
+    r = -1;
+  if (fclose(writer->out) != 0)
+    r = -1;
+  free(writer->index);
+  writer->index = NULL;
+  return r;
+}
+
+int openArchive(struct gameArchive *archive, const char *path) {
+  const struct archiveFileHeader *header;
+  struct stat st;
+  void *base;
+  int fd;
+
+  memset(archive, 0, sizeof(*archive));
+  fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return -1;
+  if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(struct archiveFileHeader))
+    {
+      close(fd);
+      return -1;
+    }
+  base = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED)
+    return -1;
+
+  archive->base = base;
+  archive->size = st.st_size;
+  header = base;
+  if (strncmp(header->magic, ARCHIVE_MAGIC, sizeof(header->magic)) != 0
+      || header->version != ARCHIVE_VERSION
+      || header->indexOffset > archive->size
+      || header->indexOffset % 8 != 0
+      || header->numGames > (archive->size - header->indexOffset)
+                            / sizeof(struct archiveEntry))
+    {
+      closeArchive(archive);
+      return -1;
+    }
+  archive->header = header;
+  archive->index = (const struct archiveEntry*)(archive->base + header->indexOffset);
+  return 0;
+}
+
+void closeArchive(struct gameArchive *archive) {
+  if (archive->base != NULL)
+    munmap((void*)archive->base, archive->size);
+  memset(archive, 0, sizeof(*archive));
+}
+
+long archiveNumGames(const struct gameArchive *archive) {
+  return (long)archive->header->numGames;
+}
+
+const unsigned char* archiveRecord(const struct gameArchive *archive,
+				   long game, size_t *length) {
+  const struct archiveEntry *entry;
+
+  if (game < 0 || game >= archiveNumGames(archive))
+    return NULL;
+  entry = &archive->index[game];
+  if (entry->recordOffset + entry->recordLength > archive->size)
+    return NULL;
+  *length = entry->recordLength;
+  return archive->base + entry->recordOffset;
+}
+
+static int countTurns(const struct recordAction *action,
+		      struct gameState *state, void *ctx) {
+  if (action->type == ACTION_END)
+    (*(long*)ctx)++;
+  return 0;
+}
+
+long archiveSeek(const struct gameArchive *archive, long game, long turn,
+		 struct gameState *state) {
+  const struct archiveEntry *entry;
+  const unsigned char *data;
+  struct recordHeader header;
+  struct rngPosition rng;
+  unsigned long frameLength;
+  unsigned long frameTurn;
+  unsigned long actionOffset;
+  size_t length;
+  size_t offset;
+  long reached = 0;
+  long k;
+  long i;
+
+  data = archiveRecord(archive, game, &length);
+  if (data == NULL || turn < 0)
+    return -1;
+  entry = &archive->index[game];
+
+  //keyframe k holds turn (k + 1) * keyframeInterval
+  k = -1;
+  if (archive->header->keyframeInterval > 0)
+    {
+      k = turn / archive->header->keyframeInterval - 1;
+      if (k >= (long)entry->numKeyframes)
+	k = (long)entry->numKeyframes - 1;
+    }
+  if (k >= 0)
+    {
+      //keyframes vary in length: skip the k before it
+      offset = entry->keyframeOffset;
+      for (i = 0; ; i++)
+	{
+	  if (offset > archive->size
+	      || getVarint(archive->base, archive->size, &offset, &frameLength) < 0
+	      || frameLength > archive->size - offset)
+	    return -1;
+	  if (i == k)
+	    break;
+	  offset += frameLength;
+	}
+      if (decodeKeyframe(archive->base, offset + frameLength, &offset, &frameTurn,
+			 &actionOffset, &rng, state) < 0
+	  || frameTurn > (unsigned long)turn || actionOffset > length)
+	return -1;
+      restoreRngPosition(&rng);
+      reached = (long)frameTurn;
+      offset = actionOffset;
+    }
+  else
+    {
+      if (startReplay(data, length, &header, state) < 0)
+	return -1;
+      offset = header.actionsOffset;
+    }
+
+  if (replayActions(data, length, &offset, turn - reached, state,
+		    countTurns, &reached) < 0)
+    return -1;
+  return reached;
+}
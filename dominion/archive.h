@@ -0,0 +1,101 @@
+#ifndef _ARCHIVE_H
+#define _ARCHIVE_H
+
+/* Game archives: many game records (see gamerecord.h) in one file that
+   is mapped read-only, so any number of analysis processes share the
+   same pages and read records in place without copying them.
+
+   Layout, header and index integers in host byte order:
+
+     struct archiveFileHeader
+     per game   the record bytes, then its keyframes
+     index      struct archiveEntry for every game, in append order,
+                8-byte aligned
+
+   A keyframe is the state of the game and the RNG stream positions
+   after a multiple of keyframeInterval turns, with the record offset at
+   which replay resumes.  Seeking to a turn restores the nearest keyframe
+   at or before it and replays only the actions since.  Each keyframe is
+   its varint length, then varints (zigzag for the state's ints) in the
+   byte order of the record format:
+
+     turn, actionOffset, GAME_STREAM position, MAX_PLAYERS and each
+     player stream's position; numPlayers, supplyCount, embargoTokens,
+     outpostPlayed, outpostTurn, whoseTurn, phase, numActions, coins,
+     numBuys; for each player handCount and the hand, deckCount and the
+     deck, discardCount and the discard; playedCardCount and the played
+     cards; rngMode
+
+   so only the live part of the gameState is stored, a few hundred
+   bytes, and keyframes read the same on any host.  A restored state is
+   zero past each count. */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "dominion.h"
+
+#define ARCHIVE_MAGIC "DOMARCH"
+#define ARCHIVE_VERSION 2
+
+struct archiveFileHeader {
+  char magic[8];              //ARCHIVE_MAGIC, NUL padded
+  uint32_t version;
+  uint32_t keyframeInterval;  //turns between keyframes, 0 for none
+  uint32_t reserved[2];
+  uint64_t numGames;
+  uint64_t indexOffset;
+};
+
+struct archiveEntry {
+  uint64_t recordOffset;
+  uint64_t keyframeOffset;    //first of this game's keyframes, if any
+  uint32_t recordLength;
+  uint32_t numKeyframes;
+};
+
+struct archiveWriter {
+  FILE *out;
+  uint32_t keyframeInterval;
+  uint64_t offset;            //bytes written so far
+  struct archiveEntry *index;
+  uint64_t numGames;
+  uint64_t capacity;
+};
+
+struct gameArchive {
+  const unsigned char *base;  //the whole file, mapped read-only
+  size_t size;
+  const struct archiveFileHeader *header;
+  const struct archiveEntry *index;
+};
+
+int openArchiveWriter(struct archiveWriter *writer, const char *path,
+		      int keyframeInterval);
+/* Creates path; keyframeInterval 0 writes no keyframes */
+
+int archiveAppend(struct archiveWriter *writer, const unsigned char *data,
+		  size_t length);
+/* Appends one game record, replaying it to build its keyframes.
+   Returns -1 on a write error or a malformed record */
+
+int closeArchiveWriter(struct archiveWriter *writer);
+/* Writes the index and header; the archive is unreadable until then */
+
+int openArchive(struct gameArchive *archive, const char *path);
+void closeArchive(struct gameArchive *archive);
+
+long archiveNumGames(const struct gameArchive *archive);
+
+const unsigned char* archiveRecord(const struct gameArchive *archive,
+				   long game, size_t *length);
+/* Record of game, pointing into the mapping; NULL if game is out of
+   range */
+
+long archiveSeek(const struct gameArchive *archive, long game, long turn,
+		 struct gameState *state);
+/* Sets state (and the RNG streams) to game as it stood after turn
+   end-turn actions, or at its end if it finished sooner.  Returns the
+   turn reached, -1 on error */
+
+#endif
@@ -0,0 +1,551 @@
+/* Engine benchmarks
+
+   benchmark [-r repetitions] [-w warmup] [-c cpu] [-p] [-o file] [prefix]
+
+   Times each engine operation in batches calibrated to about 2 ms,
+   after warmup batches that are not recorded, with the process pinned
+   to one CPU (the one it starts on unless -c says otherwise).  The
+   report is JSON: per operation, the median, 99th percentile, minimum
+   and mean over the repetitions of the nanoseconds per call, and for
+   whole games the games per second at the median.  A prefix limits the
+   run to the benchmarks whose names start with it.
+
+   With -p the timed regions also run hardware counters (see
+   perfcounters.h), reported per call as the mean over the repetitions.
+   Counters the machine does not give us, all of them in most
+   containers, are reported as null and the times are measured as
+   without -p.
+
+   Operations that consume the state they run on restore the few fields
+   they touch inside the timed loop, except cardEffect, which runs on
+   copies of the prepared state made outside the timed region. */
+
+#define _GNU_SOURCE
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "dominion.h"
+#include "dominion_helpers.h"
+#include "perfcounters.h"
+#include "rngs.h"
+#include "simulate.h"
+#include "stategen.h"
+#include "strategy.h"
+
+#define MAX_BENCHMARKS 64
+#define BATCH_NS 2000000.0
+#define MAX_REPETITIONS 10000
+#define STATE_POOL 32           /* states copied ahead of each timed run of cardEffect */
+
+struct benchContext {
+  struct gameState state;
+  struct gameState saved;       //what cardEffect starts from
+  struct gameState pool[STATE_POOL];
+  struct gameTemplate tmpl;
+  struct stateGenerator gen;
+  int kingdom[10];
+  int param;                    //deck size, card or strategy
+  int choice1, choice2, choice3;
+  int seed;
+  volatile long sink;           //keeps results of pure calls alive
+};
+
+struct benchmark {
+  char name[48];
+  void (*setup)(struct benchContext *ctx);
+  double (*run)(struct benchContext *ctx, long iterations);
+  /* Nanoseconds spent in iterations calls */
+  int param;
+  int isGame;                   //also report games per second
+};
+
+static struct benchmark benchmarks[MAX_BENCHMARKS];
+static int numBenchmarks = 0;
+static struct perfCounters counters;
+static int useCounters = 0;
+
+static double nowNs(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* Timed regions run the counters, started outside the clock readings */
+static double startTimer(void) {
+  startPerfCounters(&counters);
+  return nowNs();
+}
+
+static double stopTimer(double start) {
+  double elapsed = nowNs() - start;
+  stopPerfCounters(&counters);
+  return elapsed;
+}
+
+static int compareDoubles(const void *a, const void *b) {
+  double x = *(const double*)a;
+  double y = *(const double*)b;
+  return (x > y) - (x < y);
+}
+
+/* States */
+/* --------------------------------------------------------------- */
+
+/* A kingdom of card and the nine kingdom cards after it */
+static void kingdomWith(int card, int kingdom[10]) {
+  int i;
+  for (i = 0; i < 10; i++)
+    kingdom[i] = adventurer + (card - adventurer + i) % (treasure_map - adventurer + 1);
+}
+
+static void freshGame(struct benchContext *ctx) {
+  memset(&ctx->state, 0, sizeof(struct gameState));
+  initializeGame(2, ctx->kingdom, 1, &ctx->state);
+}
+
+/* A deck of n cards of mixed kinds for player 0 */
+static void setDeck(struct gameState *state, int n) {
+  static const int mix[5] = {copper, estate, silver, copper, village};
+  int i;
+  for (i = 0; i < n; i++)
+    state->deck[0][i] = mix[i % 5];
+  state->deckCount[0] = n;
+  state->handCount[0] = 0;
+  state->discardCount[0] = 0;
+}
+
+static void setupShuffle(struct benchContext *ctx) {
+  freshGame(ctx);
+  setDeck(&ctx->state, ctx->param);
+}
+
+static void setupDraw(struct benchContext *ctx) {
+  freshGame(ctx);
+  setDeck(&ctx->state, MAX_DECK);
+}
+
+static void setupReshuffle(struct benchContext *ctx) {
+  freshGame(ctx);
+  setDeck(&ctx->state, 0);
+}
+
+/* Player 0 to play ctx->param from hand position 0, with choices that
+   make it do its full work */
+static void setupCardEffect(struct benchContext *ctx) {
+  static const int hand[6] = {-1, copper, copper, silver, estate, treasure_map};
+  int card = ctx->param;
+
+  //every card gained or returned is a base card
+  kingdomWith(card, ctx->kingdom);
+  freshGame(ctx);
+  memcpy(ctx->state.hand[0], hand, sizeof(hand));
+  ctx->state.hand[0][0] = card;
+  ctx->state.handCount[0] = 6;
+
+  ctx->choice1 = ctx->choice2 = ctx->choice3 = 0;
+  switch (card)
+    {
+    case feast:
+      ctx->choice1 = silver;
+      break;
+    case mine:
+      ctx->choice1 = 1;
+      ctx->choice2 = silver;
+      break;
+    case remodel:
+      ctx->choice1 = 4;
+      ctx->choice2 = silver;
+      break;
+    case baron:
+    case minion:
+    case steward:
+      ctx->choice1 = 1;
+      break;
+    case ambassador:
+      ctx->choice1 = 4;
+      ctx->choice2 = 1;
+      break;
+    case embargo:
+      ctx->choice1 = copper;
+      break;
+    case salvager:
+      ctx->choice1 = 4;
+      break;
+    }
+  ctx->saved = ctx->state;
+}
+
+/* Player 0's turn after a few rounds of big money, with cards in every pile */
+static void setupMidGame(struct benchContext *ctx) {
+  struct botMemory memory[2];
+  const struct strategy *bot = getStrategy(0);
+  int turn;
+
+  freshGame(ctx);
+  memset(memory, 0, sizeof(memory));
+  for (turn = 0; turn < 20; turn++)
+    {
+      bot->playTurn(whoseTurn(&ctx->state), &ctx->state, &memory[whoseTurn(&ctx->state)]);
+      endTurn(&ctx->state);
+    }
+}
+
+static void setupTemplate(struct benchContext *ctx) {
+  initGameTemplate(2, ctx->kingdom, RNG_SHARED, &ctx->tmpl);
+  ctx->seed = 1;
+}
+
+static void setupGenerator(struct benchContext *ctx) {
+  struct stateShape shape;
+  defaultStateShape(&shape);
+  initStateGenerator(&ctx->gen, ctx->kingdom, &shape, 1);
+}
+
+static void setupGames(struct benchContext *ctx) {
+  ctx->seed = 1;
+}
+
+/* Operations */
+/* --------------------------------------------------------------- */
+
+static double runShuffle(struct benchContext *ctx, long iterations) {
+  long i;
+  double start = startTimer();
+  for (i = 0; i < iterations; i++)
+    shuffle(0, &ctx->state);
+  return stopTimer(start);
+}
+
+static double runDraw(struct benchContext *ctx, long iterations) {
+  long i;
+  double start = startTimer();
+  for (i = 0; i < iterations; i++)
+    {
+      //the deck array is left intact, so its counts rewind it
+      if (ctx->state.deckCount[0] == 0)
+	{
+	  ctx->state.deckCount[0] = MAX_DECK;
+	  ctx->state.handCount[0] = 0;
+	}
+      drawCard(0, &ctx->state);
+    }
+  return stopTimer(start);
+}
+
+static double runReshuffle(struct benchContext *ctx, long iterations) {
+  static const int discard[10] = {copper, copper, copper, copper, copper,
+				  copper, copper, estate, estate, estate};
+  struct gameState *state = &ctx->state;
+  long i;
+  double start = startTimer();
+  for (i = 0; i < iterations; i++)
+    {
+      memcpy(state->discard[0], discard, sizeof(discard));
+      state->discardCount[0] = 10;
+      state->deckCount[0] = 0;
+      state->handCount[0] = 0;
+      drawCard(0, state);
+    }
+  return stopTimer(start);
+}
+
+static double runCardEffect(struct benchContext *ctx, long iterations) {
+  double elapsed = 0;
+  double start;
+  int bonus;
+  long done;
+  int n, i;
+
+  for (done = 0; done < iterations; done += n)
+    {
+      n = iterations - done < STATE_POOL ? (int)(iterations - done) : STATE_POOL;
+      for (i = 0; i < n; i++)
+	memcpy(&ctx->pool[i], &ctx->saved, sizeof(struct gameState));
+      start = startTimer();
+      for (i = 0; i < n; i++)
+	{
+	  bonus = 0;
+	  cardEffect(ctx->param, ctx->choice1, ctx->choice2, ctx->choice3,
+		     &ctx->pool[i], 0, &bonus);
+	}
+      elapsed += stopTimer(start);
+    }
+  return elapsed;
+}
+
+static double runStateCopy(struct benchContext *ctx, long iterations) {
+  long i;
+  double start = startTimer();
+  for (i = 0; i < iterations; i++)
+    memcpy(&ctx->state, &ctx->saved, sizeof(struct gameState));
+  return stopTimer(start);
+}
+
+static double runBuy(struct benchContext *ctx, long iterations) {
+  struct gameState *state = &ctx->state;
+  int p = whoseTurn(state);
+  long i;
+  double start = startTimer();
+  for (i = 0; i < iterations; i++)
+    {
+      state->numBuys = 1;
+      state->coins = 8;
+      state->supplyCount[silver] = 40;
+      state->discardCount[p] = 0;
+      buyCard(silver, state);
+    }
+  return stopTimer(start);
+}
+
+static double runEndTurn(struct benchContext *ctx, long iterations) {
+  long i;
+  double start = startTimer();
+  for (i = 0; i < iterations; i++)
+    endTurn(&ctx->state);
+  return stopTimer(start);
+}
+
+static double runScoreFor(struct benchContext *ctx, long iterations) {
+  long i;
+  double start = startTimer();
+  for (i = 0; i < iterations; i++)
+    ctx->sink += scoreFor(0, &ctx->state);
+  return stopTimer(start);
+}
+
+static double runIsGameOver(struct benchContext *ctx, long iterations) {
+  long i;
+  double start = startTimer();
+  for (i = 0; i < iterations; i++)
+    ctx->sink += isGameOver(&ctx->state);
+  return stopTimer(start);
+}
+
+static double runInitializeGame(struct benchContext *ctx, long iterations) {
+  long i;
+  double start = startTimer();
+  for (i = 0; i < iterations; i++)
+    initializeGame(2, ctx->kingdom, ctx->seed++, &ctx->state);
+  return stopTimer(start);
+}
+
+static double runResetGame(struct benchContext *ctx, long iterations) {
+  long i;
+  double start = startTimer();
+  for (i = 0; i < iterations; i++)
+    resetGame(&ctx->tmpl, ctx->seed++, &ctx->state);
+  return stopTimer(start);
+}
+
+static double runRandomState(struct benchContext *ctx, long iterations) {
+  long i;
+  double start = startTimer();
+  for (i = 0; i < iterations; i++)
+    randomState(&ctx->gen, &ctx->state);
+  return stopTimer(start);
+}
+
+static double runGames(struct benchContext *ctx, long iterations) {
+  struct gameResult result;
+  int ids[2] = {ctx->param, ctx->param};
+  long i;
+  double start = startTimer();
+  for (i = 0; i < iterations; i++)
+    playGame(2, ids, ctx->kingdom, ctx->seed++, RNG_SHARED, &ctx->state, &result);
+  return stopTimer(start);
+}
+
+/* Harness */
+/* --------------------------------------------------------------- */
+
+static void addBenchmark(const char *name, void (*setup)(struct benchContext *),
+			 double (*run)(struct benchContext *, long), int param) {
+  struct benchmark *b = &benchmarks[numBenchmarks++];
+  snprintf(b->name, sizeof(b->name), "%s", name);
+  b->setup = setup;
+  b->run = run;
+  b->param = param;
+  b->isGame = run == runGames;
+}
+
+static void registerBenchmarks(void) {
+  static const int deckSizes[4] = {10, 50, 200, MAX_DECK};
+  char name[48];
+  int i;
+
+  for (i = 0; i < 4; i++)
+    {
+      snprintf(name, sizeof(name), "shuffle/%d", deckSizes[i]);
+      addBenchmark(name, setupShuffle, runShuffle, deckSizes[i]);
+    }
+  addBenchmark("drawCard/deck", setupDraw, runDraw, 0);
+  addBenchmark("drawCard/reshuffle_10", setupReshuffle, runReshuffle, 0);
+  addBenchmark("gameState_copy", setupCardEffect, runStateCopy, smithy);
+  for (i = adventurer; i <= treasure_map; i++)
+    {
+      snprintf(name, sizeof(name), "cardEffect/%s", cardName(i));
+      addBenchmark(name, setupCardEffect, runCardEffect, i);
+    }
+  addBenchmark("buyCard", setupMidGame, runBuy, 0);
+  addBenchmark("endTurn", setupMidGame, runEndTurn, 0);
+  addBenchmark("scoreFor", setupMidGame, runScoreFor, 0);
+  addBenchmark("isGameOver", setupMidGame, runIsGameOver, 0);
+  addBenchmark("initializeGame", setupGames, runInitializeGame, 0);
+  addBenchmark("resetGame", setupTemplate, runResetGame, 0);
+  addBenchmark("randomState", setupGenerator, runRandomState, 0);
+  for (i = 0; i < numStrategies(); i++)
+    {
+      snprintf(name, sizeof(name), "game/%s", getStrategy(i)->name);
+      addBenchmark(name, setupGames, runGames, i);
+    }
+}
+
+static void writeCounters(FILE *out, const int64_t counts[], double calls) {
+  int i;
+
+  fprintf(out, ", \"counters\": {");
+  for (i = 0; i < NUM_PERF_COUNTERS; i++)
+    {
+      fprintf(out, "%s\"%s\": ", i ? ", " : "", perfCounterName(i));
+      if (counts[i] < 0)
+	fprintf(out, "null");
+      else
+	fprintf(out, "%.2f", counts[i] / calls);
+    }
+  fprintf(out, ", \"ipc\": ");
+  if (counts[PERF_CYCLES] > 0 && counts[PERF_INSTRUCTIONS] >= 0)
+    fprintf(out, "%.3f", (double)counts[PERF_INSTRUCTIONS] / counts[PERF_CYCLES]);
+  else
+    fprintf(out, "null");
+  fprintf(out, "}");
+}
+
+static void measure(struct benchmark *b, int warmup, int repetitions,
+		    FILE *out, int first) {
+  static struct benchContext ctx;
+  double samples[MAX_REPETITIONS];
+  double sum = 0;
+  double median;
+  double start;
+  long iterations = 1;
+  int64_t counts[NUM_PERF_COUNTERS];
+  int r;
+
+  memset(&ctx, 0, sizeof(ctx));
+  defaultKingdom(ctx.kingdom);
+  ctx.param = b->param;
+  b->setup(&ctx);
+
+  //enough calls for a batch of about BATCH_NS, untimed state copies included
+  for (;;)
+    {
+      start = nowNs();
+      b->run(&ctx, iterations);
+      if (nowNs() - start >= BATCH_NS / 4)
+	break;
+      iterations *= 2;
+    }
+  iterations *= 4;
+
+  for (r = 0; r < warmup; r++)
+    b->run(&ctx, iterations);
+  resetPerfCounters(&counters);
+  for (r = 0; r < repetitions; r++)
+    {
+      samples[r] = b->run(&ctx, iterations) / iterations;
+      sum += samples[r];
+    }
+  readPerfCounters(&counters, counts);
+  qsort(samples, repetitions, sizeof(double), compareDoubles);
+  median = samples[repetitions / 2];
+
+  fprintf(out, "%s    {\"name\": \"%s\", \"iterations\": %ld, \"median_ns\": %.1f, "
+	  "\"p99_ns\": %.1f, \"min_ns\": %.1f, \"mean_ns\": %.1f",
+	  first ? "" : ",\n", b->name, iterations, median,
+	  samples[(99 * repetitions + 99) / 100 - 1], samples[0], sum / repetitions);
+  if (b->isGame)
+    fprintf(out, ", \"games_per_sec\": %.0f", 1e9 / median);
+  if (useCounters)
+    writeCounters(out, counts, (double)iterations * repetitions);
+  fprintf(out, "}");
+  fflush(out);
+}
+
+int main(int argc, char **argv) {
+  const char *output = NULL;
+  const char *prefix = "";
+  int repetitions = 50;
+  int warmup = 5;
+  int cpu = sched_getcpu();
+  cpu_set_t cpus;
+  FILE *out = stdout;
+  int first = 1;
+  int i;
+
+  for (i = 1; i < argc; i++)
+    {
+      if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+	repetitions = atoi(argv[++i]);
+      else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc)
+	warmup = atoi(argv[++i]);
+      else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc)
+	cpu = atoi(argv[++i]);
+      else if (strcmp(argv[i], "-p") == 0)
+	useCounters = 1;
+      else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+	output = argv[++i];
+      else if (argv[i][0] != '-')
+	prefix = argv[i];
+      else
+	break;
+    }
+  if (i < argc || repetitions < 1 || repetitions > MAX_REPETITIONS || warmup < 0)
+    {
+      printf("Usage: benchmark [-r repetitions] [-w warmup] [-c cpu] [-p] [-o file] [prefix]\n");
+      return EXIT_FAILURE;
+    }
+
+  CPU_ZERO(&cpus);
+  CPU_SET(cpu, &cpus);
+  if (cpu < 0 || sched_setaffinity(0, sizeof(cpus), &cpus) != 0)
+    {
+      fprintf(stderr, "Cannot pin to CPU %d, running unpinned\n", cpu);
+      cpu = -1;
+    }
+  if (output != NULL && (out = fopen(output, "w")) == NULL)
+    {
+      printf("Cannot create %s\n", output);
+      return EXIT_FAILURE;
+    }
+
+  counters.leader = -1;
+  for (i = 0; i < NUM_PERF_COUNTERS; i++)
+    counters.fd[i] = -1;
+  if (useCounters && openPerfCounters(&counters) < NUM_PERF_COUNTERS)
+    fprintf(stderr, "%s hardware counters available, missing ones are null\n",
+	    counters.leader < 0 ? "No" : "Not all");
+
+  registerBenchmarks();
+  fprintf(out, "{\n  \"cpu\": %d,\n  \"warmup\": %d,\n  \"repetitions\": %d,\n"
+	  "  \"benchmarks\": [\n", cpu, warmup, repetitions);
+  for (i = 0; i < numBenchmarks; i++)
+    {
+      if (strncmp(benchmarks[i].name, prefix, strlen(prefix)) != 0)
+	continue;
+      if (output != NULL)
+	printf("%s\n", benchmarks[i].name);
+      measure(&benchmarks[i], warmup, repetitions, out, first);
+      first = 0;
+    }
+  fprintf(out, "\n  ]\n}\n");
+  closePerfCounters(&counters);
+
+  if (out != stdout && fclose(out) != 0)
+    {
+      printf("Error writing %s\n", output);
+      return EXIT_FAILURE;
+    }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,158 @@
+#define _DEFAULT_SOURCE
+#include "checkpoint.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define CHECKPOINT_MAGIC "DOMCKPT"
+#define HEADER_SIZE (sizeof(CHECKPOINT_MAGIC) + 3 * 8)
+
+void initCheckpointBuffer(struct checkpointBuffer *buffer) {
+  memset(buffer, 0, sizeof(*buffer));
+}
+
+void freeCheckpointBuffer(struct checkpointBuffer *buffer) {
+  free(buffer->data);
+  initCheckpointBuffer(buffer);
+}
+
+int putCheckpointBytes(struct checkpointBuffer *buffer, const void *bytes,
+		       size_t length) {
+  unsigned char *grown;
+  size_t capacity;
+
+  if (buffer->length + length > buffer->capacity)
+    {
+      capacity = buffer->capacity ? buffer->capacity : 4096;
+      while (capacity < buffer->length + length)
+	capacity *= 2;
+      grown = realloc(buffer->data, capacity);
+      if (grown == NULL)
+	return -1;
+      buffer->data = grown;
+      buffer->capacity = capacity;
+    }
+  memcpy(buffer->data + buffer->length, bytes, length);
+  buffer->length += length;
+  return 0;
+}
+
+static void encodeWord(unsigned char *p, uint64_t word) {
+  int i;
+  for (i = 0; i < 8; i++)
+    p[i] = (unsigned char)(word >> (8 * i));
+}
+
+static uint64_t decodeWord(const unsigned char *p) {
+  uint64_t word = 0;
+  int i;
+  for (i = 0; i < 8; i++)
+    word |= (uint64_t)p[i] << (8 * i);
+  return word;
+}
+
+int putCheckpointWord(struct checkpointBuffer *buffer, uint64_t word) {
+  unsigned char p[8];
+  encodeWord(p, word);
+  return putCheckpointBytes(buffer, p, 8);
+}
+
+int getCheckpointBytes(struct checkpointBuffer *buffer, void *bytes,
+		       size_t length) {
+  if (buffer->offset + length > buffer->length)
+    return -1;
+  memcpy(bytes, buffer->data + buffer->offset, length);
+  buffer->offset += length;
+  return 0;
+}
+
+int getCheckpointWord(struct checkpointBuffer *buffer, uint64_t *word) {
+  unsigned char p[8];
+  if (getCheckpointBytes(buffer, p, 8) < 0)
+    return -1;
+  *word = decodeWord(p);
+  return 0;
+}
+
+/* FNV-1a */
+static uint64_t checksum(const unsigned char *data, size_t length) {
+  uint64_t h = 14695981039346656037ULL;
+  size_t i;
+  for (i = 0; i < length; i++)
+    {
+      h ^= data[i];
+      h *= 1099511628211ULL;
+    }
+  return h;
+}
+
+int writeCheckpoint(const char *path, const struct checkpointBuffer *buffer) {
+  unsigned char header[HEADER_SIZE];
+  char *tmp;
+  FILE *out;
+  int r = -1;
+
+  tmp = malloc(strlen(path) + 5);
+  if (tmp == NULL)
+    return -1;
+  sprintf(tmp, "%s.tmp", path);
+
+  memcpy(header, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+  encodeWord(header + sizeof(CHECKPOINT_MAGIC), CHECKPOINT_VERSION);
+  encodeWord(header + sizeof(CHECKPOINT_MAGIC) + 8, buffer->length);
+  encodeWord(header + sizeof(CHECKPOINT_MAGIC) + 16,
+	     checksum(buffer->data, buffer->length));
+
+  out = fopen(tmp, "wb");
+  if (out != NULL)
+    {
+      if (fwrite(header, 1, HEADER_SIZE, out) == HEADER_SIZE
+	  && fwrite(buffer->data, 1, buffer->length, out) == buffer->length
+	  && fflush(out) == 0 && fsync(fileno(out)) == 0)
+	r = 0;
+      if (fclose(out) != 0)
+	r = -1;
+      //the rename is the commit point
+      if (r == 0 && rename(tmp, path) != 0)
+	r = -1;
+      if (r < 0)
+	remove(tmp);
+    }
+  free(tmp);
+  return r;
+}
+
+int readCheckpoint(const char *path, struct checkpointBuffer *buffer) {
+  unsigned char header[HEADER_SIZE];
+  unsigned char *data;
+  uint64_t length;
+  FILE *in;
+  int r = -1;
+
+  in = fopen(path, "rb");
+  if (in == NULL)
+    return -1;
+  if (fread(header, 1, HEADER_SIZE, in) == HEADER_SIZE
+      && memcmp(header, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) == 0
+      && decodeWord(header + sizeof(CHECKPOINT_MAGIC)) == CHECKPOINT_VERSION)
+    {
+      length = decodeWord(header + sizeof(CHECKPOINT_MAGIC) + 8);
+      data = malloc(length ? length : 1);
+      if (data != NULL && fread(data, 1, length, in) == length
+	  && fgetc(in) == EOF
+	  && checksum(data, length) == decodeWord(header + sizeof(CHECKPOINT_MAGIC) + 16))
+	{
+	  free(buffer->data);
+	  buffer->data = data;
+	  buffer->length = length;
+	  buffer->capacity = length;
+	  buffer->offset = 0;
+	  r = 0;
+	}
+      else
+	free(data);
+    }
+  fclose(in);
+  return r;
+}
@@ -0,0 +1,43 @@
+#ifndef _CHECKPOINT_H
+#define _CHECKPOINT_H
+
+/* Crash-safe progress files for long simulations.
+
+   The caller encodes its progress into a checkpoint buffer as 64-bit
+   little-endian words and byte strings; writeCheckpoint stores it with
+   a length and checksum in a temporary file, syncs it, and renames it
+   over the previous checkpoint, so a crash at any moment leaves either
+   the old checkpoint or the new one, never a torn file. */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define CHECKPOINT_VERSION 1
+
+struct checkpointBuffer {
+  unsigned char *data;
+  size_t length;
+  size_t capacity;
+  size_t offset;              //read position
+};
+
+void initCheckpointBuffer(struct checkpointBuffer *buffer);
+void freeCheckpointBuffer(struct checkpointBuffer *buffer);
+
+int putCheckpointWord(struct checkpointBuffer *buffer, uint64_t word);
+int putCheckpointBytes(struct checkpointBuffer *buffer, const void *bytes,
+		       size_t length);
+
+int getCheckpointWord(struct checkpointBuffer *buffer, uint64_t *word);
+int getCheckpointBytes(struct checkpointBuffer *buffer, void *bytes,
+		       size_t length);
+/* Both -1 past the end of the buffer */
+
+int writeCheckpoint(const char *path, const struct checkpointBuffer *buffer);
+/* Atomically replaces path with the buffer's contents */
+
+int readCheckpoint(const char *path, struct checkpointBuffer *buffer);
+/* Loads a checkpoint for reading from the start; -1 if there is none
+   or it fails its checks */
+
+#endif
@@ -0,0 +1,262 @@
+/* Aggregates columnar game statistics files (see gamestats.h)
+
+   colstats file                        every column's min, mean and max
+   colstats file column                 distribution of column's values
+   colstats file column by groupColumn  column's mean, min and max for
+                                        each value of groupColumn
+
+   Each form reads only the columns it reports on, one or two scans per
+   column, straight from the mapped file. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "gamestats.h"
+
+#define MAX_DISTINCT 4096  /* wider ranges are shown in bins */
+#define BINS 20
+
+struct range {
+  long min;
+  long max;
+  double sum;
+};
+
+/* Values of column in group, or NULL after reporting the file bad */
+static const void* chunkOf(const struct statsFile *file, int column, long g) {
+  const void *chunk = statsChunk(file, column, g);
+  if (chunk == NULL)
+    printf("Row group %ld of %s lies outside the file\n", g,
+	   file->columns[column].name);
+  return chunk;
+}
+
+static int scanRange(const struct statsFile *file, int column,
+		     struct range *r) {
+  const void *chunk;
+  long g, i, rows;
+  long v;
+
+  r->min = 0;
+  r->max = 0;
+  r->sum = 0;
+  for (g = 0; g < (long)file->header->numGroups; g++)
+    {
+      if ((chunk = chunkOf(file, column, g)) == NULL)
+	return -1;
+      rows = statsGroupRows(file, g);
+      for (i = 0; i < rows; i++)
+	{
+	  v = statsValue(file, column, chunk, i);
+	  if ((g == 0 && i == 0) || v < r->min)
+	    r->min = v;
+	  if ((g == 0 && i == 0) || v > r->max)
+	    r->max = v;
+	  r->sum += v;
+	}
+    }
+  return 0;
+}
+
+/* Name of a value where the column has one, else NULL */
+static const char* valueName(const struct statsFile *file, int column,
+			     long v) {
+  if (strncmp(file->columns[column].name, "strategy", 8) == 0
+      && v >= 0 && v < (long)file->header->numStrategies)
+    return file->header->strategyNames[v];
+  return NULL;
+}
+
+static void printValue(const struct statsFile *file, int column, long v) {
+  const char *name = valueName(file, column, v);
+  if (name != NULL)
+    printf("%-16s", name);
+  else
+    printf("%-16ld", v);
+}
+
+static int summary(const struct statsFile *file) {
+  struct range r;
+  uint32_t c;
+  long n = (long)file->header->numRows;
+
+  printf("%ld games in %ld row groups of %u\n", n,
+	 (long)file->header->numGroups, file->header->rowGroupSize);
+  if (n == 0)
+    return 0;
+  printf("%-24s %12s %12s %12s\n", "column", "min", "mean", "max");
+  for (c = 0; c < file->header->numColumns; c++)
+    {
+      if (scanRange(file, c, &r) < 0)
+	return -1;
+      //card counts nobody owned would drown the rest
+      if (r.min == 0 && r.max == 0)
+	continue;
+      printf("%-24s %12ld %12.4f %12ld\n", file->columns[c].name, r.min,
+	     r.sum / n, r.max);
+    }
+  return 0;
+}
+
+static int distribution(const struct statsFile *file, int column) {
+  struct range r;
+  long *counts;
+  long buckets;
+  double width = 1;
+  char label[48];
+  const void *chunk;
+  long g, i, rows, b;
+  long n = (long)file->header->numRows;
+
+  if (n == 0)
+    return 0;
+  if (scanRange(file, column, &r) < 0)
+    return -1;
+  buckets = r.max - r.min + 1;
+  if (buckets > MAX_DISTINCT)
+    {
+      width = (double)buckets / BINS;
+      buckets = BINS;
+    }
+  counts = calloc(buckets, sizeof(long));
+  if (counts == NULL)
+    return -1;
+
+  for (g = 0; g < (long)file->header->numGroups; g++)
+    {
+      if ((chunk = chunkOf(file, column, g)) == NULL)
+	{
+	  free(counts);
+	  return -1;
+	}
+      rows = statsGroupRows(file, g);
+      for (i = 0; i < rows; i++)
+	{
+	  b = (long)((statsValue(file, column, chunk, i) - r.min) / width);
+	  counts[b < buckets ? b : buckets - 1]++;
+	}
+    }
+
+  printf("%s over %ld games: mean %.4f\n", file->columns[column].name, n, r.sum / n);
+  for (b = 0; b < buckets; b++)
+    {
+      if (counts[b] == 0)
+	continue;
+      if (width == 1)
+	printValue(file, column, r.min + b);
+      else
+	{
+	  snprintf(label, sizeof(label), "[%ld, %ld)", r.min + (long)(b * width),
+		   r.min + (long)((b + 1) * width));
+	  printf("%-16s", label);
+	}
+      printf(" %12ld %8.4f%%\n", counts[b], 100.0 * counts[b] / n);
+    }
+  free(counts);
+  return 0;
+}
+
+struct groupTotals {
+  long n;
+  double sum;
+  long min;
+  long max;
+};
+
+static int grouped(const struct statsFile *file, int column, int by) {
+  struct range r;
+  struct groupTotals *totals;
+  struct groupTotals *t;
+  const void *chunk;
+  const void *keys;
+  long g, i, rows, k;
+  long v;
+
+  if (file->header->numRows == 0)
+    return 0;
+  if (scanRange(file, by, &r) < 0)
+    return -1;
+  if (r.max - r.min + 1 > MAX_DISTINCT)
+    {
+      printf("%s has more than %d distinct values\n", file->columns[by].name, MAX_DISTINCT);
+      return -1;
+    }
+  totals = calloc(r.max - r.min + 1, sizeof(struct groupTotals));
+  if (totals == NULL)
+    return -1;
+
+  for (g = 0; g < (long)file->header->numGroups; g++)
+    {
+      if ((chunk = chunkOf(file, column, g)) == NULL
+	  || (keys = chunkOf(file, by, g)) == NULL)
+	{
+	  free(totals);
+	  return -1;
+	}
+      rows = statsGroupRows(file, g);
+      for (i = 0; i < rows; i++)
+	{
+	  v = statsValue(file, column, chunk, i);
+	  t = &totals[statsValue(file, by, keys, i) - r.min];
+	  if (t->n == 0 || v < t->min)
+	    t->min = v;
+	  if (t->n == 0 || v > t->max)
+	    t->max = v;
+	  t->n++;
+	  t->sum += v;
+	}
+    }
+
+  printf("%-16s %12s %12s %8s %8s\n", file->columns[by].name, "games",
+	 file->columns[column].name, "min", "max");
+  for (k = 0; k <= r.max - r.min; k++)
+    {
+      t = &totals[k];
+      if (t->n == 0)
+	continue;
+      printValue(file, by, r.min + k);
+      printf(" %12ld %12.4f %8ld %8ld\n", t->n, t->sum / t->n, t->min, t->max);
+    }
+  free(totals);
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  struct statsFile file;
+  int column = -1;
+  int by = -1;
+  int r;
+
+  if (argc != 2 && argc != 3 && !(argc == 5 && strcmp(argv[3], "by") == 0))
+    {
+      printf("Usage: colstats file [column [by groupColumn]]\n");
+      return EXIT_FAILURE;
+    }
+  if (openStatsFile(&file, argv[1]) < 0)
+    {
+      printf("Cannot open statistics file %s\n", argv[1]);
+      return EXIT_FAILURE;
+    }
+  if (argc > 2 && (column = statsColumnIndex(&file, argv[2])) < 0)
+    {
+      printf("No column %s\n", argv[2]);
+      closeStatsFile(&file);
+      return EXIT_FAILURE;
+    }
+  if (argc > 4 && (by = statsColumnIndex(&file, argv[4])) < 0)
+    {
+      printf("No column %s\n", argv[4]);
+      closeStatsFile(&file);
+      return EXIT_FAILURE;
+    }
+
+  if (argc == 2)
+    r = summary(&file);
+  else if (argc == 3)
+    r = distribution(&file, column);
+  else
+    r = grouped(&file, column, by);
+
+  closeStatsFile(&file);
+  return r < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
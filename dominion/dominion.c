@@ -1,9 +1,40 @@
 #include "dominion.h"
 #include "dominion_helpers.h"
 #include "rngs.h"
+#include "engineprofile.h"
 #include <stdio.h>
 #include <math.h>
 #include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+
+#ifdef ENGINE_PROFILE
+__thread struct engineFrames engineFrames;
+#endif
+
+#ifdef ENGINE_STATS
+static __thread struct engineStats engineStats;
+#define COUNT_STAT(counter) (engineStats.counter++)
+#define ADD_STAT(counter, n) (engineStats.counter += (n))
+#else
+#define COUNT_STAT(counter) ((void)0)
+#define ADD_STAT(counter, n) ((void)0)
+#endif
+
+int getEngineStats(struct engineStats *stats) {
+#ifdef ENGINE_STATS
+  *stats = engineStats;
+  return 0;
+#else
+  return -1;
+#endif
+}
+
+void resetEngineStats(void) {
+#ifdef ENGINE_STATS
+  memset(&engineStats, 0, sizeof(engineStats));
+#endif
+}
 
 int compare(const void* a, const void* b) {
   if (*(int*)a > *(int*)b)
@@ -36,14 +67,37 @@ int* kingdomCards(int k1, int k2, int k3, int k4, int k5, int k6, int k7,
 
 int initializeGame(int numPlayers, int kingdomCards[10], int randomSeed,
 		   struct gameState *state) {
+  return initializeGameStreams(numPlayers, kingdomCards, randomSeed,
+			       RNG_SHARED, state);
+}
 
+/* Seeds GAME_STREAM, and in RNG_PER_PLAYER mode every player's stream */
+static void seedStreams(int randomSeed, int rngMode) {
   int i;
-  int j;
-  int it;			
+  long seed;
   //set up random number generator
-  SelectStream(1);
+  SelectStream(GAME_STREAM);
   PutSeed((long)randomSeed);
-  
+  GetSeed(&seed);
+
+  //each player's stream sits a whole stream spacing past the previous one
+  if (rngMode == RNG_PER_PLAYER)
+    {
+      for (i = 0; i < MAX_PLAYERS; i++)
+	{
+	  SelectStream(PLAYER_STREAM_BASE + i);
+	  PutSeed(JumpSeed(seed, i + 1));
+	}
+      SelectStream(GAME_STREAM);
+    }
+}
+
+/* Everything initializeGame does that does not depend on the seed */
+static int setupGame(int numPlayers, int kingdomCards[10],
+		     struct gameState *state) {
+
+  int i;
+  int j;
   //check number of players
   if (numPlayers > MAX_PLAYERS || numPlayers < 2)
     {
@@ -66,6 +120,7 @@ int initializeGame(int numPlayers, int kingdomCards[10], int randomSeed,
     }
 
 
+
   //initialize supply
   ///////////////////////////////
 
@@ -150,15 +205,6 @@ int initializeGame(int numPlayers, int kingdomCards[10], int randomSeed,
 	}
     }
 
-  //shuffle player decks
-  for (i = 0; i < numPlayers; i++)
-    {
-      if ( shuffle(i, state) < 0 )
-	{
-	  return -1;
-	}
-    }
-
   //draw player hands
   for (i = 0; i < numPlayers; i++)
     {  
@@ -188,6 +234,23 @@ int initializeGame(int numPlayers, int kingdomCards[10], int randomSeed,
   state->handCount[state->whoseTurn] = 0;
   //int it; move to top
 
+  return 0;
+}
+
+/* Shuffles the starting decks and draws the first hand */
+static int dealGame(struct gameState *state) {
+  int i;
+  int it;
+
+  //shuffle player decks
+  for (i = 0; i < state->numPlayers; i++)
+    {
+      if ( shuffle(i, state) < 0 )
+	{
+	  return -1;
+	}
+    }
+
   //Moved draw cards to here, only drawing at the start of a turn
   for (it = 0; it < 5; it++){
     drawCard(state->whoseTurn, state);
@@ -198,7 +261,74 @@ int initializeGame(int numPlayers, int kingdomCards[10], int randomSeed,
   return 0;
 }
 
+int initializeGameStreams(int numPlayers, int kingdomCards[10],
+			  int randomSeed, int rngMode,
+			  struct gameState *state) {
+  ENGINE_FRAME(FRAME_SETUP);
+
+  seedStreams(randomSeed, rngMode);
+  state->rngMode = rngMode;
+  if (setupGame(numPlayers, kingdomCards, state) < 0)
+    {
+      return -1;
+    }
+  return dealGame(state);
+}
+
+int initGameTemplate(int numPlayers, int kingdomCards[10], int rngMode,
+		     struct gameTemplate *tmpl) {
+  memset(&tmpl->state, 0, sizeof(struct gameState));
+  tmpl->state.rngMode = rngMode;
+  return setupGame(numPlayers, kingdomCards, &tmpl->state);
+}
+
+int resetGame(const struct gameTemplate *tmpl, int randomSeed,
+	      struct gameState *state) {
+  ENGINE_FRAME(FRAME_SETUP);
+  const struct gameState *from = &tmpl->state;
+  int i;
+
+  //only what the game can see: the fields before the hands, the
+  //starting decks, and zero counts for everything else
+  memcpy(state, from, offsetof(struct gameState, hand));
+  for (i = 0; i < MAX_PLAYERS; i++)
+    {
+      state->handCount[i] = 0;
+      state->deckCount[i] = from->deckCount[i];
+      memcpy(state->deck[i], from->deck[i], from->deckCount[i] * sizeof(int));
+      state->discardCount[i] = 0;
+    }
+  state->playedCardCount = 0;
+  state->rngMode = from->rngMode;
+  seedStreams(randomSeed, state->rngMode);
+  return dealGame(state);
+}
+
+void saveRngPosition(struct rngPosition *position) {
+  int i;
+  SelectStream(GAME_STREAM);
+  GetSeed(&position->game);
+  for (i = 0; i < MAX_PLAYERS; i++)
+    {
+      SelectStream(PLAYER_STREAM_BASE + i);
+      GetSeed(&position->players[i]);
+    }
+  SelectStream(GAME_STREAM);
+}
+
+void restoreRngPosition(const struct rngPosition *position) {
+  int i;
+  for (i = 0; i < MAX_PLAYERS; i++)
+    {
+      SelectStream(PLAYER_STREAM_BASE + i);
+      PutSeed(position->players[i]);
+    }
+  SelectStream(GAME_STREAM);
+  PutSeed(position->game);
+}
+
 int shuffle(int player, struct gameState *state) {
+  ENGINE_FRAME(FRAME_SHUFFLE);
  
 
   int newDeck[MAX_DECK];
@@ -208,9 +338,14 @@ int shuffle(int player, struct gameState *state) {
 
   if (state->deckCount[player] < 1)
     return -1;
+  COUNT_STAT(shuffles);
+  ADD_STAT(shuffledCards, state->deckCount[player]);
   qsort ((void*)(state->deck[player]), state->deckCount[player], sizeof(int), compare); 
   /* SORT CARDS IN DECK TO ENSURE DETERMINISM! */
 
+  if (state->rngMode == RNG_PER_PLAYER)
+    SelectStream(PLAYER_STREAM_BASE + player);
+
   while (state->deckCount[player] > 0) {
     card = floor(Random() * state->deckCount[player]);
     newDeck[newDeckPos] = state->deck[player][card];
@@ -225,23 +360,29 @@ int shuffle(int player, struct gameState *state) {
     state->deckCount[player]++;
   }
 
+  if (state->rngMode == RNG_PER_PLAYER)
+    SelectStream(GAME_STREAM);
+
   return 0;
 }
 
 int playCard(int handPos, int choice1, int choice2, int choice3, struct gameState *state) 
 {	
+  ENGINE_FRAME(FRAME_PLAY);
   int card;
   int coin_bonus = 0; 		//tracks coins gain from actions
 
   //check if it is the right phase
   if (state->phase != 0)
     {
+      COUNT_STAT(playFailures[PLAY_WRONG_PHASE]);
       return -1;
     }
 	
   //check if player has enough actions
   if ( state->numActions < 1 )
     {
+      COUNT_STAT(playFailures[PLAY_NO_ACTIONS]);
       return -1;
     }
 	
@@ -251,12 +392,14 @@ int playCard(int handPos, int choice1, int choice2, int choice3, struct gameStat
   //check if selected card is an action
   if ( card < adventurer || card > treasure_map )
     {
+      COUNT_STAT(playFailures[PLAY_NOT_ACTION]);
       return -1;
     }
 	
   //play card
   if ( cardEffect(card, choice1, choice2, choice3, state, handPos, &coin_bonus) < 0 )
     {
+      COUNT_STAT(playFailures[PLAY_REJECTED]);
       return -1;
     }
 	
@@ -270,6 +413,7 @@ int playCard(int handPos, int choice1, int choice2, int choice3, struct gameStat
 }
 
 int buyCard(int supplyPos, struct gameState *state) {
+  ENGINE_FRAME(FRAME_BUY);
   int who;
   if (DEBUG){
     printf("Entering buyCard...\n");
@@ -280,14 +424,17 @@ int buyCard(int supplyPos, struct gameState *state) {
   who = state->whoseTurn;
 
   if (state->numBuys < 1){
+    COUNT_STAT(buyFailures[BUY_NO_BUYS]);
     if (DEBUG)
       printf("You do not have any buys left\n");
     return -1;
   } else if (supplyCount(supplyPos, state) <1){
+    COUNT_STAT(buyFailures[BUY_EMPTY_PILE]);
     if (DEBUG)
       printf("There are not any of that type of card left\n");
     return -1;
   } else if (state->coins < getCost(supplyPos)){
+    COUNT_STAT(buyFailures[BUY_TOO_EXPENSIVE]);
     if (DEBUG) 
       printf("You do not have enough money to buy that. You have %d coins.\n", state->coins);
     return -1;
@@ -348,6 +495,7 @@ int whoseTurn(struct gameState *state) {
 }
 
 int endTurn(struct gameState *state) {
+  ENGINE_FRAME(FRAME_END_TURN);
   int k;
   int i;
   int currentPlayer = whoseTurn(state);
@@ -415,6 +563,7 @@ int isGameOver(struct gameState *state) {
 }
 
 int scoreFor (int player, struct gameState *state) {
+  ENGINE_FRAME(FRAME_SCORE);
 
   int i;
   int score = 0;
@@ -441,7 +590,7 @@ int scoreFor (int player, struct gameState *state) {
     }
 
   //score from deck
-  for (i = 0; i < state->discardCount[player]; i++)
+  for (i = 0; i < state->deckCount[player]; i++)
     {
       if (state->deck[player][i] == curse) { score = score - 1; };
       if (state->deck[player][i] == estate) { score = score + 1; };
@@ -525,10 +674,12 @@ int getWinners(int players[MAX_PLAYERS], struct gameState *state) {
 int drawCard(int player, struct gameState *state)
 {	int count;
   int deckCounter;
+  ENGINE_FRAME(FRAME_DRAW);
   if (state->deckCount[player] <= 0){//Deck is empty
     
     //Step 1 Shuffle the discard pile back into a deck
     int i;
+    COUNT_STAT(reshuffles);
     //Move discard to deck
     for (i = 0; i < state->discardCount[player];i++){
       state->deck[player][i] = state->discard[player][i];
@@ -562,6 +713,7 @@ int drawCard(int player, struct gameState *state)
     state->hand[player][count] = state->deck[player][deckCounter - 1];//Add card to hand
     state->deckCount[player]--;
     state->handCount[player]++;//Increment hand count
+    COUNT_STAT(draws);
   }
 
   else{
@@ -575,6 +727,7 @@ int drawCard(int player, struct gameState *state)
     state->hand[player][count] = state->deck[player][deckCounter - 1];//Add card to the hand
     state->deckCount[player]--;
     state->handCount[player]++;//Increment hand count
+    COUNT_STAT(draws);
   }
 
   return 0;
@@ -645,6 +798,7 @@ int getCost(int cardNumber)
 
 int cardEffect(int card, int choice1, int choice2, int choice3, struct gameState *state, int handPos, int *bonus)
 {
+  ENGINE_FRAME(FRAME_CARD + card);
   int i;
   int j;
   int k;
@@ -661,7 +815,8 @@ int cardEffect(int card, int choice1, int choice2, int choice3, struct gameState
   if (nextPlayer > (state->numPlayers - 1)){
     nextPlayer = 0;
   }
-  
+  if (card >= curse && card <= treasure_map)
+    COUNT_STAT(plays[card]);
 	
   //uses switch to select card and perform actions
   switch( card ) 
@@ -1029,7 +1184,7 @@ int cardEffect(int card, int choice1, int choice2, int choice3, struct gameState
 	tributeRevealedCards[1] = -1;
       }
 
-      for (i = 0; i <= 2; i ++){
+      for (i = 0; i < 2; i ++){
 	if (tributeRevealedCards[i] == copper || tributeRevealedCards[i] == silver || tributeRevealedCards[i] == gold){//Treasure cards
 	  state->coins += 2;
 	}
@@ -1218,6 +1373,7 @@ int cardEffect(int card, int choice1, int choice2, int choice3, struct gameState
 			
       //no second treasure_map found in hand
       return -1;
+
     }
 	
   return -1;
@@ -1263,6 +1419,7 @@ int discardCard(int handPos, int currentPlayer, struct gameState *state, int tra
 
 int gainCard(int supplyPos, struct gameState *state, int toFlag, int player)
 {
+  ENGINE_FRAME(FRAME_GAIN);
   //Note: supplyPos is enum of choosen card
 	
   //check if supply pile is empty (0) or card is not used in game (-1)
@@ -1294,12 +1451,14 @@ int gainCard(int supplyPos, struct gameState *state, int toFlag, int player)
 	
   //decrease number in supply pile
   state->supplyCount[supplyPos]--;
+  COUNT_STAT(gains[supplyPos]);
 	 
   return 0;
 }
 
 int updateCoins(int player, struct gameState *state, int bonus)
 {
+  ENGINE_FRAME(FRAME_COINS);
   int i;
 	
   //reset coin count
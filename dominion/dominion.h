@@ -10,6 +10,13 @@
 
 #define DEBUG 0
 
+/* Random number streams (see rngs.h) used by the engine */
+#define GAME_STREAM 1           /* every shuffle when rngMode is RNG_SHARED */
+#define PLAYER_STREAM_BASE 16   /* player p shuffles from stream 16 + p */
+
+#define RNG_SHARED 0            /* legacy: all players share GAME_STREAM */
+#define RNG_PER_PLAYER 1        /* each player shuffles from its own stream */
+
 /* http://dominion.diehrstraits.com has card texts */
 /* http://dominion.isotropic.org has other stuff */
 
@@ -71,6 +78,13 @@ struct gameState {
   int discardCount[MAX_PLAYERS];
   int playedCards[MAX_DECK];
   int playedCardCount;
+  int rngMode; /* RNG_SHARED or RNG_PER_PLAYER */
+};
+
+/* Position of every stream a game draws from */
+struct rngPosition {
+  long game;                  /* GAME_STREAM */
+  long players[MAX_PLAYERS];  /* PLAYER_STREAM_BASE + p */
 };
 
 /* All functions return -1 on failure, and DO NOT CHANGE GAME STATE;
@@ -89,9 +103,37 @@ int initializeGame(int numPlayers, int kingdomCards[10], int randomSeed,
 
 Cards not in game should initialize supply position to -1 */
 
+int initializeGameStreams(int numPlayers, int kingdomCards[10],
+			  int randomSeed, int rngMode,
+			  struct gameState *state);
+/* As initializeGame, which uses RNG_SHARED.  With RNG_PER_PLAYER each
+   player's shuffles come from their own stream, seeded from randomSeed,
+   so one player's choices never change another player's draws */
+
+struct gameTemplate {
+  struct gameState state;     /* set up but not yet shuffled or dealt */
+};
+
+int initGameTemplate(int numPlayers, int kingdomCards[10], int rngMode,
+		     struct gameTemplate *tmpl);
+int resetGame(const struct gameTemplate *tmpl, int randomSeed,
+	      struct gameState *state);
+/* A template holds the supply and starting decks of one kingdom, player
+   count and rngMode, checked once by initGameTemplate.  resetGame then
+   starts each game by copying its live parts, seeding and dealing, and
+   leaves the same state as clearing the gameState and calling
+   initializeGameStreams up to every count: arrays past their counts
+   keep whatever they held */
+
+void saveRngPosition(struct rngPosition *position);
+void restoreRngPosition(const struct rngPosition *position);
+/* Together with the gameState, a saved position lets a game be resumed
+   exactly.  Restoring leaves GAME_STREAM selected, as initializeGame
+   does */
+
 int shuffle(int player, struct gameState *state);
 /* Assumes all cards are now in deck array (or hand/played):  discard is
- empty */
+ empty.  Leaves GAME_STREAM selected in RNG_PER_PLAYER mode */
 
 int playCard(int handPos, int choice1, int choice2, int choice3,
 	     struct gameState *state);
@@ -128,4 +170,29 @@ int getWinners(int players[MAX_PLAYERS], struct gameState *state);
 /* Set array position of each player who won (remember ties!) to
    1, others to 0 */
 
+/* Why buyCard and playCard refused a call */
+enum buyFailure {BUY_NO_BUYS, BUY_EMPTY_PILE, BUY_TOO_EXPENSIVE,
+		 NUM_BUY_FAILURES};
+enum playFailure {PLAY_WRONG_PHASE, PLAY_NO_ACTIONS, PLAY_NOT_ACTION,
+		  PLAY_REJECTED, /* by the card's effect */
+		  NUM_PLAY_FAILURES};
+
+struct engineStats {
+  long plays[treasure_map+1];      /* cardEffect calls per card */
+  long draws;                      /* cards drawn by drawCard */
+  long reshuffles;                 /* discards shuffled back by drawCard */
+  long shuffles;
+  long shuffledCards;              /* cards moved by those shuffles */
+  long gains[treasure_map+1];      /* cards taken from each pile */
+  long buyFailures[NUM_BUY_FAILURES];
+  long playFailures[NUM_PLAY_FAILURES];
+};
+
+int getEngineStats(struct engineStats *stats);
+void resetEngineStats(void);
+/* The engine counts its work per thread, so the counters cost no
+   locking, but only when compiled with -DENGINE_STATS; otherwise the
+   counting is compiled out and getEngineStats returns -1.  Counts are
+   this thread's since it started or last reset */
+
 #endif
@@ -0,0 +1,67 @@
+#ifndef _ENGINEPROFILE_H
+#define _ENGINEPROFILE_H
+
+/* Where the engine is, for the sampling profiler (see profiler.h).
+
+   Built with -DENGINE_PROFILE, the engine's entry points, each card's
+   effect and the simulator's game loop push a frame when they start
+   and pop it however they return, on a per-thread stack that a signal
+   handler can read at any moment.  Small helpers called in loops, like
+   isGameOver and discardCard, have no frame and count to their caller,
+   which keeps a profiling build within about 10% of a plain one.
+   Without the define ENGINE_FRAME compiles to nothing. */
+
+#include "dominion.h"
+
+enum engineFrame {
+  FRAME_GAME,
+  FRAME_BOT_TURN,
+  FRAME_SETUP,
+  FRAME_SHUFFLE,
+  FRAME_DRAW,
+  FRAME_PLAY,
+  FRAME_BUY,
+  FRAME_GAIN,
+  FRAME_END_TURN,
+  FRAME_COINS,
+  FRAME_SCORE,
+  FRAME_CARD,                   /* FRAME_CARD + card: that card's effect */
+  NUM_ENGINE_FRAMES = FRAME_CARD + treasure_map + 1
+};
+
+#define MAX_FRAME_DEPTH 8
+
+struct engineFrames {
+  volatile int depth;           /* frames past MAX_FRAME_DEPTH are not kept */
+  volatile unsigned char frame[MAX_FRAME_DEPTH];
+};
+
+#ifdef ENGINE_PROFILE
+
+extern __thread struct engineFrames engineFrames;
+
+static inline int enterEngineFrame(int frame) {
+  int depth = engineFrames.depth;
+
+  if (depth < MAX_FRAME_DEPTH)
+    engineFrames.frame[depth] = frame;
+  engineFrames.depth = depth + 1;
+  return frame;
+}
+
+static inline void leaveEngineFrame(int *frame) {
+  engineFrames.depth--;
+}
+
+/* At most one per block; popped when the block is left */
+#define ENGINE_FRAME(frame)						\
+  int engineFrame_ __attribute__((cleanup(leaveEngineFrame), unused))	\
+    = enterEngineFrame(frame)
+
+#else
+
+#define ENGINE_FRAME(frame) do {} while (0)
+
+#endif
+
+#endif
@@ -0,0 +1,484 @@
+/* Compares this engine with the forks under projects/
+
+   forkcmp [-n games] [-s seed] [-r repetitions] [-l limit] [recordFile]
+
+   Each fork's dominion.c and rngs.c are linked in as a separate copy
+   whose symbols carry the fork's name (see the Makefile), and all
+   engines are compiled with the same flags.  The corpus is the game
+   records in recordFile, or else n games (default 1000) of every
+   strategy pairing played on this engine and recorded, with seeds from
+   s (default 1).
+
+   Every game is replayed in lockstep: all engines are set up from the
+   record's seed and kingdom and given the same calls, and after each
+   call a fork's state is checked against this engine's.  The first
+   difference in a game, in a field or in scoreFor at the end, is that
+   fork's divergence for the game; the fork sits out the rest of it.
+   The report lists, per engine, the best of r timed replays of the
+   whole corpus (default 3) as games per second and relative to this
+   engine, the number of diverging games, and the first l (default 10)
+   divergences.  Forks predate RNG_PER_PLAYER, so records made with it
+   are replayed on this engine only. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "dominion.h"
+#include "gamerecord.h"
+#include "simulate.h"
+#include "strategy.h"
+
+#define MAX_DIFF 128
+
+/* The forks' gameState is this one without rngMode at the end */
+#define DECLARE_FORK(fork)						\
+  int fork##_initializeGame(int numPlayers, int kingdomCards[10],	\
+			    int randomSeed, struct gameState *state);	\
+  int fork##_playCard(int handPos, int choice1, int choice2,		\
+		      int choice3, struct gameState *state);		\
+  int fork##_buyCard(int supplyPos, struct gameState *state);		\
+  int fork##_endTurn(struct gameState *state);				\
+  int fork##_scoreFor(int player, struct gameState *state);
+
+#define ENGINE(prefix, name)						\
+  {name, prefix##initializeGame, prefix##playCard, prefix##buyCard,	\
+   prefix##endTurn, prefix##scoreFor}
+
+DECLARE_FORK(roberwen)
+DECLARE_FORK(wilsond3)
+
+struct engine {
+  const char *name;
+  int (*initializeGame)(int, int[10], int, struct gameState *);
+  int (*playCard)(int, int, int, int, struct gameState *);
+  int (*buyCard)(int, struct gameState *);
+  int (*endTurn)(struct gameState *);
+  int (*scoreFor)(int, struct gameState *);
+};
+
+static const struct engine engines[] = {
+  ENGINE(, "dominion"),         //the reference
+  ENGINE(roberwen_, "roberwen"),
+  ENGINE(wilsond3_, "wilsond3")
+};
+
+#define NUM_ENGINES (int)(sizeof(engines) / sizeof(engines[0]))
+
+struct corpusGame {
+  struct recordHeader header;
+  struct recordAction *actions;
+  int numActions;
+};
+
+struct corpus {
+  struct corpusGame *games;
+  int numGames;
+  int capacity;
+  long numActions;
+};
+
+struct engineReport {
+  double bestSeconds;
+  int diverged;
+  int compared;                 //games it could replay
+};
+
+static double nowSeconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Corpus */
+/* --------------------------------------------------------------- */
+
+static int addRecord(struct corpus *corpus, const unsigned char *data,
+		     size_t length) {
+  struct corpusGame *game;
+  struct corpusGame *grown;
+  size_t offset;
+  int capacity;
+
+  if (corpus->numGames == corpus->capacity)
+    {
+      capacity = corpus->capacity ? 2 * corpus->capacity : 256;
+      grown = realloc(corpus->games, capacity * sizeof(struct corpusGame));
+      if (grown == NULL)
+	return -1;
+      corpus->games = grown;
+      corpus->capacity = capacity;
+    }
+  game = &corpus->games[corpus->numGames];
+  memset(game, 0, sizeof(*game));
+  if (readRecordHeader(data, length, &game->header) < 0)
+    return -1;
+
+  //a record needs at least one byte per action
+  game->actions = malloc((length + 1) * sizeof(struct recordAction));
+  if (game->actions == NULL)
+    return -1;
+  offset = game->header.actionsOffset;
+  while (offset < length)
+    {
+      if (readAction(data, length, &offset, &game->actions[game->numActions]) < 0)
+	{
+	  free(game->actions);
+	  return -1;
+	}
+      game->numActions++;
+    }
+
+  corpus->numActions += game->numActions;
+  corpus->numGames++;
+  return 0;
+}
+
+static int loadCorpus(struct corpus *corpus, const char *path) {
+  struct gameRecord record;
+  FILE *in = fopen(path, "rb");
+
+  if (in == NULL)
+    return -1;
+  initGameRecord(&record);
+  while (readGameRecord(in, &record) == 0)
+    {
+      if (addRecord(corpus, record.data, record.length) < 0)
+	{
+	  printf("Record %d of %s is malformed\n", corpus->numGames, path);
+	  break;
+	}
+    }
+  freeGameRecord(&record);
+  fclose(in);
+  return 0;
+}
+
+/* Game g pits strategy g mod S against strategy (g / S) mod S */
+static int generateCorpus(struct corpus *corpus, int numGames, int firstSeed) {
+  static struct gameState state;
+  struct gameRecord record;
+  struct gameResult result;
+  int kingdom[10];
+  int ids[2];
+  int g;
+
+  defaultKingdom(kingdom);
+  initGameRecord(&record);
+  for (g = 0; g < numGames; g++)
+    {
+      ids[0] = g % numStrategies();
+      ids[1] = g / numStrategies() % numStrategies();
+      if (playRecordedGame(2, ids, kingdom, firstSeed + g, RNG_SHARED,
+			   &state, &result, &record) < 0
+	  || addRecord(corpus, record.data, record.length) < 0)
+	{
+	  freeGameRecord(&record);
+	  return -1;
+	}
+    }
+  freeGameRecord(&record);
+  return 0;
+}
+
+static void freeCorpus(struct corpus *corpus) {
+  int g;
+
+  for (g = 0; g < corpus->numGames; g++)
+    free(corpus->games[g].actions);
+  free(corpus->games);
+}
+
+/* Replay */
+/* --------------------------------------------------------------- */
+
+static int canReplay(const struct corpusGame *game, int e) {
+  return e == 0 || game->header.rngMode == RNG_SHARED;
+}
+
+static int setUp(int e, const struct corpusGame *game,
+		 struct gameState *state) {
+  int kingdom[10];
+
+  memcpy(kingdom, game->header.kingdom, sizeof(kingdom));
+  memset(state, 0, sizeof(struct gameState));
+  if (e == 0)
+    return initializeGameStreams(game->header.numPlayers, kingdom,
+				 game->header.seed, game->header.rngMode, state);
+  return engines[e].initializeGame(game->header.numPlayers, kingdom,
+				   game->header.seed, state);
+}
+
+static void apply(const struct engine *engine, const struct recordAction *action,
+		  struct gameState *state) {
+  switch (action->type)
+    {
+    case ACTION_END:
+      engine->endTurn(state);
+      break;
+    case ACTION_BUY:
+      engine->buyCard(action->card, state);
+      break;
+    case ACTION_PLAY:
+      engine->playCard(action->handPos, action->choice1, action->choice2,
+		       action->choice3, state);
+      break;
+    }
+}
+
+/* Seconds for the engine to replay the whole corpus */
+static double timeEngine(int e, const struct corpus *corpus) {
+  static struct gameState state;
+  const struct corpusGame *game;
+  double start = nowSeconds();
+  int g, a;
+
+  for (g = 0; g < corpus->numGames; g++)
+    {
+      game = &corpus->games[g];
+      if (!canReplay(game, e))
+	continue;
+      setUp(e, game, &state);
+      for (a = 0; a < game->numActions; a++)
+	apply(&engines[e], &game->actions[a], &state);
+    }
+  return nowSeconds() - start;
+}
+
+/* Comparison */
+/* --------------------------------------------------------------- */
+
+static int diffCards(const char *what, int player, const int *a, int countA,
+		     const int *b, int countB, char *diff) {
+  int i;
+
+  if (countA != countB)
+    {
+      snprintf(diff, MAX_DIFF, "%s count of player %d: %d vs %d", what, player,
+	       countA, countB);
+      return 1;
+    }
+  for (i = 0; i < countA; i++)
+    if (a[i] != b[i])
+      {
+	snprintf(diff, MAX_DIFF, "%s[%d] of player %d: %s vs %s", what, i,
+		 player, cardName(a[i]), cardName(b[i]));
+	return 1;
+      }
+  return 0;
+}
+
+#define DIFF_FIELD(field)						\
+  if (a->field != b->field)						\
+    {									\
+      snprintf(diff, MAX_DIFF, #field ": %d vs %d", a->field, b->field); \
+      return 1;								\
+    }
+
+/* Compares what the game can observe, not stale entries past the counts;
+   0 if a and b agree, otherwise 1 with the first difference in diff */
+static int diffStates(const struct gameState *a, const struct gameState *b,
+		      char *diff) {
+  int card;
+  int p;
+
+  DIFF_FIELD(numPlayers);
+  DIFF_FIELD(whoseTurn);
+  DIFF_FIELD(phase);
+  DIFF_FIELD(numActions);
+  DIFF_FIELD(coins);
+  DIFF_FIELD(numBuys);
+  DIFF_FIELD(outpostPlayed);
+  DIFF_FIELD(outpostTurn);
+  for (card = curse; card <= treasure_map; card++)
+    {
+      if (a->supplyCount[card] != b->supplyCount[card])
+	{
+	  snprintf(diff, MAX_DIFF, "supplyCount[%s]: %d vs %d", cardName(card),
+		   a->supplyCount[card], b->supplyCount[card]);
+	  return 1;
+	}
+      if (a->embargoTokens[card] != b->embargoTokens[card])
+	{
+	  snprintf(diff, MAX_DIFF, "embargoTokens[%s]: %d vs %d", cardName(card),
+		   a->embargoTokens[card], b->embargoTokens[card]);
+	  return 1;
+	}
+    }
+  for (p = 0; p < a->numPlayers; p++)
+    {
+      if (diffCards("hand", p, a->hand[p], a->handCount[p],
+		    b->hand[p], b->handCount[p], diff)
+	  || diffCards("deck", p, a->deck[p], a->deckCount[p],
+		       b->deck[p], b->deckCount[p], diff)
+	  || diffCards("discard", p, a->discard[p], a->discardCount[p],
+		       b->discard[p], b->discardCount[p], diff))
+	return 1;
+    }
+  return diffCards("playedCards", 0, a->playedCards, a->playedCardCount,
+		   b->playedCards, b->playedCardCount, diff);
+}
+
+static void describeAction(const struct recordAction *action,
+			   const struct gameState *before, char *text) {
+  switch (action->type)
+    {
+    case ACTION_END:
+      snprintf(text, MAX_DIFF, "player %d end turn", before->whoseTurn);
+      break;
+    case ACTION_BUY:
+      snprintf(text, MAX_DIFF, "player %d buy %s", before->whoseTurn,
+	       cardName(action->card));
+      break;
+    case ACTION_PLAY:
+      snprintf(text, MAX_DIFF, "player %d play %s (%d, %d, %d)",
+	       before->whoseTurn, cardName(before->hand[before->whoseTurn][action->handPos]),
+	       action->choice1, action->choice2, action->choice3);
+      break;
+    }
+}
+
+/* Replays every game through all engines at once and reports the first
+   divergence of each fork in each game */
+static void compareEngines(const struct corpus *corpus,
+			   struct engineReport reports[], int limit) {
+  static struct gameState states[NUM_ENGINES];
+  static struct gameState before;
+  const struct corpusGame *game;
+  int live[NUM_ENGINES];
+  char diff[MAX_DIFF];
+  char action[MAX_DIFF];
+  int listed = 0;
+  int turn;
+  int g, a, e, p;
+
+  for (g = 0; g < corpus->numGames; g++)
+    {
+      game = &corpus->games[g];
+      turn = 0;
+      for (e = 0; e < NUM_ENGINES; e++)
+	{
+	  live[e] = canReplay(game, e);
+	  if (!live[e])
+	    continue;
+	  reports[e].compared++;
+	  setUp(e, game, &states[e]);
+	}
+
+      for (a = -1; a < game->numActions; a++)
+	{
+	  if (a >= 0)
+	    {
+	      before = states[0];
+	      for (e = 0; e < NUM_ENGINES; e++)
+		if (live[e])
+		  apply(&engines[e], &game->actions[a], &states[e]);
+	      if (game->actions[a].type == ACTION_END)
+		turn++;
+	    }
+
+	  for (e = 1; e < NUM_ENGINES; e++)
+	    {
+	      if (!live[e] || !diffStates(&states[0], &states[e], diff))
+		continue;
+	      live[e] = 0;
+	      reports[e].diverged++;
+	      if (listed++ >= limit)
+		continue;
+	      if (a < 0)
+		strcpy(action, "setup");
+	      else
+		describeAction(&game->actions[a], &before, action);
+	      printf("%s: game %d (seed %d) action %d, turn %d, %s: %s\n",
+		     engines[e].name, g, game->header.seed, a, turn, action, diff);
+	    }
+	}
+
+      for (e = 1; e < NUM_ENGINES; e++)
+	for (p = 0; live[e] && p < game->header.numPlayers; p++)
+	  {
+	    int reference = engines[0].scoreFor(p, &states[0]);
+	    int score = engines[e].scoreFor(p, &states[e]);
+	    if (reference == score)
+	      continue;
+	    live[e] = 0;
+	    reports[e].diverged++;
+	    if (listed++ < limit)
+	      printf("%s: game %d (seed %d) end, turn %d, scoreFor(%d): %d vs %d\n",
+		     engines[e].name, g, game->header.seed, turn, p, reference, score);
+	  }
+    }
+}
+
+int main(int argc, char **argv) {
+  static struct corpus corpus;
+  struct engineReport reports[NUM_ENGINES];
+  const char *recordFile = NULL;
+  int numGames = 1000;
+  int firstSeed = 1;
+  int repetitions = 3;
+  int limit = 10;
+  double seconds;
+  int i, e, r;
+
+  for (i = 1; i < argc; i++)
+    {
+      if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+	numGames = atoi(argv[++i]);
+      else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+	firstSeed = atoi(argv[++i]);
+      else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+	repetitions = atoi(argv[++i]);
+      else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc)
+	limit = atoi(argv[++i]);
+      else if (argv[i][0] != '-' && recordFile == NULL)
+	recordFile = argv[i];
+      else
+	break;
+    }
+  if (i < argc || numGames < 1 || firstSeed < 1 || repetitions < 1 || limit < 0)
+    {
+      printf("Usage: forkcmp [-n games] [-s seed] [-r repetitions] [-l limit] [recordFile]\n");
+      return EXIT_FAILURE;
+    }
+
+  if (recordFile != NULL ? loadCorpus(&corpus, recordFile) < 0
+      : generateCorpus(&corpus, numGames, firstSeed) < 0)
+    {
+      printf("Cannot %s the corpus\n", recordFile != NULL ? "read" : "record");
+      return EXIT_FAILURE;
+    }
+  printf("Corpus: %d games, %ld actions\n", corpus.numGames, corpus.numActions);
+
+  memset(reports, 0, sizeof(reports));
+  compareEngines(&corpus, reports, limit);
+
+  //interleaved, so drifting machine load affects every engine alike
+  for (r = 0; r < repetitions; r++)
+    for (e = 0; e < NUM_ENGINES; e++)
+      {
+	seconds = timeEngine(e, &corpus);
+	if (r == 0 || seconds < reports[e].bestSeconds)
+	  reports[e].bestSeconds = seconds;
+      }
+
+  printf("\n%-10s %8s %12s %10s %10s\n", "engine", "games", "games/sec",
+	 "speed", "diverged");
+  for (e = 0; e < NUM_ENGINES; e++)
+    {
+      printf("%-10s %8d %12.0f ", engines[e].name, reports[e].compared,
+	     reports[e].compared / reports[e].bestSeconds);
+      //only comparable when both replayed the same games
+      if (reports[e].compared == reports[0].compared)
+	printf("%9.2fx ", reports[0].bestSeconds / reports[e].bestSeconds);
+      else
+	printf("%10s ", "-");
+      if (e == 0)
+	printf("%10s\n", "-");
+      else
+	printf("%10d\n", reports[e].diverged);
+    }
+
+  freeCorpus(&corpus);
+  return EXIT_SUCCESS;
+}
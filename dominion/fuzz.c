@@ -0,0 +1,780 @@
+/* In-process fuzzing of playCard, buyCard and endTurn
+
+   fuzz [-n runs] [-s seed] [-l maxLength] [-t timeout] [-x] [corpusDir]
+   fuzz input
+
+   An input is a compact byte string decoded into a game and the calls
+   made on it:
+
+     byte     numPlayers (2 + b % 3), RNG_PER_PLAYER if bit 7 is set
+     3 bytes  kingdom rank (see kingdomRank), modulo NUM_KINGDOMS
+     2 bytes  seed - 1
+     actions  one byte each, b % 8:
+              0-2  playCard of hand position (next byte), with the
+                   card's choices drawn from the bytes after it
+              3-4  buyCard of supply position (next byte % 27)
+              5-6  endTurn
+              7    a whole turn of a strategy bot (next byte), then endTurn
+
+   Past the end every byte reads as 0.  The engine's invariants are
+   checked after setup and after every call: counts in range, only real
+   cards in hands, decks, discards and played cards, unused piles still
+   unused, no more of any card than the game started with, and a call
+   that returns -1 has left the state untouched, as dominion.h promises.
+   Plays the engine would never return from, feast with nothing it can
+   gain and adventurer with fewer than two treasures to find, are
+   skipped rather than run.
+
+   LLVMFuzzerTestOneInput is the libFuzzer entry point (make
+   fuzz-libfuzzer, which needs clang); a failed check aborts and
+   libFuzzer keeps the input.  Built on its own, the file has a driver:
+   it replays every file in corpusDir, then runs n inputs (default
+   1000000) mutated from the corpus or random, adding to the corpus,
+   and to corpusDir, each input that reaches an action outcome none
+   before it did.  The first input to fail each check is written to
+   crash-<hash> and fuzzing goes on, unless -x makes it stop there; an
+   input running for t seconds (default 10) is written to timeout-<hash>
+   and ends the run.  Given a file rather than a directory, fuzz runs
+   that input alone and prints each call it makes. */
+
+#define _DEFAULT_SOURCE
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "dominion.h"
+#include "dominion_helpers.h"
+#include "simulate.h"
+#include "strategy.h"
+
+#define MAX_FUZZ_ACTIONS 4096
+#define NUM_CARDS (treasure_map + 1)
+
+struct fuzzInput {
+  const uint8_t *data;
+  size_t size;
+  size_t pos;
+};
+
+static int nextByte(struct fuzzInput *in) {
+  return in->pos < in->size ? in->data[in->pos++] : 0;
+}
+
+/* Failures */
+/* --------------------------------------------------------------- */
+
+enum fuzzCheck {
+  CHECK_SETUP, CHECK_PLAYERS, CHECK_TURN, CHECK_COUNTS, CHECK_CARDS,
+  CHECK_PILES, CHECK_CONSERVATION, CHECK_RESOURCES, CHECK_UNCHANGED,
+  NUM_CHECKS
+};
+
+static const char *checkNames[NUM_CHECKS] = {
+  "setup", "players", "turn", "counts", "cards", "piles", "conservation",
+  "resources", "unchanged"
+};
+
+static int abortOnFailure = 1;  //libFuzzer; the driver records instead
+static int failedCheck;
+static char failure[256];
+static int callCard = -1;       /* the card played or bought, if any */
+
+static int fail(int check, const char *call, const char *detail, long value) {
+  failedCheck = check;
+  snprintf(failure, sizeof(failure), "%s check after %s %s: %s %ld",
+	   checkNames[check], call, callCard >= 0 ? cardName(callCard) : "",
+	   detail, value);
+  if (abortOnFailure)
+    {
+      fprintf(stderr, "%s\n", failure);
+      abort();
+    }
+  return -1;
+}
+
+/* Invariants */
+/* --------------------------------------------------------------- */
+
+/* What a game keeps from its setup */
+struct fuzzStart {
+  int numPlayers;
+  int supplyCount[NUM_CARDS];
+  int totals[NUM_CARDS];        /* held and in the piles */
+};
+
+static int countCards(const int *cards, int count, int owned[NUM_CARDS]) {
+  int i;
+
+  for (i = 0; i < count; i++)
+    {
+      if (cards[i] < curse || cards[i] > treasure_map)
+	return -1;
+      owned[cards[i]]++;
+    }
+  return 0;
+}
+
+/* Every card a player holds, has played or is in a pile */
+static int cardTotals(const struct gameState *state, int totals[NUM_CARDS]) {
+  int p;
+
+  memset(totals, 0, NUM_CARDS * sizeof(int));
+  for (p = 0; p < state->numPlayers; p++)
+    if (countCards(state->hand[p], state->handCount[p], totals) < 0
+	|| countCards(state->deck[p], state->deckCount[p], totals) < 0
+	|| countCards(state->discard[p], state->discardCount[p], totals) < 0)
+      return -1;
+  return countCards(state->playedCards, state->playedCardCount, totals);
+}
+
+static int *packInts(int *to, const int *values, int count) {
+  memcpy(to, values, count * sizeof(int));
+  return to + count;
+}
+
+/* The parts of the state a game can see, packed into live: everything
+   up to the hands, then each hand, deck, discard and the played cards
+   up to its count.  Copying the whole 26K state before every call
+   would cost more than running the engine */
+static void packLiveState(const struct gameState *state, int *live) {
+  int *end = packInts(live, &state->numPlayers,
+		      (int)(offsetof(struct gameState, hand) / sizeof(int)));
+  int p;
+
+  for (p = 0; p < state->numPlayers; p++)
+    {
+      end = packInts(end, &state->handCount[p], 1);
+      end = packInts(end, state->hand[p], state->handCount[p]);
+      end = packInts(end, &state->deckCount[p], 1);
+      end = packInts(end, state->deck[p], state->deckCount[p]);
+      end = packInts(end, &state->discardCount[p], 1);
+      end = packInts(end, state->discard[p], state->discardCount[p]);
+    }
+  end = packInts(end, &state->playedCardCount, 1);
+  packInts(end, state->playedCards, state->playedCardCount);
+}
+
+static int matchInts(const int **live, const int *values, int count) {
+  if (memcmp(*live, values, count * sizeof(int)) != 0)
+    return 0;
+  *live += count;
+  return 1;
+}
+
+/* Whether state is the one packed into live, comparing each count
+   before the cards it counts, so a count out of range is never used */
+static int sameLiveState(const struct gameState *state, const int *live) {
+  int p;
+
+  if (!matchInts(&live, &state->numPlayers,
+		 (int)(offsetof(struct gameState, hand) / sizeof(int))))
+    return 0;
+  for (p = 0; p < state->numPlayers; p++)
+    if (!matchInts(&live, &state->handCount[p], 1)
+	|| !matchInts(&live, state->hand[p], state->handCount[p])
+	|| !matchInts(&live, &state->deckCount[p], 1)
+	|| !matchInts(&live, state->deck[p], state->deckCount[p])
+	|| !matchInts(&live, &state->discardCount[p], 1)
+	|| !matchInts(&live, state->discard[p], state->discardCount[p]))
+      return 0;
+  return matchInts(&live, &state->playedCardCount, 1)
+    && matchInts(&live, state->playedCards, state->playedCardCount);
+}
+
+static int checkState(const struct gameState *state, const struct fuzzStart *start,
+		      const char *call) {
+  int totals[NUM_CARDS];
+  int card;
+  int p;
+
+  if (state->numPlayers != start->numPlayers)
+    return fail(CHECK_PLAYERS, call, "numPlayers", state->numPlayers);
+  if (state->whoseTurn < 0 || state->whoseTurn >= state->numPlayers)
+    return fail(CHECK_TURN, call, "whoseTurn", state->whoseTurn);
+  for (p = 0; p < state->numPlayers; p++)
+    {
+      if (state->handCount[p] < 0 || state->handCount[p] > MAX_HAND)
+	return fail(CHECK_COUNTS, call, "handCount", state->handCount[p]);
+      if (state->deckCount[p] < 0 || state->deckCount[p] > MAX_DECK)
+	return fail(CHECK_COUNTS, call, "deckCount", state->deckCount[p]);
+      if (state->discardCount[p] < 0 || state->discardCount[p] > MAX_DECK)
+	return fail(CHECK_COUNTS, call, "discardCount", state->discardCount[p]);
+    }
+  if (state->playedCardCount < 0 || state->playedCardCount > MAX_DECK)
+    return fail(CHECK_COUNTS, call, "playedCardCount", state->playedCardCount);
+  if (cardTotals(state, totals) < 0)
+    return fail(CHECK_CARDS, call, "a card out of range with whoseTurn",
+		state->whoseTurn);
+
+  for (card = curse; card <= treasure_map; card++)
+    {
+      if (state->supplyCount[card] < -1
+	  || (start->supplyCount[card] == -1) != (state->supplyCount[card] == -1))
+	return fail(CHECK_PILES, call, cardName(card), state->supplyCount[card]);
+      //cards are trashed, never made
+      if (totals[card] + (state->supplyCount[card] > 0 ? state->supplyCount[card] : 0)
+	  > start->totals[card])
+	return fail(CHECK_CONSERVATION, call, cardName(card), totals[card]);
+    }
+
+  if (state->coins < 0)
+    return fail(CHECK_RESOURCES, call, "coins", state->coins);
+  if (state->numBuys < 0)
+    return fail(CHECK_RESOURCES, call, "numBuys", state->numBuys);
+  if (state->numActions < 0)
+    return fail(CHECK_RESOURCES, call, "numActions", state->numActions);
+  return 0;
+}
+
+/* Moves */
+/* --------------------------------------------------------------- */
+
+static int handPosition(const struct gameState *state, struct fuzzInput *in) {
+  int count = state->handCount[state->whoseTurn];
+  return count > 0 ? nextByte(in) % count : 0;
+}
+
+/* A card in hand other than the one at handPos, -1 if there is none */
+static int otherHandPosition(const struct gameState *state, int handPos,
+			     struct fuzzInput *in) {
+  int count = state->handCount[state->whoseTurn];
+  int pos;
+
+  if (count < 2)
+    return -1;
+  pos = nextByte(in) % (count - 1);
+  return pos < handPos ? pos : pos + 1;
+}
+
+static int treasuresToFind(const struct gameState *state, int player) {
+  int found = 0;
+  int i;
+
+  for (i = 0; i < state->deckCount[player]; i++)
+    found += state->deck[player][i] >= copper && state->deck[player][i] <= gold;
+  for (i = 0; i < state->discardCount[player]; i++)
+    found += state->discard[player][i] >= copper && state->discard[player][i] <= gold;
+  return found;
+}
+
+/* Choices for playing card, as the comments in dominion.h describe
+   them; -1 for a play the engine would not return from */
+static int chooseMove(struct gameState *state, int handPos, int card,
+		      struct fuzzInput *in, int choice[3]) {
+  int targets[NUM_CARDS];
+  int numTargets = 0;
+  int c;
+
+  choice[0] = choice[1] = choice[2] = -1;
+  switch (card)
+    {
+    case adventurer:
+      //it draws until it has found two
+      if (treasuresToFind(state, state->whoseTurn) < 2)
+	return -1;
+      break;
+    case feast:
+      //it retries the gain until it succeeds
+      for (c = curse; c <= treasure_map; c++)
+	if (state->supplyCount[c] > 0 && getCost(c) <= 5)
+	  targets[numTargets++] = c;
+      if (numTargets == 0)
+	return -1;
+      choice[0] = targets[nextByte(in) % numTargets];
+      break;
+    case mine:
+      if ((choice[0] = otherHandPosition(state, handPos, in)) < 0)
+	return -1;
+      choice[1] = copper + nextByte(in) % 3;
+      break;
+    case remodel:
+      if ((choice[0] = otherHandPosition(state, handPos, in)) < 0)
+	return -1;
+      choice[1] = nextByte(in) % NUM_CARDS;
+      break;
+    case baron:
+      choice[0] = nextByte(in) & 1;
+      break;
+    case minion:
+      c = nextByte(in);
+      choice[0] = c & 1;
+      choice[1] = c >> 1 & 1;
+      break;
+    case steward:
+      //trashing takes two other cards
+      choice[0] = 1 + nextByte(in) % 3;
+      choice[1] = otherHandPosition(state, handPos, in);
+      choice[2] = otherHandPosition(state, handPos, in);
+      if (choice[0] == 3 && (choice[1] < 0 || choice[1] == choice[2]))
+	choice[0] = 1;
+      break;
+    case ambassador:
+      if ((choice[0] = otherHandPosition(state, handPos, in)) < 0)
+	return -1;
+      choice[1] = nextByte(in) % 3;
+      break;
+    case embargo:
+      choice[0] = nextByte(in) % NUM_CARDS;
+      break;
+    case salvager:
+      if ((choice[0] = otherHandPosition(state, handPos, in)) < 0)
+	return -1;
+      break;
+    }
+  return 0;
+}
+
+/* Outcome of each action, for the driver to find new behavior by */
+static void (*observe)(int action, int card, int result, int turn) = NULL;
+static long numActions = 0;
+
+static int runInput(const uint8_t *data, size_t size) {
+  static struct gameState state;
+  static int before[sizeof(struct gameState) / sizeof(int)];
+  struct fuzzInput in = {data, size, 0};
+  struct botMemory memory;
+  struct fuzzStart start;
+  int kingdom[10];
+  int choice[3];
+  int numPlayers, rngMode, seed;
+  long rank;
+  int action, handPos, card, result;
+  int turn = 0;
+  const char *call;
+  int n;
+
+  if (size < 6)
+    return 0;
+  numPlayers = 2 + nextByte(&in) % 3;
+  rngMode = data[0] & 0x80 ? RNG_PER_PLAYER : RNG_SHARED;
+  rank = nextByte(&in);
+  rank = rank << 8 | nextByte(&in);
+  rank = rank << 8 | nextByte(&in);
+  kingdomUnrank(rank % NUM_KINGDOMS, kingdom);
+  seed = nextByte(&in);
+  seed = (seed << 8 | nextByte(&in)) + 1;
+
+  callCard = -1;
+  memset(&state, 0, sizeof(state));
+  if (initializeGameStreams(numPlayers, kingdom, seed, rngMode, &state) < 0)
+    return fail(CHECK_SETUP, "initializeGame", "seed", seed);
+  start.numPlayers = state.numPlayers;
+  memcpy(start.supplyCount, state.supplyCount, sizeof(start.supplyCount));
+  if (cardTotals(&state, start.totals) < 0)
+    return fail(CHECK_CARDS, "initializeGame", "seed", seed);
+  for (card = curse; card <= treasure_map; card++)
+    if (state.supplyCount[card] > 0)
+      start.totals[card] += state.supplyCount[card];
+  if (checkState(&state, &start, "initializeGame") < 0)
+    return -1;
+
+  for (n = 0; n < MAX_FUZZ_ACTIONS && in.pos < in.size; n++)
+    {
+      action = nextByte(&in) % 8;
+      card = -1;
+      //checkState has already kept the counts in range
+      if (action <= 4)
+	packLiveState(&state, before);
+      if (action <= 2)
+	{
+	  handPos = handPosition(&state, &in);
+	  card = state.handCount[state.whoseTurn] > 0 ? handCard(handPos, &state) : -1;
+	  if (card < adventurer || chooseMove(&state, handPos, card, &in, choice) < 0)
+	    continue;
+	  result = playCard(handPos, choice[0], choice[1], choice[2], &state);
+	}
+      else if (action <= 4)
+	{
+	  card = nextByte(&in) % NUM_CARDS;
+	  result = buyCard(card, &state);
+	}
+      else if (action <= 6)
+	{
+	  result = endTurn(&state);
+	  turn++;
+	}
+      else
+	{
+	  card = nextByte(&in) % numStrategies();
+	  memset(&memory, 0, sizeof(memory));
+	  getStrategy(card)->playTurn(state.whoseTurn, &state, &memory);
+	  result = endTurn(&state);
+	  turn++;
+	}
+
+      callCard = action <= 4 ? card : -1;
+      call = action <= 2 ? "playCard" : action <= 4 ? "buyCard" : "endTurn";
+      //a refusal that changed nothing cannot have broken anything
+      if (result >= 0 || !sameLiveState(&state, before))
+	{
+	  if (checkState(&state, &start, call) < 0)
+	    return -1;
+	  if (result < 0)
+	    return fail(CHECK_UNCHANGED, call, "result", result);
+	}
+      numActions++;
+      if (observe != NULL)
+	observe(action, card, result, turn);
+    }
+  return 0;
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  runInput(data, size);
+  return 0;
+}
+
+#ifndef LIBFUZZER
+
+/* Driver */
+/* --------------------------------------------------------------- */
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+
+#define FEATURE_BITS 16
+#define MAX_CORPUS 65536
+#define MAX_LENGTH 4096
+
+struct corpusEntry {
+  uint8_t *data;
+  size_t size;
+};
+
+static struct corpusEntry corpus[MAX_CORPUS];
+static int corpusSize = 0;
+static const char *corpusDir = NULL;
+
+static uint8_t features[1 << (FEATURE_BITS - 3)];
+static int newFeatures;
+static long numFeatures = 0;
+
+//what the watchdog writes out if an input never returns
+static volatile long executions = 0;
+static const uint8_t *volatile current;
+static volatile size_t currentSize;
+static int timeout = 10;
+
+static uint64_t rngState;
+
+static uint64_t nextRandom(void) {
+  //xorshift64*, apart from the engine's generator
+  rngState ^= rngState >> 12;
+  rngState ^= rngState << 25;
+  rngState ^= rngState >> 27;
+  return rngState * 0x2545f4914f6cdd1dULL;
+}
+
+static uint64_t hashBytes(const uint8_t *data, size_t size) {
+  uint64_t h = 14695981039346656037ULL;
+  size_t i;
+
+  for (i = 0; i < size; i++)
+    h = (h ^ data[i]) * 1099511628211ULL;
+  return h;
+}
+
+static void observeOutcome(int action, int card, int result, int turn) {
+  uint64_t key = ((uint64_t)action << 24 | (uint64_t)(card + 1) << 16
+		  | (uint64_t)(result < 0) << 8 | (turn < 31 ? turn : 31));
+  unsigned bit = (unsigned)((key * 0x9e3779b97f4a7c15ULL) >> (64 - FEATURE_BITS));
+
+  if (!(features[bit >> 3] & 1 << (bit & 7)))
+    {
+      features[bit >> 3] |= 1 << (bit & 7);
+      numFeatures++;
+      newFeatures = 1;
+    }
+}
+
+/* Writes prefix-<hash> in dir, or the current directory for NULL;
+   open and write only, so the watchdog can use it too */
+static void saveInput(const char *dir, const char *prefix,
+		      const uint8_t *data, size_t size) {
+  static const char hex[] = "0123456789abcdef";
+  char path[4096];
+  uint64_t h = hashBytes(data, size);
+  size_t n = 0;
+  int fd;
+  int i;
+
+  if (dir != NULL)
+    {
+      while (dir[n] != '\0' && n < sizeof(path) - 64)
+	{
+	  path[n] = dir[n];
+	  n++;
+	}
+      path[n++] = '/';
+    }
+  for (i = 0; prefix[i] != '\0'; i++)
+    path[n++] = prefix[i];
+  for (i = 60; i >= 0; i -= 4)
+    path[n++] = hex[h >> i & 15];
+  path[n] = '\0';
+
+  fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+    return;
+  if (write(fd, data, size) < 0)
+    size = 0;
+  close(fd);
+}
+
+static void watchdog(int signum) {
+  static long lastExecutions = -1;
+  static int stuck = 0;
+  static const char message[] = "Timeout: input written to timeout-<hash>\n";
+
+  if (executions != lastExecutions)
+    {
+      lastExecutions = executions;
+      stuck = 0;
+    }
+  else if (++stuck >= timeout)
+    {
+      saveInput(NULL, "timeout-", current, currentSize);
+      if (write(STDOUT_FILENO, message, sizeof(message) - 1) < 0)
+	_exit(2);
+      _exit(2);
+    }
+  alarm(1);
+}
+
+static void addToCorpus(const uint8_t *data, size_t size, int save) {
+  if (corpusSize == MAX_CORPUS || (corpus[corpusSize].data = malloc(size)) == NULL)
+    return;
+  memcpy(corpus[corpusSize].data, data, size);
+  corpus[corpusSize].size = size;
+  corpusSize++;
+  if (save && corpusDir != NULL)
+    saveInput(corpusDir, "", data, size);
+}
+
+static const char *actionNames[] = {
+  "playCard", "playCard", "playCard", "buyCard", "buyCard", "endTurn",
+  "endTurn", "bot turn"
+};
+
+static void traceOutcome(int action, int card, int result, int turn) {
+  printf("turn %d: %s", turn - (action >= 5), actionNames[action]);
+  if (action == 7)
+    printf(" %s", getStrategy(card)->name);
+  else if (card >= 0)
+    printf(" %s", cardName(card));
+  printf(" = %d\n", result);
+}
+
+static int runFile(const char *path) {
+  static uint8_t buffer[MAX_LENGTH];
+  FILE *in = fopen(path, "rb");
+  size_t size;
+
+  if (in == NULL)
+    {
+      printf("Cannot read %s\n", path);
+      return EXIT_FAILURE;
+    }
+  size = fread(buffer, 1, sizeof(buffer), in);
+  fclose(in);
+  observe = traceOutcome;
+  if (runInput(buffer, size) < 0)
+    {
+      printf("%s\n", failure);
+      return EXIT_FAILURE;
+    }
+  printf("OK\n");
+  return EXIT_SUCCESS;
+}
+
+static void loadCorpus(const char *dir) {
+  static uint8_t buffer[MAX_LENGTH];
+  char path[4096];
+  struct dirent *entry;
+  DIR *d = opendir(dir);
+  FILE *in;
+  size_t size;
+
+  if (d == NULL)
+    return;
+  while ((entry = readdir(d)) != NULL)
+    {
+      if (entry->d_name[0] == '.')
+	continue;
+      snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+      if ((in = fopen(path, "rb")) == NULL)
+	continue;
+      size = fread(buffer, 1, sizeof(buffer), in);
+      fclose(in);
+      addToCorpus(buffer, size, 0);
+    }
+  closedir(d);
+}
+
+static size_t mutate(uint8_t *data, size_t size, size_t maxLength) {
+  const struct corpusEntry *other;
+  size_t at, n;
+  int rounds = 1 + nextRandom() % 4;
+
+  while (rounds-- > 0)
+    {
+      at = size > 0 ? nextRandom() % size : 0;
+      switch (nextRandom() % 6)
+	{
+	case 0:
+	  if (size > 0)
+	    data[at] ^= 1 << (nextRandom() % 8);
+	  break;
+	case 1:
+	  if (size > 0)
+	    data[at] = (uint8_t)nextRandom();
+	  break;
+	case 2:
+	  //insert a byte
+	  if (size < maxLength)
+	    {
+	      memmove(data + at + 1, data + at, size - at);
+	      data[at] = (uint8_t)nextRandom();
+	      size++;
+	    }
+	  break;
+	case 3:
+	  //erase a few
+	  n = 1 + nextRandom() % 4;
+	  if (at + n <= size && size - n >= 6)
+	    {
+	      memmove(data + at, data + at + n, size - at - n);
+	      size -= n;
+	    }
+	  break;
+	case 4:
+	  //append more actions
+	  while (size < maxLength && nextRandom() % 8 != 0)
+	    data[size++] = (uint8_t)nextRandom();
+	  break;
+	case 5:
+	  //splice in the actions of another input
+	  other = &corpus[nextRandom() % corpusSize];
+	  if (other->size > 6 && at >= 6)
+	    {
+	      n = other->size - 6;
+	      if (at + n > maxLength)
+		n = maxLength - at;
+	      memcpy(data + at, other->data + 6, n);
+	      size = at + n;
+	    }
+	  break;
+	}
+    }
+  return size;
+}
+
+int main(int argc, char **argv) {
+  static uint8_t input[MAX_LENGTH];
+  int failures[NUM_CHECKS] = {0};
+  long runs = 1000000;
+  long seed = time(NULL);
+  size_t maxLength = 64;
+  size_t size;
+  int stopAtFailure = 0;
+  DIR *corpusDirectory = NULL;
+  int numFailures = 0;
+  struct timespec start, end;
+  double seconds;
+  long run;
+  int i;
+
+  for (i = 1; i < argc; i++)
+    {
+      if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+	runs = atol(argv[++i]);
+      else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+	seed = atol(argv[++i]);
+      else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc)
+	maxLength = atol(argv[++i]);
+      else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+	timeout = atoi(argv[++i]);
+      else if (strcmp(argv[i], "-x") == 0)
+	stopAtFailure = 1;
+      else if (argv[i][0] != '-' && corpusDir == NULL)
+	corpusDir = argv[i];
+      else
+	break;
+    }
+  if (i < argc || runs < 0 || maxLength < 6 || maxLength > MAX_LENGTH || timeout < 1)
+    {
+      printf("Usage: fuzz [-n runs] [-s seed] [-l maxLength] [-t timeout] [-x] [corpusDir]\n"
+	     "       fuzz input\n");
+      return EXIT_FAILURE;
+    }
+
+  abortOnFailure = 0;
+  if (corpusDir != NULL && (corpusDirectory = opendir(corpusDir)) == NULL)
+    return runFile(corpusDir);
+  if (corpusDirectory != NULL)
+    closedir(corpusDirectory);
+  observe = observeOutcome;
+  rngState = (uint64_t)seed * 0x9e3779b97f4a7c15ULL | 1;
+  signal(SIGALRM, watchdog);
+  alarm(1);
+  if (corpusDir != NULL)
+    loadCorpus(corpusDir);
+  printf("Seed %ld, %d corpus inputs\n", seed, corpusSize);
+  //the watchdog leaves without flushing
+  fflush(stdout);
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (run = -corpusSize; run < runs; run++)
+    {
+      //the corpus first, then mutants of it or fresh random inputs
+      if (run < 0)
+	{
+	  size = corpus[run + corpusSize].size;
+	  memcpy(input, corpus[run + corpusSize].data, size);
+	}
+      else if (corpusSize > 0 && nextRandom() % 16 != 0)
+	{
+	  const struct corpusEntry *parent = &corpus[nextRandom() % corpusSize];
+	  memcpy(input, parent->data, parent->size);
+	  size = mutate(input, parent->size, maxLength);
+	}
+      else
+	{
+	  size = 6 + nextRandom() % (maxLength - 5);
+	  for (i = 0; i < (int)size; i++)
+	    input[i] = (uint8_t)nextRandom();
+	}
+
+      current = input;
+      currentSize = size;
+      newFeatures = 0;
+      if (runInput(input, size) < 0 && failures[failedCheck]++ == 0)
+	{
+	  printf("%s\n", failure);
+	  fflush(stdout);
+	  saveInput(NULL, "crash-", input, size);
+	  numFailures++;
+	  if (stopAtFailure)
+	    break;
+	}
+      if (newFeatures && run >= 0)
+	addToCorpus(input, size, 1);
+      executions++;
+    }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  seconds = end.tv_sec - start.tv_sec + (end.tv_nsec - start.tv_nsec) * 1e-9;
+
+  printf("%ld executions in %.1f s, %.0f per second, %.0f calls per second; "
+	 "corpus %d inputs, %ld outcomes\n", executions, seconds,
+	 executions / seconds, numActions / seconds, corpusSize, numFeatures);
+  for (i = 0; i < NUM_CHECKS; i++)
+    if (failures[i] > 0)
+      printf("%s check failed by %d inputs\n", checkNames[i], failures[i]);
+  return numFailures > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+#endif
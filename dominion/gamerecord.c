@@ -0,0 +1,357 @@
+#include "gamerecord.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define OPERAND_ESCAPE 31
+
+void initGameRecord(struct gameRecord *record) {
+  record->data = NULL;
+  record->length = 0;
+  record->capacity = 0;
+}
+
+void freeGameRecord(struct gameRecord *record) {
+  free(record->data);
+  initGameRecord(record);
+}
+
+static int putByte(struct gameRecord *record, unsigned char b) {
+  unsigned char *grown;
+  size_t capacity;
+
+  if (record->length == record->capacity)
+    {
+      capacity = record->capacity ? record->capacity * 2 : 128;
+      grown = realloc(record->data, capacity);
+      if (grown == NULL)
+	return -1;
+      record->data = grown;
+      record->capacity = capacity;
+    }
+  record->data[record->length++] = b;
+  return 0;
+}
+
+int putVarint(struct gameRecord *record, unsigned long value) {
+  while (value >= 0x80)
+    {
+      if (putByte(record, (unsigned char)(value | 0x80)) < 0)
+	return -1;
+      value >>= 7;
+    }
+  return putByte(record, (unsigned char)value);
+}
+
+int getVarint(const unsigned char *data, size_t length, size_t *offset,
+	      unsigned long *value) {
+  unsigned long result = 0;
+  int shift = 0;
+  unsigned char b;
+
+  do
+    {
+      if (*offset >= length || shift > 63)
+	return -1;
+      b = data[(*offset)++];
+      result |= (unsigned long)(b & 0x7f) << shift;
+      shift += 7;
+    }
+  while (b & 0x80);
+
+  *value = result;
+  return 0;
+}
+
+static unsigned long zigzag(int n) {
+  long v = n;
+  return ((unsigned long)v << 1) ^ (unsigned long)(v >> (sizeof(long) * 8 - 1));
+}
+
+static int unzigzag(unsigned long u) {
+  return (int)(long)((u >> 1) ^ -(long)(u & 1));
+}
+
+int putSignedVarint(struct gameRecord *record, int value) {
+  return putVarint(record, zigzag(value));
+}
+
+int getSignedVarint(const unsigned char *data, size_t length, size_t *offset,
+		    int *value) {
+  unsigned long u;
+
+  if (getVarint(data, length, offset, &u) < 0)
+    return -1;
+  *value = unzigzag(u);
+  return 0;
+}
+
+int beginGameRecord(struct gameRecord *record, int numPlayers,
+		    int kingdom[10], int seed, int rngMode) {
+  unsigned long mask = 0;
+  int i;
+
+  if (numPlayers < 2 || numPlayers > MAX_PLAYERS || seed < 1)
+    return -1;
+  for (i = 0; i < 10; i++)
+    {
+      if (kingdom[i] < adventurer || kingdom[i] > treasure_map)
+	return -1;
+      mask |= 1UL << (kingdom[i] - adventurer);
+    }
+
+  record->length = 0;
+  if (putByte(record, RECORD_VERSION) < 0
+      || putByte(record, (unsigned char)(numPlayers | (rngMode << 4))) < 0
+      || putVarint(record, (unsigned long)seed) < 0
+      || putVarint(record, mask) < 0)
+    return -1;
+  return 0;
+}
+
+static int putAction(struct gameRecord *record, int op, int operand) {
+  if (operand >= 0 && operand < OPERAND_ESCAPE)
+    return putByte(record, (unsigned char)(op << 5 | operand));
+  if (putByte(record, (unsigned char)(op << 5 | OPERAND_ESCAPE)) < 0)
+    return -1;
+  return putVarint(record, zigzag(operand));
+}
+
+int recordedPlayCard(struct gameRecord *record, int handPos, int choice1,
+		     int choice2, int choice3, struct gameState *state) {
+  int card;
+  int r;
+
+  //handCard does not check the position
+  if (handPos < 0 || handPos >= numHandCards(state))
+    return -1;
+  card = handCard(handPos, state);
+
+  //mirrors the checks playCard makes before calling cardEffect
+  if (record == NULL || state->phase != 0 || state->numActions < 1
+      || card < adventurer || card > treasure_map)
+    return playCard(handPos, choice1, choice2, choice3, state);
+
+  r = playCard(handPos, choice1, choice2, choice3, state);
+
+  if (choice1 == -1 && choice2 == -1 && choice3 == -1)
+    {
+      putAction(record, ACTION_PLAY, handPos);
+    }
+  else
+    {
+      putAction(record, ACTION_PLAY_EX, handPos);
+      putVarint(record, zigzag(choice1));
+      putVarint(record, zigzag(choice2));
+      putVarint(record, zigzag(choice3));
+    }
+  return r;
+}
+
+int recordedBuyCard(struct gameRecord *record, int supplyPos,
+		    struct gameState *state) {
+  int r = buyCard(supplyPos, state);
+  if (r == 0 && record != NULL)
+    putAction(record, ACTION_BUY, supplyPos);
+  return r;
+}
+
+int recordedEndTurn(struct gameRecord *record, struct gameState *state) {
+  int r = endTurn(state);
+  if (record != NULL)
+    putAction(record, ACTION_END, 0);
+  return r;
+}
+
+int readRecordHeader(const unsigned char *data, size_t length,
+		     struct recordHeader *header) {
+  size_t offset = 2;
+  unsigned long seed;
+  unsigned long mask;
+  int count = 0;
+  int i;
+
+  if (length < 2 || data[0] != RECORD_VERSION)
+    return -1;
+  header->numPlayers = data[1] & 0x0f;
+  header->rngMode = data[1] >> 4;
+  if (getVarint(data, length, &offset, &seed) < 0
+      || getVarint(data, length, &offset, &mask) < 0
+      || (header->rngMode != RNG_SHARED && header->rngMode != RNG_PER_PLAYER)
+      || mask >> (treasure_map - adventurer + 1) != 0)
+    return -1;
+  header->seed = (int)seed;
+
+  for (i = 0; i <= treasure_map - adventurer; i++)
+    {
+      if (mask & (1UL << i))
+	{
+	  if (count == 10)
+	    return -1;
+	  header->kingdom[count++] = adventurer + i;
+	}
+    }
+  if (count != 10)
+    return -1;
+
+  header->actionsOffset = offset;
+  return 0;
+}
+
+int startReplay(const unsigned char *data, size_t length,
+		struct recordHeader *header, struct gameState *state) {
+  if (readRecordHeader(data, length, header) < 0)
+    return -1;
+  memset(state, 0, sizeof(struct gameState));
+  return initializeGameStreams(header->numPlayers, header->kingdom,
+			       header->seed, header->rngMode, state);
+}
+
+int readAction(const unsigned char *data, size_t length, size_t *offset,
+	       struct recordAction *action) {
+  unsigned long u;
+  int operand;
+
+  if (*offset >= length)
+    return -1;
+  memset(action, 0, sizeof(*action));
+  action->type = data[*offset] >> 5;
+  action->card = -1;
+  action->choice1 = action->choice2 = action->choice3 = -1;
+  operand = data[*offset] & OPERAND_ESCAPE;
+  (*offset)++;
+  if (operand == OPERAND_ESCAPE)
+    {
+      if (getVarint(data, length, offset, &u) < 0)
+	return -1;
+      operand = unzigzag(u);
+    }
+
+  switch (action->type)
+    {
+    case ACTION_END:
+      break;
+    case ACTION_BUY:
+      if (operand < curse || operand > treasure_map)
+	return -1;
+      action->card = operand;
+      break;
+    case ACTION_PLAY_EX:
+      if (getVarint(data, length, offset, &u) < 0)
+	return -1;
+      action->choice1 = unzigzag(u);
+      if (getVarint(data, length, offset, &u) < 0)
+	return -1;
+      action->choice2 = unzigzag(u);
+      if (getVarint(data, length, offset, &u) < 0)
+	return -1;
+      action->choice3 = unzigzag(u);
+      /* fall through */
+    case ACTION_PLAY:
+      if (operand < 0 || operand >= MAX_HAND)
+	return -1;
+      action->type = ACTION_PLAY;
+      action->handPos = operand;
+      break;
+    default:
+      return -1;
+    }
+  return 0;
+}
+
+int replayActions(const unsigned char *data, size_t length, size_t *offset,
+		  long maxTurns, struct gameState *state,
+		  replayFn callback, void *ctx) {
+  struct recordAction action;
+  int count = 0;
+
+  while (*offset < length && maxTurns != 0)
+    {
+      if (readAction(data, length, offset, &action) < 0)
+	return -1;
+
+      switch (action.type)
+	{
+	case ACTION_END:
+	  endTurn(state);
+	  if (maxTurns > 0)
+	    maxTurns--;
+	  break;
+	case ACTION_BUY:
+	  buyCard(action.card, state);
+	  break;
+	case ACTION_PLAY:
+	  //a position past the hand means the record is not this game's
+	  if (action.handPos >= numHandCards(state))
+	    return -1;
+	  action.card = handCard(action.handPos, state);
+	  playCard(action.handPos, action.choice1, action.choice2,
+		   action.choice3, state);
+	  break;
+	}
+
+      count++;
+      if (callback != NULL && callback(&action, state, ctx) != 0)
+	break;
+    }
+
+  return count;
+}
+
+int replayGameRecord(const unsigned char *data, size_t length,
+		     struct gameState *state, replayFn callback, void *ctx) {
+  struct recordHeader header;
+  size_t offset;
+
+  if (startReplay(data, length, &header, state) < 0)
+    return -1;
+  offset = header.actionsOffset;
+  return replayActions(data, length, &offset, -1, state, callback, ctx);
+}
+
+int writeGameRecord(FILE *out, const struct gameRecord *record) {
+  unsigned char prefix[10];
+  size_t n = 0;
+  size_t len = record->length;
+
+  do
+    {
+      prefix[n++] = (unsigned char)((len & 0x7f) | (len >= 0x80 ? 0x80 : 0));
+      len >>= 7;
+    }
+  while (len > 0);
+
+  if (fwrite(prefix, 1, n, out) != n
+      || fwrite(record->data, 1, record->length, out) != record->length)
+    return -1;
+  return 0;
+}
+
+int readGameRecord(FILE *in, struct gameRecord *record) {
+  unsigned long len = 0;
+  int shift = 0;
+  int c;
+  unsigned char *grown;
+
+  do
+    {
+      c = fgetc(in);
+      if (c == EOF || shift > 63)
+	return -1;
+      len |= (unsigned long)(c & 0x7f) << shift;
+      shift += 7;
+    }
+  while (c & 0x80);
+
+  if (len > record->capacity)
+    {
+      grown = realloc(record->data, len);
+      if (grown == NULL)
+	return -1;
+      record->data = grown;
+      record->capacity = len;
+    }
+  if (fread(record->data, 1, len, in) != len)
+    return -1;
+  record->length = len;
+  return 0;
+}
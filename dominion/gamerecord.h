@@ -0,0 +1,127 @@
+#ifndef _GAMERECORD_H
+#define _GAMERECORD_H
+
+/* Compact binary game records.
+
+   A record is the seed, player count, stream mode and kingdom, followed
+   by the calls made into the engine, so replaying it through
+   initializeGameStreams, playCard, buyCard and endTurn rebuilds every
+   state of the game.  Layout:
+
+     byte     RECORD_VERSION
+     byte     numPlayers | rngMode << 4
+     varint   seed
+     varint   kingdom as a bit mask, bit i for card adventurer + i
+     actions  one byte each, opcode in the top 3 bits, operand below:
+              ACTION_END      end turn
+              ACTION_BUY      buyCard(operand)
+              ACTION_PLAY     playCard(operand, -1, -1, -1)
+              ACTION_PLAY_EX  playCard(operand, c1, c2, c3), choices
+                              follow as zigzag varints
+              A play operand of 31 means the hand position follows as a
+              varint.
+
+   Files hold any number of records, each preceded by its varint length. */
+
+#include <stddef.h>
+#include <stdio.h>
+#include "dominion.h"
+
+#define RECORD_VERSION 1
+
+#define ACTION_END 0
+#define ACTION_BUY 1
+#define ACTION_PLAY 2
+#define ACTION_PLAY_EX 3
+
+struct gameRecord {
+  unsigned char *data;
+  size_t length;
+  size_t capacity;
+};
+
+struct recordHeader {
+  int numPlayers;
+  int rngMode;
+  int seed;
+  int kingdom[10];
+  size_t actionsOffset;  //where the action stream starts in the record
+};
+
+struct recordAction {
+  int type;              //ACTION_END, ACTION_BUY or ACTION_PLAY
+  int card;              //supply position bought, or card played
+  int handPos;
+  int choice1;
+  int choice2;
+  int choice3;
+};
+
+typedef int (*replayFn)(const struct recordAction *action,
+			struct gameState *state, void *ctx);
+/* Called after each replayed action; return non-zero to stop replay */
+
+void initGameRecord(struct gameRecord *record);
+void freeGameRecord(struct gameRecord *record);
+
+int beginGameRecord(struct gameRecord *record, int numPlayers,
+		    int kingdom[10], int seed, int rngMode);
+/* Clears the record and writes its header */
+
+int recordedPlayCard(struct gameRecord *record, int handPos, int choice1,
+		     int choice2, int choice3, struct gameState *state);
+/* playCard, logging the call.  Calls that playCard rejects before
+   touching the state (wrong phase, no actions, not an action card) are
+   not logged, and a handPos outside the hand returns -1 without calling
+   playCard.  record may be NULL */
+
+int recordedBuyCard(struct gameRecord *record, int supplyPos,
+		    struct gameState *state);
+/* buyCard, logging successful buys; record may be NULL */
+
+int recordedEndTurn(struct gameRecord *record, struct gameState *state);
+/* endTurn, logging the call; record may be NULL */
+
+int readRecordHeader(const unsigned char *data, size_t length,
+		     struct recordHeader *header);
+
+int startReplay(const unsigned char *data, size_t length,
+		struct recordHeader *header, struct gameState *state);
+/* Reads the header and initializes state from it */
+
+int readAction(const unsigned char *data, size_t length, size_t *offset,
+	       struct recordAction *action);
+/* Decodes the action at *offset and moves past it without running it,
+   for replaying through something other than this engine.  A play's
+   card is left -1, since only the state knows it.  -1 on a malformed
+   action, including a buy of no card and a hand position past
+   MAX_HAND */
+
+int replayActions(const unsigned char *data, size_t length, size_t *offset,
+		  long maxTurns, struct gameState *state,
+		  replayFn callback, void *ctx);
+/* Re-executes actions from *offset until the record ends, the callback
+   asks to stop, or maxTurns end-turn actions have run (maxTurns < 0 for
+   no limit).  *offset is left after the last action run.  Returns the
+   number of actions replayed, -1 on a malformed record or a play from
+   past the end of the hand */
+
+int replayGameRecord(const unsigned char *data, size_t length,
+		     struct gameState *state, replayFn callback, void *ctx);
+/* Whole-game replay: startReplay then replayActions to the end */
+
+int writeGameRecord(FILE *out, const struct gameRecord *record);
+/* Appends the record to a record file */
+
+int readGameRecord(FILE *in, struct gameRecord *record);
+/* Next record of a record file; 0 on success, -1 at end or on error */
+
+int putVarint(struct gameRecord *record, unsigned long value);
+int getVarint(const unsigned char *data, size_t length, size_t *offset,
+	      unsigned long *value);
+int putSignedVarint(struct gameRecord *record, int value);
+int getSignedVarint(const unsigned char *data, size_t length, size_t *offset,
+		    int *value);
+/* Zigzag varints, as choices are stored */
+
+#endif
@@ -0,0 +1,420 @@
+#define _DEFAULT_SOURCE
+#include "gamestats.h"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define FIRST_STRATEGY_COLUMN 7
+#define FIRST_SCORE_COLUMN (FIRST_STRATEGY_COLUMN + MAX_PLAYERS)
+#define FIRST_CARD_COLUMN (FIRST_SCORE_COLUMN + MAX_PLAYERS)
+
+static const uint32_t typeWidth[] = {1, 2, 4, 4};
+
+static size_t padded(size_t bytes) {
+  return (bytes + 7) & ~(size_t)7;
+}
+
+void fillStatsRow(struct statsRow *row, int numPlayers,
+		  const int strategyIds[], int kingdom[10], int seed,
+		  int rngMode, struct gameState *state,
+		  struct gameResult *result) {
+  int p, i;
+
+  memset(row, 0, sizeof(struct statsRow));
+  row->seed = seed;
+  memcpy(row->kingdom, kingdom, sizeof(row->kingdom));
+  row->numPlayers = numPlayers;
+  row->rngMode = rngMode;
+  row->turns = result->turns;
+  row->finished = result->finished;
+  for (p = 0; p < MAX_PLAYERS; p++)
+    row->strategies[p] = STATS_NO_PLAYER;
+
+  //one pass over each player's cards rather than fullDeckCount per card
+  for (p = 0; p < numPlayers; p++)
+    {
+      row->strategies[p] = strategyIds[p];
+      row->winners[p] = result->winners[p];
+      row->scores[p] = result->scores[p];
+      for (i = 0; i < state->deckCount[p]; i++)
+	row->cards[p][state->deck[p][i]]++;
+      for (i = 0; i < state->handCount[p]; i++)
+	row->cards[p][state->hand[p][i]]++;
+      for (i = 0; i < state->discardCount[p]; i++)
+	row->cards[p][state->discard[p][i]]++;
+    }
+}
+
+static void setColumn(struct statsColumnInfo *column, const char *name,
+		      int type) {
+  memset(column, 0, sizeof(*column));
+  snprintf(column->name, STATS_NAME_LENGTH, "%s", name);
+  column->type = type;
+  column->width = typeWidth[type];
+}
+
+static void buildSchema(struct statsColumnInfo columns[STATS_NUM_COLUMNS]) {
+  char name[STATS_NAME_LENGTH];
+  int p, card;
+
+  setColumn(&columns[0], "seed", STATS_I32);
+  setColumn(&columns[1], "kingdom", STATS_U32);
+  setColumn(&columns[2], "players", STATS_U8);
+  setColumn(&columns[3], "rng_mode", STATS_U8);
+  setColumn(&columns[4], "turns", STATS_I16);
+  setColumn(&columns[5], "finished", STATS_U8);
+  setColumn(&columns[6], "winners", STATS_U8);
+  for (p = 0; p < MAX_PLAYERS; p++)
+    {
+      snprintf(name, sizeof(name), "strategy%d", p);
+      setColumn(&columns[FIRST_STRATEGY_COLUMN + p], name, STATS_U8);
+      snprintf(name, sizeof(name), "score%d", p);
+      setColumn(&columns[FIRST_SCORE_COLUMN + p], name, STATS_I16);
+      for (card = curse; card <= treasure_map; card++)
+	{
+	  snprintf(name, sizeof(name), "p%d_%s", p, cardName(card));
+	  setColumn(&columns[FIRST_CARD_COLUMN + p * (treasure_map + 1) + card],
+		    name, STATS_U8);
+	}
+    }
+}
+
+static long rowValue(const struct statsRow *row, int column) {
+  long mask = 0;
+  int i;
+
+  switch (column)
+    {
+    case 0: return row->seed;
+    case 1:
+      for (i = 0; i < 10; i++)
+	mask |= 1L << (row->kingdom[i] - adventurer);
+      return mask;
+    case 2: return row->numPlayers;
+    case 3: return row->rngMode;
+    case 4: return row->turns;
+    case 5: return row->finished;
+    case 6:
+      for (i = 0; i < MAX_PLAYERS; i++)
+	if (row->winners[i])
+	  mask |= 1L << i;
+      return mask;
+    }
+  if (column < FIRST_SCORE_COLUMN)
+    return row->strategies[column - FIRST_STRATEGY_COLUMN];
+  if (column < FIRST_CARD_COLUMN)
+    return row->scores[column - FIRST_SCORE_COLUMN];
+  column -= FIRST_CARD_COLUMN;
+  return row->cards[column / (treasure_map + 1)][column % (treasure_map + 1)];
+}
+
+static void storeValue(unsigned char *p, int type, long value) {
+  uint8_t u8;
+  int16_t i16;
+  int32_t i32;
+  uint32_t u32;
+
+  switch (type)
+    {
+    case STATS_U8:
+      u8 = (uint8_t)value;
+      *p = u8;
+      break;
+    case STATS_I16:
+      i16 = (int16_t)value;
+      memcpy(p, &i16, 2);
+      break;
+    case STATS_I32:
+      i32 = (int32_t)value;
+      memcpy(p, &i32, 4);
+      break;
+    default:
+      u32 = (uint32_t)value;
+      memcpy(p, &u32, 4);
+      break;
+    }
+}
+
+static int writeBytes(struct statsWriter *writer, const void *data,
+		      size_t length) {
+  static const unsigned char zeros[8];
+  size_t pad = padded(length) - length;
+
+  if (fwrite(data, 1, length, writer->out) != length
+      || fwrite(zeros, 1, pad, writer->out) != pad)
+    return -1;
+  writer->offset += length + pad;
+  return 0;
+}
+
+static void writeHeader(struct statsFileHeader *header,
+			const struct statsWriter *writer, uint64_t footer) {
+  int i;
+
+  memset(header, 0, sizeof(*header));
+  strncpy(header->magic, STATS_MAGIC, sizeof(header->magic));
+  header->version = STATS_VERSION;
+  header->numColumns = STATS_NUM_COLUMNS;
+  header->rowGroupSize = writer->rowGroupSize;
+  header->numStrategies = numStrategies();
+  header->numRows = writer->numRows;
+  header->numGroups = writer->numGroups;
+  header->footerOffset = footer;
+  for (i = 0; i < numStrategies() && i < MAX_STRATEGIES; i++)
+    strncpy(header->strategyNames[i], getStrategy(i)->name, STATS_NAME_LENGTH - 1);
+}
+
+int openStatsWriter(struct statsWriter *writer, const char *path,
+		    int rowGroupSize) {
+  struct statsFileHeader header;
+  uint32_t start = 0;
+  int c;
+
+  if (rowGroupSize < 0)
+    return -1;
+  memset(writer, 0, sizeof(*writer));
+  writer->rowGroupSize = rowGroupSize ? rowGroupSize : STATS_DEFAULT_GROUP;
+  buildSchema(writer->columns);
+  for (c = 0; c < STATS_NUM_COLUMNS; c++)
+    {
+      writer->columnStart[c] = start;
+      start += writer->columns[c].width;
+    }
+
+  writer->group = malloc((size_t)writer->rowGroupSize * start);
+  writer->out = fopen(path, "wb");
+  if (writer->group == NULL || writer->out == NULL)
+    {
+      if (writer->out != NULL)
+	fclose(writer->out);
+      free(writer->group);
+      writer->out = NULL;
+      return -1;
+    }
+
+  writeHeader(&header, writer, 0);
+  if (writeBytes(writer, &header, sizeof(header)) < 0
+      || writeBytes(writer, writer->columns, sizeof(writer->columns)) < 0)
+    {
+      fclose(writer->out);
+      free(writer->group);
+      writer->out = NULL;
+      return -1;
+    }
+  return 0;
+}
+
+static int flushGroup(struct statsWriter *writer) {
+  uint64_t *grown;
+  uint64_t capacity;
+  int c;
+
+  if (writer->rows == 0)
+    return 0;
+  if (writer->numGroups == writer->capacity)
+    {
+      capacity = writer->capacity ? writer->capacity * 2 : 64;
+      grown = realloc(writer->groupOffsets, capacity * sizeof(uint64_t));
+      if (grown == NULL)
+	return -1;
+      writer->groupOffsets = grown;
+      writer->capacity = capacity;
+    }
+  writer->groupOffsets[writer->numGroups++] = writer->offset;
+
+  for (c = 0; c < STATS_NUM_COLUMNS; c++)
+    if (writeBytes(writer,
+		   writer->group + (size_t)writer->rowGroupSize * writer->columnStart[c],
+		   (size_t)writer->rows * writer->columns[c].width) < 0)
+      return -1;
+  writer->rows = 0;
+  return 0;
+}
+
+int statsAppend(struct statsWriter *writer, const struct statsRow *row) {
+  int c;
+
+  for (c = 0; c < STATS_NUM_COLUMNS; c++)
+    storeValue(writer->group + (size_t)writer->rowGroupSize * writer->columnStart[c]
+	       + (size_t)writer->rows * writer->columns[c].width,
+	       writer->columns[c].type, rowValue(row, c));
+  writer->rows++;
+  writer->numRows++;
+  if (writer->rows == writer->rowGroupSize)
+    return flushGroup(writer);
+  return 0;
+}
+
+int closeStatsWriter(struct statsWriter *writer) {
+  struct statsFileHeader header;
+  uint64_t footer;
+  int r = 0;
+
+  if (flushGroup(writer) < 0)
+    r = -1;
+  footer = writer->offset;
+  writeHeader(&header, writer, footer);
+  if (r < 0
+      || writeBytes(writer, writer->groupOffsets, writer->numGroups * sizeof(uint64_t)) < 0
+      || fseek(writer->out, 0, SEEK_SET) != 0
+      || fwrite(&header, sizeof(header), 1, writer->out) != 1)
+    r = -1;
+  if (fclose(writer->out) != 0)
+    r = -1;
+  free(writer->group);
+  free(writer->groupOffsets);
+  writer->group = NULL;
+  writer->groupOffsets = NULL;
+  return r;
+}
+
+/* Whether the row count matches the groups and every group's columns
+   lie between the column table and the footer, so statsChunk never
+   reads past the mapping */
+static int validGroups(const struct statsFile *file, size_t columnsEnd) {
+  const struct statsFileHeader *header = file->header;
+  uint64_t g;
+  uint64_t offset;
+  long rows;
+  uint32_t c;
+
+  if (header->rowGroupSize == 0
+      || header->numGroups != header->numRows / header->rowGroupSize
+      + (header->numRows % header->rowGroupSize != 0))
+    return 0;
+  for (g = 0; g < header->numGroups; g++)
+    {
+      offset = file->groupOffsets[g];
+      if (offset < columnsEnd || offset > header->footerOffset)
+	return 0;
+      rows = statsGroupRows(file, (long)g);
+      for (c = 0; c < header->numColumns; c++)
+	{
+	  offset += padded((size_t)rows * file->columns[c].width);
+	  if (offset > header->footerOffset)
+	    return 0;
+	}
+    }
+  return 1;
+}
+
+int openStatsFile(struct statsFile *file, const char *path) {
+  const struct statsFileHeader *header;
+  struct stat st;
+  void *base;
+  size_t columnsEnd;
+  uint32_t c;
+  int fd;
+
+  memset(file, 0, sizeof(*file));
+  fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return -1;
+  if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(struct statsFileHeader))
+    {
+      close(fd);
+      return -1;
+    }
+  base = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED)
+    return -1;
+
+  file->base = base;
+  file->size = st.st_size;
+  header = base;
+  columnsEnd = padded(sizeof(struct statsFileHeader))
+    + header->numColumns * sizeof(struct statsColumnInfo);
+  if (strncmp(header->magic, STATS_MAGIC, sizeof(header->magic)) != 0
+      || header->version != STATS_VERSION
+      || header->numColumns > file->size / sizeof(struct statsColumnInfo)
+      || columnsEnd > file->size
+      || header->footerOffset > file->size
+      || header->numGroups > (file->size - header->footerOffset) / sizeof(uint64_t))
+    {
+      closeStatsFile(file);
+      return -1;
+    }
+  file->header = header;
+  file->columns = (const struct statsColumnInfo*)
+    (file->base + padded(sizeof(struct statsFileHeader)));
+  file->groupOffsets = (const uint64_t*)(file->base + header->footerOffset);
+  for (c = 0; c < header->numColumns; c++)
+    if (file->columns[c].type > STATS_U32
+	|| file->columns[c].width != typeWidth[file->columns[c].type])
+      {
+	closeStatsFile(file);
+	return -1;
+      }
+  if (!validGroups(file, columnsEnd))
+    {
+      closeStatsFile(file);
+      return -1;
+    }
+  return 0;
+}
+
+void closeStatsFile(struct statsFile *file) {
+  if (file->base != NULL)
+    munmap((void*)file->base, file->size);
+  memset(file, 0, sizeof(*file));
+}
+
+int statsColumnIndex(const struct statsFile *file, const char *name) {
+  uint32_t c;
+  for (c = 0; c < file->header->numColumns; c++)
+    if (strncmp(file->columns[c].name, name, STATS_NAME_LENGTH) == 0)
+      return (int)c;
+  return -1;
+}
+
+long statsGroupRows(const struct statsFile *file, long group) {
+  long size = file->header->rowGroupSize;
+  long rows = (long)file->header->numRows - group * size;
+
+  if (group < 0 || (uint64_t)group >= file->header->numGroups)
+    return 0;
+  return rows < size ? rows : size;
+}
+
+const void* statsChunk(const struct statsFile *file, int column,
+		       long group) {
+  long rows = statsGroupRows(file, group);
+  size_t offset;
+  int c;
+
+  if (rows == 0 || column < 0 || (uint32_t)column >= file->header->numColumns)
+    return NULL;
+  offset = file->groupOffsets[group];
+  for (c = 0; c < column; c++)
+    offset += padded((size_t)rows * file->columns[c].width);
+  if (offset + (size_t)rows * file->columns[column].width > file->size)
+    return NULL;
+  return file->base + offset;
+}
+
+long statsValue(const struct statsFile *file, int column,
+		const void *chunk, long row) {
+  const unsigned char *p = chunk;
+  int16_t i16;
+  int32_t i32;
+  uint32_t u32;
+
+  switch (file->columns[column].type)
+    {
+    case STATS_U8:
+      return p[row];
+    case STATS_I16:
+      memcpy(&i16, p + 2 * row, 2);
+      return i16;
+    case STATS_I32:
+      memcpy(&i32, p + 4 * row, 4);
+      return i32;
+    default:
+      memcpy(&u32, p + 4 * row, 4);
+      return u32;
+    }
+}
@@ -0,0 +1,131 @@
+#ifndef _GAMESTATS_H
+#define _GAMESTATS_H
+
+/* Columnar per-game statistics files.
+
+   One row per game, stored column by column in row groups so a scan
+   reads only the columns it uses, as packed fixed-width integers with
+   nothing to parse.  Layout, all integers in host byte order:
+
+     struct statsFileHeader
+     struct statsColumnInfo for each column
+     row groups  for each column in order, its values for every row of
+                 the group, padded to 8 bytes; every group but the last
+                 holds rowGroupSize rows
+     footer      uint64_t file offset of each row group
+
+   Columns, named as in the file:
+
+     seed, kingdom (bit i for card adventurer + i), players, rng_mode,
+     turns, finished, winners (bit p for player p), strategy0..3
+     (index into the header's names, STATS_NO_PLAYER for empty seats),
+     score0..3, and p<P>_<card> for the number of each card player P
+     owned at the end */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "dominion.h"
+#include "simulate.h"
+
+#define STATS_MAGIC "DOMCOLS"
+#define STATS_VERSION 1
+#define STATS_DEFAULT_GROUP 65536
+#define STATS_NAME_LENGTH 24
+#define STATS_NO_PLAYER 255
+#define STATS_NUM_COLUMNS (7 + 2 * MAX_PLAYERS + MAX_PLAYERS * (treasure_map + 1))
+
+/* Column types */
+#define STATS_U8 0
+#define STATS_I16 1
+#define STATS_I32 2
+#define STATS_U32 3
+
+struct statsFileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t numColumns;
+  uint32_t rowGroupSize;
+  uint32_t numStrategies;
+  uint64_t numRows;
+  uint64_t numGroups;
+  uint64_t footerOffset;
+  char strategyNames[MAX_STRATEGIES][STATS_NAME_LENGTH];
+};
+
+struct statsColumnInfo {
+  char name[STATS_NAME_LENGTH];
+  uint32_t type;
+  uint32_t width;             //bytes per value
+};
+
+/* One game, as written */
+struct statsRow {
+  int seed;
+  int kingdom[10];
+  int numPlayers;
+  int rngMode;
+  int strategies[MAX_PLAYERS];
+  int turns;
+  int finished;
+  int winners[MAX_PLAYERS];
+  int scores[MAX_PLAYERS];
+  int cards[MAX_PLAYERS][treasure_map+1];
+};
+
+struct statsWriter {
+  FILE *out;
+  struct statsColumnInfo columns[STATS_NUM_COLUMNS];
+  uint32_t columnStart[STATS_NUM_COLUMNS];  //bytes per row before column c
+  uint32_t rowGroupSize;
+  uint32_t rows;              //in the group being filled
+  unsigned char *group;       //column c starts at rowGroupSize * columnStart[c]
+  uint64_t offset;
+  uint64_t numRows;
+  uint64_t *groupOffsets;
+  uint64_t numGroups;
+  uint64_t capacity;
+};
+
+struct statsFile {
+  const unsigned char *base;  //the whole file, mapped read-only
+  size_t size;
+  const struct statsFileHeader *header;
+  const struct statsColumnInfo *columns;
+  const uint64_t *groupOffsets;
+};
+
+void fillStatsRow(struct statsRow *row, int numPlayers,
+		  const int strategyIds[], int kingdom[10], int seed,
+		  int rngMode, struct gameState *state,
+		  struct gameResult *result);
+/* Row for a game just played by playGame */
+
+int openStatsWriter(struct statsWriter *writer, const char *path,
+		    int rowGroupSize);
+/* rowGroupSize 0 for STATS_DEFAULT_GROUP.  The header names every
+   registered strategy */
+
+int statsAppend(struct statsWriter *writer, const struct statsRow *row);
+
+int closeStatsWriter(struct statsWriter *writer);
+/* Writes the last group, the footer and the header */
+
+int openStatsFile(struct statsFile *file, const char *path);
+/* -1 unless every row group's columns lie inside the file */
+void closeStatsFile(struct statsFile *file);
+
+int statsColumnIndex(const struct statsFile *file, const char *name);
+/* -1 if there is no such column */
+
+long statsGroupRows(const struct statsFile *file, long group);
+
+const void* statsChunk(const struct statsFile *file, int column,
+		       long group);
+/* Values of column for every row of group, pointing into the mapping */
+
+long statsValue(const struct statsFile *file, int column,
+		const void *chunk, long row);
+/* Value row of a chunk, widened */
+
+#endif
@@ -11,6 +11,7 @@ Sam Heinith CS362
 #include "rngs.h"
 #include "interface.h"
 #include "dominion.h"
+#include "log.h"
 
 
 void cardNumToName(int card, char *name){
@@ -250,9 +251,11 @@ void printHelp(void) {
   buy [Supply Card Number] 			- buy a card at supply position\n\
   end 			      			- end your turn\n\
   init [Number of Players] [Number of Bots] 	- initialize the game\n\
+  load [File]					- continue a game saved to a file\n\
   num 			      			- print number of cards in your hand\n\
   play [Hand Index] [Choice] [Choice] [Choice]	- play a card from your hand\n\
   resign					- end the game showing the current scores\n\
+  save [File]					- save the game, shuffle state included, to a file\n\
   show 						- show your current hand\n\
   stat 						- show your turn's status\n\
   supp 						- show the supply\n\
@@ -328,28 +331,43 @@ int countHandCoins(int player, struct gameState *game) {
 }
 
 
+/* printSupply, at debug level */
+static void logSupply(struct gameState *game) {
+  int cardNum, cardCost, cardCount;
+  char name[MAX_STRING_LENGTH];
+  logPrintf("#   Card          Cost   Copies\n");
+  for(cardNum = 0; cardNum < NUM_TOTAL_K_CARDS; cardNum++){
+    cardCount = game->supplyCount[cardNum];
+    if(cardCount == -1) continue;
+    cardNumToName(cardNum, name);
+    cardCost = getCardCost(cardNum);
+    logPrintf("%-2d  %-13s %-5d  %-5d\n", cardNum, name, cardCost, cardCount);
+  }
+  logPrintf("\n");
+}
+
 void executeBotTurn(int player, int *turnNum, struct gameState *game) {
   int coins = countHandCoins(player, game);
 	
-  printf("*****************Executing Bot Player %d Turn Number %d*****************\n", player, *turnNum);
-  printSupply(game);	
+  LOG(LOG_INFO, "*****************Executing Bot Player %d Turn Number %d*****************\n", player, *turnNum);
+  if(logEnabled(LOG_DEBUG)) logSupply(game);
   //sleep(1); //Thinking...
 	
   if(coins >= PROVINCE_COST && supplyCount(province,game) > 0) {
     buyCard(province,game);
-    printf("Player %d buys card Province\n\n", player);
+    LOG(LOG_INFO, "Player %d buys card Province\n\n", player);
   }
   else if(supplyCount(province,game) == 0 && coins >= DUCHY_COST ) {
     buyCard(duchy,game);
-    printf("Player %d buys card Duchy\n\n", player);
+    LOG(LOG_INFO, "Player %d buys card Duchy\n\n", player);
   }
   else if(coins >= GOLD_COST && supplyCount(gold,game) > 0) {
     buyCard(gold,game);
-    printf("Player %d buys card Gold\n\n", player);
+    LOG(LOG_INFO, "Player %d buys card Gold\n\n", player);
   }
   else if(coins >= SILVER_COST && supplyCount(silver,game) > 0) {
     buyCard(silver,game);
-    printf("Player %d buys card Silver\n\n", player);
+    LOG(LOG_INFO, "Player %d buys card Silver\n\n", player);
 
   }
 
@@ -358,6 +376,6 @@ void executeBotTurn(int player, int *turnNum, struct gameState *game) {
   endTurn(game);
   if(! isGameOver(game)) {
     int currentPlayer = whoseTurn(game);
-    printf("Player %d's turn number %d\n\n", currentPlayer, (*turnNum));
+    LOG(LOG_INFO, "Player %d's turn number %d\n\n", currentPlayer, (*turnNum));
   }
 }
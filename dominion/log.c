@@ -0,0 +1,249 @@
+#include "log.h"
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct logBuffer {
+  char *data;
+  size_t length;
+  size_t capacity;
+  struct logBuffer *next;       //in the write queue or the free list
+  struct logBuffer *nextActive; //in the list of every thread's buffer
+};
+
+int logLevel = -1;
+
+static FILE *logOut;
+static pthread_t writer;
+static int running;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t queued = PTHREAD_COND_INITIALIZER;    //writer waits
+static pthread_cond_t written = PTHREAD_COND_INITIALIZER;   //loggers wait
+static struct logBuffer *queueHead;
+static struct logBuffer *queueTail;
+static struct logBuffer *freeList;
+static struct logBuffer *activeList;  //buffers some thread is filling
+static int allocated;
+static long queuedCount;    //buffers ever queued
+static long writtenCount;   //buffers ever written
+static int generation;      //startLog and stopLog calls, so stale buffers are dropped
+
+static __thread struct logBuffer *current;
+static __thread int currentGeneration;
+
+static void *writeLoop(void *arg) {
+  struct logBuffer *b;
+
+  pthread_mutex_lock(&lock);
+  for (;;)
+    {
+      while (queueHead == NULL && running)
+	pthread_cond_wait(&queued, &lock);
+      if (queueHead == NULL)
+	break;
+      b = queueHead;
+      queueHead = b->next;
+      if (queueHead == NULL)
+	queueTail = NULL;
+
+      pthread_mutex_unlock(&lock);
+      fwrite(b->data, 1, b->length, logOut);
+      fflush(logOut);
+      pthread_mutex_lock(&lock);
+
+      b->length = 0;
+      b->next = freeList;
+      freeList = b;
+      writtenCount++;
+      pthread_cond_broadcast(&written);
+    }
+  fflush(logOut);
+  pthread_mutex_unlock(&lock);
+  return NULL;
+}
+
+int startLog(FILE *out, int level) {
+  if (running)
+    return -1;
+  logOut = out;
+  running = 1;
+  generation++;
+  if (pthread_create(&writer, NULL, writeLoop, NULL) != 0)
+    {
+      running = 0;
+      return -1;
+    }
+  logLevel = level;
+  return 0;
+}
+
+/* Call with lock held */
+static void enqueue(struct logBuffer *b) {
+  b->next = NULL;
+  if (queueTail != NULL)
+    queueTail->next = b;
+  else
+    queueHead = b;
+  queueTail = b;
+  queuedCount++;
+  pthread_cond_signal(&queued);
+}
+
+/* Call with lock held */
+static void unlinkActive(struct logBuffer *b) {
+  struct logBuffer **p;
+  for (p = &activeList; *p != NULL; p = &(*p)->nextActive)
+    if (*p == b)
+      {
+	*p = b->nextActive;
+	break;
+      }
+}
+
+void stopLog(void) {
+  struct logBuffer *b;
+
+  if (!running)
+    return;
+  logLevel = -1;
+
+  pthread_mutex_lock(&lock);
+  for (b = activeList; b != NULL; b = b->nextActive)
+    if (b->length > 0)
+      enqueue(b);
+    else
+      {
+	b->next = freeList;
+	freeList = b;
+      }
+  activeList = NULL;
+  running = 0;
+  //every thread's current buffer is freed below, not just this one's
+  generation++;
+  pthread_cond_signal(&queued);
+  pthread_mutex_unlock(&lock);
+  pthread_join(writer, NULL);
+
+  while (freeList != NULL)
+    {
+      b = freeList;
+      freeList = b->next;
+      free(b->data);
+      free(b);
+    }
+  allocated = 0;
+  current = NULL;
+}
+
+/* Call with lock held.  A free buffer; past the limit on buffers, waits
+   for the writer to return one if it has any to write */
+static struct logBuffer *takeBuffer(void) {
+  struct logBuffer *b;
+
+  while (freeList == NULL && allocated >= LOG_MAX_BUFFERS
+	 && writtenCount < queuedCount)
+    pthread_cond_wait(&written, &lock);
+  if (freeList != NULL)
+    {
+      b = freeList;
+      freeList = b->next;
+    }
+  else
+    {
+      b = calloc(1, sizeof(struct logBuffer));
+      if (b == NULL)
+	return NULL;
+      b->data = malloc(LOG_BUFFER_SIZE);
+      if (b->data == NULL)
+	{
+	  free(b);
+	  return NULL;
+	}
+      b->capacity = LOG_BUFFER_SIZE;
+      allocated++;
+    }
+  b->nextActive = activeList;
+  activeList = b;
+  return b;
+}
+
+void logFlush(void) {
+  if (!running || current == NULL || currentGeneration != generation
+      || current->length == 0)
+    return;
+  pthread_mutex_lock(&lock);
+  unlinkActive(current);
+  enqueue(current);
+  current = NULL;
+  pthread_mutex_unlock(&lock);
+}
+
+void logDrain(void) {
+  long target;
+
+  if (!running)
+    return;
+  logFlush();
+  pthread_mutex_lock(&lock);
+  target = queuedCount;
+  while (writtenCount < target)
+    pthread_cond_wait(&written, &lock);
+  pthread_mutex_unlock(&lock);
+}
+
+static int reserve(struct logBuffer *b, size_t needed) {
+  size_t capacity;
+  char *grown;
+
+  if (b->length + needed <= b->capacity)
+    return 0;
+  capacity = b->capacity;
+  while (capacity < b->length + needed)
+    capacity *= 2;
+  grown = realloc(b->data, capacity);
+  if (grown == NULL)
+    return -1;
+  b->data = grown;
+  b->capacity = capacity;
+  return 0;
+}
+
+void logPrintf(const char *fmt, ...) {
+  va_list args;
+  int n;
+
+  if (!running)
+    return;
+
+  if (current == NULL || currentGeneration != generation)
+    {
+      pthread_mutex_lock(&lock);
+      current = takeBuffer();
+      currentGeneration = generation;
+      pthread_mutex_unlock(&lock);
+      if (current == NULL)
+	return;
+    }
+
+  //format straight into the buffer, growing it for a line that does not
+  //fit so that the line stays whole
+  va_start(args, fmt);
+  n = vsnprintf(current->data + current->length,
+		current->capacity - current->length, fmt, args);
+  va_end(args);
+  if (n < 0)
+    return;
+  if ((size_t)n >= current->capacity - current->length)
+    {
+      if (reserve(current, n + 1) < 0)
+	return;
+      va_start(args, fmt);
+      vsnprintf(current->data + current->length, n + 1, fmt, args);
+      va_end(args);
+    }
+  current->length += n;
+
+  if (current->length >= LOG_BUFFER_SIZE)
+    logFlush();
+}
@@ -0,0 +1,62 @@
+#ifndef _LOG_H
+#define _LOG_H
+
+/* Asynchronous transcript logging.
+
+   LOG formats into a buffer owned by the calling thread; full buffers
+   are handed to a background writer thread, which writes them whole,
+   while the thread carries on in a fresh one.  A line is never split
+   between buffers, and everything a thread logs between two logFlush
+   calls is written contiguously as long as it stays under
+   LOG_BUFFER_SIZE, so games logging from many threads at once do not
+   interleave if each flushes when it finishes.
+
+   A disabled level costs one comparison: LOG tests the level before
+   its arguments are evaluated.  Levels above LOG_COMPILED_LEVEL (define
+   it when compiling, default LOG_DEBUG) are removed at compile time. */
+
+#include <stdio.h>
+
+#define LOG_ERROR 0
+#define LOG_WARN 1
+#define LOG_INFO 2
+#define LOG_DEBUG 3
+
+#ifndef LOG_COMPILED_LEVEL
+#define LOG_COMPILED_LEVEL LOG_DEBUG
+#endif
+
+#define LOG_BUFFER_SIZE 65536   /* bytes a buffer holds before hand-off */
+#define LOG_MAX_BUFFERS 64      /* buffers before loggers wait for the writer */
+
+extern int logLevel;
+/* Highest level written; -1 (nothing) until startLog */
+
+#define logEnabled(level) \
+  ((level) <= LOG_COMPILED_LEVEL && (level) <= logLevel)
+
+#define LOG(level, ...) \
+  do { if (logEnabled(level)) logPrintf(__VA_ARGS__); } while (0)
+
+int startLog(FILE *out, int level);
+/* Starts the writer thread; out stays owned by the caller */
+
+void stopLog(void);
+/* Writes everything logged so far by every thread, stops the writer
+   and disables logging.  Threads that logged must be done logging;
+   logPrintf, logFlush and logDrain are no-ops afterwards, until
+   startLog */
+
+void logPrintf(const char *fmt, ...)
+  __attribute__((format(printf, 1, 2)));
+/* Unconditional; use LOG */
+
+void logFlush(void);
+/* Hands the calling thread's buffer to the writer without waiting */
+
+void logDrain(void);
+/* logFlush, then waits until the writer has written every buffer
+   handed to it and flushed out, so output on other paths to the same
+   stream comes after it */
+
+#endif
@@ -0,0 +1,659 @@
+/* Mutation testing of dominion.c against the unit tests
+
+   mutate [-j jobs] [-l first-last] [-t factor] [-o report] [test ...]
+
+   Run in this directory.  Every mutant changes one operator or constant
+   of dominion.c, outside comments, strings and preprocessor lines:
+
+     <  <=  >  >=   to the other bound     ==  !=   to the other
+     &&  ||         to the other           ++  --   to the other
+     +=  -=         to the other           +  -     to the other
+     integer n      to n + 1
+
+   The tests are the runtests prerequisites of the Makefile unless named
+   on the command line.  First they are built with the Makefile's
+   coverage flags in a scratch copy of this directory and run one at a
+   time, which gives the lines of dominion.c each one executes and how
+   long it takes.  Then jobs workers (default one per CPU), each with
+   its own copy built without coverage, take mutants in turn: write the
+   mutant, make just the tests that execute its line, and run them,
+   fastest first, stopping at the first that fails or runs factor
+   (default 10) times its usual time.  A mutant no test executes is
+   never built, one that does not compile is stillborn and left out of
+   the score.
+
+   The report (default mutants.out) has a line per mutant,
+
+     dominion.c:1176:22 '<' -> '<=' killed by testKingdom
+
+   and the summary gives the mutation score, killed over every mutant
+   that compiled. */
+
+#define _DEFAULT_SOURCE
+#include <ctype.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SOURCE "dominion.c"
+#define MAX_LINES 8192
+#define MAX_TESTS 32
+#define MAX_JOBS 64
+#define MUTANT_CFLAGS "-w -fpic -lm -std=c99"
+
+enum outcome {
+  NOT_COVERED, SURVIVED, KILLED, TIMED_OUT, STILLBORN, NUM_OUTCOMES
+};
+
+/* Exit statuses of a worker, one per mutant */
+#define EXIT_SURVIVED 0
+#define EXIT_STILLBORN 1
+#define EXIT_KILLED 64          /* + test, + MAX_TESTS if it timed out */
+
+struct mutant {
+  int line;                     /* from 1 */
+  int column;                   /* from 1 */
+  char from[24];
+  char to[24];
+  int outcome;
+  int test;                     /* the test that killed it */
+};
+
+struct test {
+  char name[64];
+  double seconds;
+  unsigned char *covers;        /* by line */
+};
+
+static char *lines[MAX_LINES];
+static int numLines = 0;
+static struct mutant *mutants = NULL;
+static int numMutants = 0;
+static struct test tests[MAX_TESTS];
+static int numTests = 0;
+static int order[MAX_TESTS];    /* tests by time */
+static char workDir[64];
+
+/* Mutants */
+/* --------------------------------------------------------------- */
+
+static const char *swaps[][2] = {
+  {"<=", "<"}, {">=", ">"}, {"==", "!="}, {"!=", "=="}, {"&&", "||"},
+  {"||", "&&"}, {"++", "--"}, {"--", "++"}, {"+=", "-="}, {"-=", "+="},
+  {"<", "<="}, {">", ">="}, {"+", "-"}, {"-", "+"}
+};
+
+static void addMutant(int line, int column, const char *from, const char *to) {
+  static int capacity = 0;
+  struct mutant *m;
+
+  if (numMutants == capacity)
+    {
+      capacity = capacity ? capacity * 2 : 1024;
+      mutants = realloc(mutants, capacity * sizeof(struct mutant));
+      if (mutants == NULL)
+	{
+	  perror("mutate");
+	  exit(EXIT_FAILURE);
+	}
+    }
+  m = &mutants[numMutants++];
+  memset(m, 0, sizeof(*m));
+  m->line = line;
+  m->column = column;
+  snprintf(m->from, sizeof(m->from), "%s", from);
+  snprintf(m->to, sizeof(m->to), "%s", to);
+}
+
+static int isWordChar(char c) {
+  return isalnum((unsigned char)c) || c == '_';
+}
+
+/* Every mutant of lines first to last, skipping comments, string and
+   character literals, preprocessor lines and the operators that only
+   look like ours: -> << >> */
+static void findMutants(int first, int last) {
+  char literal[24];
+  char bumped[24];
+  int inComment = 0;
+  const char *s;
+  int line, i, k, n;
+
+  for (line = 1; line <= numLines; line++)
+    {
+      s = lines[line - 1];
+      for (i = 0; isspace((unsigned char)s[i]); i++)
+	;
+      if (s[i] == '#' && !inComment)
+	continue;
+      for (i = 0; s[i] != '\0'; i++)
+	{
+	  if (inComment)
+	    {
+	      if (s[i] == '*' && s[i + 1] == '/')
+		{
+		  inComment = 0;
+		  i++;
+		}
+	      continue;
+	    }
+	  if (s[i] == '/' && s[i + 1] == '*')
+	    {
+	      inComment = 1;
+	      i++;
+	      continue;
+	    }
+	  if (s[i] == '/' && s[i + 1] == '/')
+	    break;
+	  if (s[i] == '"' || s[i] == '\'')
+	    {
+	      for (k = i + 1; s[k] != '\0' && s[k] != s[i]; k++)
+		if (s[k] == '\\' && s[k + 1] != '\0')
+		  k++;
+	      i = s[k] == '\0' ? k - 1 : k;
+	      continue;
+	    }
+	  if (line < first || line > last)
+	    continue;
+
+	  if (isdigit((unsigned char)s[i]) && (i == 0 || !isWordChar(s[i - 1])))
+	    {
+	      for (n = 0; isdigit((unsigned char)s[i + n]) && n < 9; n++)
+		literal[n] = s[i + n];
+	      literal[n] = '\0';
+	      if (!isWordChar(s[i + n]) && s[i + n] != '.')
+		{
+		  snprintf(bumped, sizeof(bumped), "%ld", atol(literal) + 1);
+		  addMutant(line, i + 1, literal, bumped);
+		}
+	      i += n - 1;
+	      continue;
+	    }
+	  if (s[i] == '-' && s[i + 1] == '>')
+	    {
+	      i++;
+	      continue;
+	    }
+	  if ((s[i] == '<' || s[i] == '>') && s[i + 1] == s[i])
+	    {
+	      i += 1 + (s[i + 2] == '=');
+	      continue;
+	    }
+	  for (k = 0; k < (int)(sizeof(swaps) / sizeof(swaps[0])); k++)
+	    {
+	      n = strlen(swaps[k][0]);
+	      if (strncmp(s + i, swaps[k][0], n) == 0)
+		{
+		  addMutant(line, i + 1, swaps[k][0], swaps[k][1]);
+		  i += n - 1;
+		  break;
+		}
+	    }
+	}
+    }
+}
+
+static int readSource(void) {
+  char buffer[4096];
+  FILE *in = fopen(SOURCE, "r");
+
+  if (in == NULL)
+    return -1;
+  while (numLines < MAX_LINES && fgets(buffer, sizeof(buffer), in) != NULL)
+    lines[numLines++] = strdup(buffer);
+  fclose(in);
+  return 0;
+}
+
+static int writeMutant(const char *dir, const struct mutant *m) {
+  char path[256];
+  const char *s;
+  FILE *out;
+  int line;
+
+  snprintf(path, sizeof(path), "%s/%s", dir, SOURCE);
+  out = fopen(path, "w");
+  if (out == NULL)
+    return -1;
+  for (line = 1; line <= numLines; line++)
+    {
+      s = lines[line - 1];
+      if (m != NULL && line == m->line)
+	fprintf(out, "%.*s%s%s", m->column - 1, s, m->to,
+		s + m->column - 1 + strlen(m->from));
+      else
+	fputs(s, out);
+    }
+  return fclose(out);
+}
+
+/* Copies and builds */
+/* --------------------------------------------------------------- */
+
+static int isSourceFile(const char *name) {
+  const char *dot = strrchr(name, '.');
+  return strcmp(name, "Makefile") == 0
+    || (dot != NULL && (strcmp(dot, ".c") == 0 || strcmp(dot, ".h") == 0
+			|| strcmp(dot, ".cpp") == 0 || strcmp(dot, ".hpp") == 0));
+}
+
+static int copyFile(const char *from, const char *to) {
+  char buffer[65536];
+  ssize_t n;
+  int in, out;
+
+  in = open(from, O_RDONLY);
+  if (in < 0)
+    return -1;
+  out = open(to, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (out < 0)
+    {
+      close(in);
+      return -1;
+    }
+  while ((n = read(in, buffer, sizeof(buffer))) > 0)
+    if (write(out, buffer, n) != n)
+      {
+	n = -1;
+	break;
+      }
+  close(in);
+  return close(out) == 0 && n == 0 ? 0 : -1;
+}
+
+/* A copy of the sources in this directory, without build products */
+static int copySources(const char *dir) {
+  char path[512];
+  struct dirent *entry;
+  DIR *d;
+
+  if (mkdir(dir, 0755) != 0 || (d = opendir(".")) == NULL)
+    return -1;
+  while ((entry = readdir(d)) != NULL)
+    {
+      if (!isSourceFile(entry->d_name))
+	continue;
+      snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+      if (copyFile(entry->d_name, path) < 0)
+	{
+	  closedir(d);
+	  return -1;
+	}
+    }
+  closedir(d);
+  return 0;
+}
+
+/* make of the tests in dir, all of them or those that execute line;
+   cflags NULL for the Makefile's own */
+static int makeTests(const char *dir, const char *cflags, int line, int jobs) {
+  char command[4096];
+  size_t n;
+  int t;
+
+  n = snprintf(command, sizeof(command), "make -s -j%d -C %s", jobs, dir);
+  if (cflags != NULL)
+    n += snprintf(command + n, sizeof(command) - n, " CFLAGS='%s'", cflags);
+  for (t = 0; t < numTests; t++)
+    if (line == 0 || tests[t].covers[line])
+      n += snprintf(command + n, sizeof(command) - n, " %s", tests[t].name);
+  snprintf(command + n, sizeof(command) - n, " >/dev/null 2>&1");
+  return system(command) == 0 ? 0 : -1;
+}
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Runs a test in dir, with SIGALRM ending it after timeout seconds if
+   positive; 0 if it exits 0, 1 if it fails, 2 if it times out */
+static int runTest(const char *dir, const char *name, int timeout) {
+  char path[256];
+  pid_t pid;
+  int status;
+  int null;
+
+  snprintf(path, sizeof(path), "./%s", name);
+  pid = fork();
+  if (pid < 0)
+    return 1;
+  if (pid == 0)
+    {
+      null = open("/dev/null", O_WRONLY);
+      dup2(null, STDOUT_FILENO);
+      dup2(null, STDERR_FILENO);
+      if (chdir(dir) != 0)
+	_exit(127);
+      signal(SIGALRM, SIG_DFL);
+      if (timeout > 0)
+	alarm(timeout);
+      execl(path, path, (char*)NULL);
+      _exit(127);
+    }
+  if (waitpid(pid, &status, 0) < 0)
+    return 1;
+  if (WIFSIGNALED(status) && WTERMSIG(status) == SIGALRM)
+    return 2;
+  return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : 1;
+}
+
+/* Coverage */
+/* --------------------------------------------------------------- */
+
+/* Adds the lines gcov counts as run in one data file of dir */
+static void readCoverage(const char *dir, const char *data, unsigned char *covers) {
+  char command[512];
+  char buffer[4096];
+  char count[32];
+  FILE *in;
+  int line;
+
+  snprintf(command, sizeof(command), "cd %s && gcov -t %s 2>/dev/null", dir, data);
+  in = popen(command, "r");
+  if (in == NULL)
+    return;
+  while (fgets(buffer, sizeof(buffer), in) != NULL)
+    if (sscanf(buffer, " %31[^:]:%d:", count, &line) == 2
+	&& isdigit((unsigned char)count[0]) && atol(count) > 0
+	&& line > 0 && line <= numLines)
+      covers[line] = 1;
+  pclose(in);
+}
+
+/* Removes dir's data files, or reads the coverage of dominion.c in them,
+   whichever objects it was built into */
+static void coverageFiles(const char *dir, unsigned char *covers) {
+  struct dirent *entry;
+  char path[512];
+  size_t n;
+  DIR *d = opendir(dir);
+
+  if (d == NULL)
+    return;
+  while ((entry = readdir(d)) != NULL)
+    {
+      n = strlen(entry->d_name);
+      if (n < 5 || strcmp(entry->d_name + n - 5, ".gcda") != 0)
+	continue;
+      if (covers == NULL)
+	{
+	  snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+	  unlink(path);
+	}
+      else if (strcmp(entry->d_name, "dominion.gcda") == 0
+	       || (n > 14 && strcmp(entry->d_name + n - 14, "-dominion.gcda") == 0))
+	readCoverage(dir, entry->d_name, covers);
+    }
+  closedir(d);
+}
+
+static int compareTimes(const void *a, const void *b) {
+  double x = tests[*(const int*)a].seconds;
+  double y = tests[*(const int*)b].seconds;
+  return (x > y) - (x < y);
+}
+
+/* Drops the tests that fail unmutated, as they could kill nothing */
+static int measureTests(const char *dir) {
+  double start;
+  int kept = 0;
+  int t;
+
+  for (t = 0; t < numTests; t++)
+    {
+      tests[t].covers = calloc(numLines + 1, 1);
+      coverageFiles(dir, NULL);
+      start = now();
+      if (runTest(dir, tests[t].name, 0) != 0)
+	{
+	  printf("%s fails without mutation and is left out\n", tests[t].name);
+	  free(tests[t].covers);
+	  continue;
+	}
+      tests[t].seconds = now() - start;
+      coverageFiles(dir, tests[t].covers);
+      tests[kept++] = tests[t];
+    }
+  numTests = kept;
+  for (t = 0; t < numTests; t++)
+    order[t] = t;
+  qsort(order, numTests, sizeof(int), compareTimes);
+  return numTests > 0 ? 0 : -1;
+}
+
+/* The runtests prerequisites */
+static void readMakefileTests(void) {
+  char buffer[4096];
+  char *word;
+  FILE *in = fopen("Makefile", "r");
+
+  if (in == NULL)
+    return;
+  while (fgets(buffer, sizeof(buffer), in) != NULL)
+    if (strncmp(buffer, "runtests:", 9) == 0)
+      {
+	for (word = strtok(buffer + 9, " \t\n"); word != NULL && numTests < MAX_TESTS;
+	     word = strtok(NULL, " \t\n"))
+	  snprintf(tests[numTests++].name, sizeof(tests[0].name), "%s", word);
+	break;
+      }
+  fclose(in);
+}
+
+/* Workers */
+/* --------------------------------------------------------------- */
+
+static int runMutant(const char *dir, const struct mutant *m, double factor) {
+  int timeout, result;
+  int i, t;
+
+  if (writeMutant(dir, m) < 0 || makeTests(dir, MUTANT_CFLAGS, m->line, 1) < 0)
+    return EXIT_STILLBORN;
+  for (i = 0; i < numTests; i++)
+    {
+      t = order[i];
+      if (!tests[t].covers[m->line])
+	continue;
+      timeout = 1 + (int)(tests[t].seconds * factor);
+      result = runTest(dir, tests[t].name, timeout);
+      if (result != 0)
+	return EXIT_KILLED + t + (result == 2 ? MAX_TESTS : 0);
+    }
+  return EXIT_SURVIVED;
+}
+
+static void recordOutcome(struct mutant *m, int status) {
+  int code = WIFEXITED(status) ? WEXITSTATUS(status) : EXIT_STILLBORN;
+
+  if (code >= EXIT_KILLED)
+    {
+      m->outcome = code - EXIT_KILLED >= MAX_TESTS ? TIMED_OUT : KILLED;
+      m->test = (code - EXIT_KILLED) % MAX_TESTS;
+    }
+  else
+    m->outcome = code == EXIT_SURVIVED ? SURVIVED : STILLBORN;
+}
+
+static void runMutants(int jobs, double factor) {
+  pid_t running[MAX_JOBS] = {0};
+  int assigned[MAX_JOBS];
+  char dir[128];
+  int next = 0, done = 0, left = 0;
+  int status, slot, i;
+  pid_t pid;
+
+  for (i = 0; i < numMutants; i++)
+    left += mutants[i].outcome != NOT_COVERED;
+  while (done < left)
+    {
+      for (slot = 0; slot < jobs; slot++)
+	{
+	  while (next < numMutants && mutants[next].outcome == NOT_COVERED)
+	    next++;
+	  if (running[slot] != 0 || next == numMutants)
+	    continue;
+	  snprintf(dir, sizeof(dir), "%s/worker%d", workDir, slot);
+	  pid = fork();
+	  if (pid == 0)
+	    _exit(runMutant(dir, &mutants[next], factor));
+	  if (pid < 0)
+	    {
+	      perror("mutate");
+	      exit(EXIT_FAILURE);
+	    }
+	  running[slot] = pid;
+	  assigned[slot] = next++;
+	}
+
+      pid = wait(&status);
+      for (slot = 0; slot < jobs && running[slot] != pid; slot++)
+	;
+      if (pid < 0 || slot == jobs)
+	continue;
+      recordOutcome(&mutants[assigned[slot]], status);
+      running[slot] = 0;
+      done++;
+      fprintf(stderr, "\r%d/%d mutants", done, left);
+    }
+  fprintf(stderr, "\n");
+}
+
+/* Report */
+/* --------------------------------------------------------------- */
+
+static int writeReport(const char *path, int counts[NUM_OUTCOMES]) {
+  static const char *outcomes[NUM_OUTCOMES] = {
+    "not covered", "survived", "killed by", "timed out in", "stillborn"
+  };
+  const struct mutant *m;
+  FILE *out = fopen(path, "w");
+  int i;
+
+  if (out == NULL)
+    return -1;
+  for (i = 0; i < numMutants; i++)
+    {
+      m = &mutants[i];
+      counts[m->outcome]++;
+      fprintf(out, "%s:%d:%d '%s' -> '%s' %s", SOURCE, m->line, m->column,
+	      m->from, m->to, outcomes[m->outcome]);
+      if (m->outcome == KILLED || m->outcome == TIMED_OUT)
+	fprintf(out, " %s", tests[m->test].name);
+      fprintf(out, "\n");
+    }
+  return fclose(out);
+}
+
+static void removeTree(const char *dir) {
+  char command[256];
+  snprintf(command, sizeof(command), "rm -rf %s", dir);
+  if (system(command) != 0)
+    fprintf(stderr, "Cannot remove %s\n", dir);
+}
+
+int main(int argc, char **argv) {
+  int counts[NUM_OUTCOMES] = {0};
+  const char *report = "mutants.out";
+  char dir[128];
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  int jobs = cpus > 0 ? (cpus < MAX_JOBS ? cpus : MAX_JOBS) : 1;
+  int first = 1, last = MAX_LINES;
+  double factor = 10;
+  double start = now();
+  int built, killed;
+  int i, t;
+
+  for (i = 1; i < argc && argv[i][0] == '-'; i++)
+    {
+      if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+	jobs = atoi(argv[++i]);
+      else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc
+	       && sscanf(argv[i + 1], "%d-%d", &first, &last) == 2)
+	i++;
+      else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+	factor = atof(argv[++i]);
+      else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+	report = argv[++i];
+      else
+	break;
+    }
+  for (; i < argc && argv[i][0] != '-' && numTests < MAX_TESTS; i++)
+    snprintf(tests[numTests++].name, sizeof(tests[0].name), "%s", argv[i]);
+  if (i < argc || jobs < 1 || jobs > MAX_JOBS || first > last || factor <= 0)
+    {
+      printf("Usage: mutate [-j jobs] [-l first-last] [-t factor] [-o report] [test ...]\n");
+      return EXIT_FAILURE;
+    }
+  if (numTests == 0)
+    readMakefileTests();
+  if (readSource() < 0 || numTests == 0)
+    {
+      printf("Run mutate where %s and the Makefile's runtests are\n", SOURCE);
+      return EXIT_FAILURE;
+    }
+
+  snprintf(workDir, sizeof(workDir), "/tmp/mutate.XXXXXX");
+  if (mkdtemp(workDir) == NULL)
+    {
+      perror("mutate");
+      return EXIT_FAILURE;
+    }
+
+  //coverage and times from the unmutated tests
+  snprintf(dir, sizeof(dir), "%s/coverage", workDir);
+  if (copySources(dir) < 0 || makeTests(dir, NULL, 0, jobs) < 0 || measureTests(dir) < 0)
+    {
+      printf("Cannot build and run the tests in %s\n", dir);
+      removeTree(workDir);
+      return EXIT_FAILURE;
+    }
+  for (t = 0; t < numTests; t++)
+    printf("%-20s %8.3f s\n", tests[t].name, tests[t].seconds);
+  fflush(stdout);
+
+  findMutants(first, last);
+  for (i = 0; i < numMutants; i++)
+    {
+      mutants[i].outcome = NOT_COVERED;
+      for (t = 0; t < numTests; t++)
+	if (tests[t].covers[mutants[i].line])
+	  mutants[i].outcome = SURVIVED;
+    }
+
+  for (i = 0; i < jobs; i++)
+    {
+      snprintf(dir, sizeof(dir), "%s/worker%d", workDir, i);
+      if (copySources(dir) < 0 || makeTests(dir, MUTANT_CFLAGS, 0, jobs) < 0)
+	{
+	  printf("Cannot build the tests in %s\n", dir);
+	  removeTree(workDir);
+	  return EXIT_FAILURE;
+	}
+    }
+  runMutants(jobs, factor);
+  removeTree(workDir);
+
+  if (writeReport(report, counts) < 0)
+    {
+      printf("Cannot write %s\n", report);
+      return EXIT_FAILURE;
+    }
+  built = numMutants - counts[STILLBORN];
+  killed = counts[KILLED] + counts[TIMED_OUT];
+  printf("%d mutants: %d killed (%d by timeout), %d survived, %d not covered, "
+	 "%d stillborn\n", numMutants, killed, counts[TIMED_OUT], counts[SURVIVED],
+	 counts[NOT_COVERED], counts[STILLBORN]);
+  printf("Mutation score %d/%d = %.1f%%, in %.0f s with %d jobs; see %s\n",
+	 killed, built, built > 0 ? 100.0 * killed / built : 0.0, now() - start,
+	 jobs, report);
+  return EXIT_SUCCESS;
+}
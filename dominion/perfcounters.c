@@ -0,0 +1,121 @@
+#define _DEFAULT_SOURCE
+#include "perfcounters.h"
+#include <linux/perf_event.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static const char *counterNames[NUM_PERF_COUNTERS] = {
+  "cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses"
+};
+
+static void describeCounter(int counter, struct perf_event_attr *attr) {
+  memset(attr, 0, sizeof(*attr));
+  attr->size = sizeof(*attr);
+  attr->type = PERF_TYPE_HARDWARE;
+  switch (counter)
+    {
+    case PERF_CYCLES:
+      attr->config = PERF_COUNT_HW_CPU_CYCLES;
+      break;
+    case PERF_INSTRUCTIONS:
+      attr->config = PERF_COUNT_HW_INSTRUCTIONS;
+      break;
+    case PERF_L1D_MISSES:
+      attr->type = PERF_TYPE_HW_CACHE;
+      attr->config = PERF_COUNT_HW_CACHE_L1D
+	| (PERF_COUNT_HW_CACHE_OP_READ << 8)
+	| (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+      break;
+    case PERF_LLC_MISSES:
+      attr->config = PERF_COUNT_HW_CACHE_MISSES;
+      break;
+    case PERF_BRANCH_MISSES:
+      attr->config = PERF_COUNT_HW_BRANCH_MISSES;
+      break;
+    }
+  attr->read_format = PERF_FORMAT_TOTAL_TIME_ENABLED
+    | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  attr->exclude_kernel = 1;
+  attr->exclude_hv = 1;
+}
+
+int openPerfCounters(struct perfCounters *counters) {
+  struct perf_event_attr attr;
+  int opened = 0;
+  int i;
+
+  counters->leader = -1;
+  for (i = 0; i < NUM_PERF_COUNTERS; i++)
+    {
+      describeCounter(i, &attr);
+      //the first to open leads the group and holds it stopped
+      attr.disabled = counters->leader < 0;
+      counters->fd[i] = syscall(SYS_perf_event_open, &attr, 0, -1,
+				counters->leader, 0);
+      if (counters->fd[i] < 0)
+	{
+	  counters->fd[i] = -1;
+	  continue;
+	}
+      if (counters->leader < 0)
+	counters->leader = counters->fd[i];
+      opened++;
+    }
+  return opened;
+}
+
+void resetPerfCounters(const struct perfCounters *counters) {
+  if (counters->leader >= 0)
+    ioctl(counters->leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+}
+
+void startPerfCounters(const struct perfCounters *counters) {
+  if (counters->leader >= 0)
+    ioctl(counters->leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+void stopPerfCounters(const struct perfCounters *counters) {
+  if (counters->leader >= 0)
+    ioctl(counters->leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+}
+
+void readPerfCounters(const struct perfCounters *counters,
+		      int64_t counts[NUM_PERF_COUNTERS]) {
+  uint64_t value[3];            //count, time enabled, time running
+  int i;
+
+  for (i = 0; i < NUM_PERF_COUNTERS; i++)
+    {
+      counts[i] = -1;
+      if (counters->fd[i] < 0
+	  || read(counters->fd[i], value, sizeof(value)) != sizeof(value))
+	continue;
+      //a group the PMU could not fit never runs; one that shared the
+      //PMU with other groups ran part of the time and is scaled up
+      if (value[2] == 0)
+	continue;
+      counts[i] = value[2] < value[1]
+	? (int64_t)((double)value[0] * value[1] / value[2])
+	: (int64_t)value[0];
+    }
+}
+
+const char* perfCounterName(int counter) {
+  if (counter < 0 || counter >= NUM_PERF_COUNTERS)
+    return NULL;
+  return counterNames[counter];
+}
+
+void closePerfCounters(struct perfCounters *counters) {
+  int i;
+
+  for (i = 0; i < NUM_PERF_COUNTERS; i++)
+    {
+      if (counters->fd[i] >= 0)
+	close(counters->fd[i]);
+      counters->fd[i] = -1;
+    }
+  counters->leader = -1;
+}
@@ -0,0 +1,46 @@
+#ifndef _PERFCOUNTERS_H
+#define _PERFCOUNTERS_H
+
+/* Hardware event counters for the calling thread, from Linux
+   perf_event_open.
+
+   The counters are opened as one group, so they count over exactly the
+   same instructions, and only in user space.  Any of them may be
+   missing: containers and virtual machines often expose no hardware
+   events at all, and a kernel may refuse some of them.  Counters that
+   did not open read as -1 and the calls on a set with none open do
+   nothing, so callers can use them unconditionally. */
+
+#include <stdint.h>
+
+enum perfCounter {
+  PERF_CYCLES,
+  PERF_INSTRUCTIONS,
+  PERF_L1D_MISSES,              //L1 data cache read misses
+  PERF_LLC_MISSES,              //last level cache misses
+  PERF_BRANCH_MISSES,
+  NUM_PERF_COUNTERS
+};
+
+struct perfCounters {
+  int fd[NUM_PERF_COUNTERS];    //-1 where the counter did not open
+  int leader;                   //fd that switches the group, -1 for none
+};
+
+int openPerfCounters(struct perfCounters *counters);
+/* Opens what counters it can, stopped and at zero; returns how many */
+
+void resetPerfCounters(const struct perfCounters *counters);
+void startPerfCounters(const struct perfCounters *counters);
+void stopPerfCounters(const struct perfCounters *counters);
+
+void readPerfCounters(const struct perfCounters *counters,
+		      int64_t counts[NUM_PERF_COUNTERS]);
+/* Counts while started since the last reset; -1 for counters that did
+   not open or that the kernel never scheduled */
+
+const char* perfCounterName(int counter);
+
+void closePerfCounters(struct perfCounters *counters);
+
+#endif
@@ -1,16 +1,42 @@
 #include "dominion.h"
+#include "gamerecord.h"
+#include "log.h"
 #include <stdio.h>
+#include <string.h>
 #include "rngs.h"
 #include <stdlib.h>
 
+/* ./playdom seed [recordFile]: with a record file the game is appended
+   to it as a compact record (see gamerecord.h) instead of printed */
+
 int main (int argc, char** argv) {
   struct gameState G;
   int k[10] = {adventurer, gardens, embargo, village, minion, mine, cutpurse,
            sea_hag, tribute, smithy};
+  struct gameRecord record;
+  struct gameRecord *rec = NULL;
+  FILE *out = NULL;
+  int seed = atoi(argv[1]);
+
+  int level = LOG_INFO;
+
+  initGameRecord(&record);
+  if (argc > 2) {
+    out = fopen(argv[2], "ab");
+    if (out == NULL) {
+      printf ("Cannot open %s\n", argv[2]);
+      return 1;
+    }
+    rec = &record;
+    level = LOG_WARN;
+    beginGameRecord(rec, 2, k, seed, RNG_SHARED);
+  }
 
-  printf ("Starting game.\n");
+  startLog(stdout, level);
+  LOG(LOG_INFO, "Starting game.\n");
 
-  initializeGame(2, k, atoi(argv[1]), &G);
+  memset(&G, 0, sizeof(struct gameState));
+  initializeGame(2, k, seed, &G);
 
   int money = 0;
   int smithyPos = -1;
@@ -39,22 +65,22 @@ int main (int argc, char** argv) {
 
     if (whoseTurn(&G) == 0) {
       if (smithyPos != -1) {
-        printf("0: smithy played from position %d\n", smithyPos);
-        playCard(smithyPos, -1, -1, -1, &G);
-        printf("smithy played.\n");
+        LOG(LOG_INFO, "0: smithy played from position %d\n", smithyPos);
+        recordedPlayCard(rec, smithyPos, -1, -1, -1, &G);
+        LOG(LOG_INFO, "smithy played.\n");
         money = 0;
         i=0;
         while(i<numHandCards(&G)){
           if (handCard(i, &G) == copper){
-            playCard(i, -1, -1, -1, &G);
+            recordedPlayCard(rec, i, -1, -1, -1, &G);
             money++;
           }
           else if (handCard(i, &G) == silver){
-            playCard(i, -1, -1, -1, &G);
+            recordedPlayCard(rec, i, -1, -1, -1, &G);
             money += 2;
           }
           else if (handCard(i, &G) == gold){
-            playCard(i, -1, -1, -1, &G);
+            recordedPlayCard(rec, i, -1, -1, -1, &G);
             money += 3;
           }
           i++;
@@ -62,43 +88,43 @@ int main (int argc, char** argv) {
       }
 
       if (money >= 8) {
-        printf("0: bought province\n");
-        buyCard(province, &G);
+        LOG(LOG_INFO, "0: bought province\n");
+        recordedBuyCard(rec, province, &G);
       }
       else if (money >= 6) {
-        printf("0: bought gold\n");
-        buyCard(gold, &G);
+        LOG(LOG_INFO, "0: bought gold\n");
+        recordedBuyCard(rec, gold, &G);
       }
       else if ((money >= 4) && (numSmithies < 2)) {
-        printf("0: bought smithy\n");
-        buyCard(smithy, &G);
+        LOG(LOG_INFO, "0: bought smithy\n");
+        recordedBuyCard(rec, smithy, &G);
         numSmithies++;
       }
       else if (money >= 3) {
-        printf("0: bought silver\n");
-        buyCard(silver, &G);
+        LOG(LOG_INFO, "0: bought silver\n");
+        recordedBuyCard(rec, silver, &G);
       }
 
-      printf("0: end turn\n");
-      endTurn(&G);
+      LOG(LOG_INFO, "0: end turn\n");
+      recordedEndTurn(rec, &G);
     }
     else {
       if (adventurerPos != -1) {
-        printf("1: adventurer played from position %d\n", adventurerPos);
-        playCard(adventurerPos, -1, -1, -1, &G);
+        LOG(LOG_INFO, "1: adventurer played from position %d\n", adventurerPos);
+        recordedPlayCard(rec, adventurerPos, -1, -1, -1, &G);
         money = 0;
         i=0;
         while(i<numHandCards(&G)){
           if (handCard(i, &G) == copper){
-            playCard(i, -1, -1, -1, &G);
+            recordedPlayCard(rec, i, -1, -1, -1, &G);
             money++;
           }
           else if (handCard(i, &G) == silver){
-            playCard(i, -1, -1, -1, &G);
+            recordedPlayCard(rec, i, -1, -1, -1, &G);
             money += 2;
           }
           else if (handCard(i, &G) == gold){
-            playCard(i, -1, -1, -1, &G);
+            recordedPlayCard(rec, i, -1, -1, -1, &G);
             money += 3;
           }
           i++;
@@ -106,29 +132,37 @@ int main (int argc, char** argv) {
       }
 
       if (money >= 8) {
-        printf("1: bought province\n");
-        buyCard(province, &G);
+        LOG(LOG_INFO, "1: bought province\n");
+        recordedBuyCard(rec, province, &G);
       }
       else if ((money >= 6) && (numAdventurers < 2)) {
-        printf("1: bought adventurer\n");
-        buyCard(adventurer, &G);
+        LOG(LOG_INFO, "1: bought adventurer\n");
+        recordedBuyCard(rec, adventurer, &G);
         numAdventurers++;
       }else if (money >= 6){
-        printf("1: bought gold\n");
-	    buyCard(gold, &G);
+        LOG(LOG_INFO, "1: bought gold\n");
+	    recordedBuyCard(rec, gold, &G);
         }
       else if (money >= 3){
-        printf("1: bought silver\n");
-	    buyCard(silver, &G);
+        LOG(LOG_INFO, "1: bought silver\n");
+	    recordedBuyCard(rec, silver, &G);
       }
-      printf("1: endTurn\n");
+      LOG(LOG_INFO, "1: endTurn\n");
 
-      endTurn(&G);
+      recordedEndTurn(rec, &G);
     }
   } // end of While
 
-  printf ("Finished game.\n");
-  printf ("Player 0: %d\nPlayer 1: %d\n", scoreFor(0, &G), scoreFor(1, &G));
+  LOG(LOG_INFO, "Finished game.\n");
+  LOG(LOG_INFO, "Player 0: %d\nPlayer 1: %d\n", scoreFor(0, &G), scoreFor(1, &G));
+
+  stopLog();
+
+  if (out != NULL) {
+    writeGameRecord(out, rec);
+    fclose(out);
+    freeGameRecord(rec);
+  }
 
   return 0;
 }
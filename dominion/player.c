@@ -18,6 +18,8 @@
 #include "dominion.h"
 #include "interface.h"
 #include "rngs.h"
+#include "snapshot.h"
+#include "log.h"
 
 
 int main2(int argc, char *argv[]) {
@@ -37,9 +39,11 @@ int main(int argc, char* argv[]) {
 	char *exit = "exit";
 	char *help = "help";
 	char *init = "init";
+	char *load = "load";
 	char *numH = "num";
 	char *play = "play";
 	char *resign  = "resi";
+	char *save = "save";
 	char *show = "show";
 	char *stat = "stat";
 	char *supply = "supp";
@@ -48,6 +52,7 @@ int main(int argc, char* argv[]) {
 	char command[MAX_STRING_LENGTH];
 	char line[MAX_STRING_LENGTH];
 	char cardName[MAX_STRING_LENGTH];
+	char fileName[MAX_STRING_LENGTH];
 
 	//Array to hold bot presence 
 	int isBot[MAX_PLAYERS] = { 0, 0, 0, 0};
@@ -70,15 +75,18 @@ int main(int argc, char* argv[]) {
 
 	memset(game,0,sizeof(struct gameState));
 		
-	if(argc != 2){
-		printf("Usage: player [integer random number seed]\n");
+	if(argc != 2 && !(argc == 3 && strcmp(argv[2], "-v") == 0)){
+		printf("Usage: player [integer random number seed] [-v]\n");
 		return EXIT_SUCCESS;
 	}
 
 	if(randomSeed <= 0){
-		printf("Usage: player [integer random number seed]\n");
+		printf("Usage: player [integer random number seed] [-v]\n");
 		return EXIT_SUCCESS;
 	}	
+
+	//bot turns are logged; -v adds the supply before each one
+	startLog(stdout, argc == 3 ? LOG_DEBUG : LOG_INFO);
 	
 	initializeGame(2,kCards,randomSeed,game);
 
@@ -95,6 +103,7 @@ int main(int argc, char* argv[]) {
 		strcpy(line,"");
 		strcpy(command,"");
 		strcpy(cardName,"");
+		strcpy(fileName,"");
 		
 		currentPlayer = whoseTurn(game);
 		
@@ -120,12 +129,14 @@ int main(int argc, char* argv[]) {
 
 		if(isBot[currentPlayer] == TRUE) {
 				executeBotTurn(currentPlayer, &turnNum, game);
+				logDrain();
 				continue;
 		}
 		
 		printf("$ ");
 		fgets(line, MAX_STRING_LENGTH, stdin);
 		sscanf(line, "%s %d %d %d %d", command, &arg0, &arg1, &arg2, &arg3);
+		sscanf(line, "%*s %31s", fileName);
 
 
 		if(COMPARE(command, add) == 0) {
@@ -172,6 +183,16 @@ int main(int argc, char* argv[]) {
 			}
 
 		} else
+		if(COMPARE(command, load) == 0) {
+			outcome = loadSnapshotFile(fileName, game);
+			if(outcome == SUCCESS){
+				gameStarted = TRUE;
+				currentPlayer = whoseTurn(game);
+				printf("Loaded %s, player %d's turn\n\n", fileName, currentPlayer);
+			} else {
+				printf("Cannot load a game from %s\n\n", fileName);
+			}
+		} else
 		if(COMPARE(command, numH) == 0) {
 			int numCards = numHandCards(game);
 			printf("There are %d cards in your hand.\n", numCards);
@@ -192,6 +213,14 @@ int main(int argc, char* argv[]) {
 			printScores(game);
 			break;
 		} else
+		if(COMPARE(command, save) == 0) {
+			outcome = saveSnapshotFile(fileName, game);
+			if(outcome == SUCCESS){
+				printf("Saved the game to %s\n\n", fileName);
+			} else {
+				printf("Cannot save the game to %s\n\n", fileName);
+			}
+		} else
 		if(COMPARE(command, show) == 0) {
 			if(gameStarted == FALSE) continue;
 			printHand(currentPlayer, game);
@@ -212,6 +241,7 @@ int main(int argc, char* argv[]) {
 		} 
     	}
 	
+	stopLog();
     	return EXIT_SUCCESS;
 
 }
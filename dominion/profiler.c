@@ -0,0 +1,158 @@
+#define _DEFAULT_SOURCE
+#include "profiler.h"
+#include "engineprofile.h"
+#include "simulate.h"
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#define PROFILE_SLOTS 4096      /* distinct stacks, a power of two */
+#define FRAME_BITS 6
+
+struct profileSlot {
+  uint64_t stack;               /* 0 for a free slot */
+  long samples;
+};
+
+static struct profileSlot slots[PROFILE_SLOTS];
+static long dropped;            /* samples of stacks that found no slot */
+static int running = 0;
+
+static const char *frameNames[FRAME_CARD] = {
+  "game", "botTurn", "setup", "shuffle", "drawCard", "playCard", "buyCard",
+  "gainCard", "endTurn", "updateCoins", "scoreFor"
+};
+
+#ifdef ENGINE_PROFILE
+
+/* Depth plus one in the top bits, so no stack packs to 0, and the
+   frames below from the outermost */
+static uint64_t packStack(int depth, const volatile unsigned char *frame) {
+  uint64_t stack;
+  int i;
+
+  if (depth > MAX_FRAME_DEPTH)
+    depth = MAX_FRAME_DEPTH;
+  stack = (uint64_t)(depth + 1) << (MAX_FRAME_DEPTH * FRAME_BITS);
+  for (i = 0; i < depth; i++)
+    stack |= (uint64_t)(frame[i] & ((1 << FRAME_BITS) - 1)) << (i * FRAME_BITS);
+  return stack;
+}
+
+static void countStack(uint64_t stack) {
+  uint64_t expected;
+  unsigned slot = (unsigned)((stack * 0x9e3779b97f4a7c15ULL) >> 52);
+  int probes;
+
+  for (probes = 0; probes < PROFILE_SLOTS; probes++)
+    {
+      expected = 0;
+      if (__atomic_load_n(&slots[slot].stack, __ATOMIC_RELAXED) == stack
+	  || __atomic_compare_exchange_n(&slots[slot].stack, &expected, stack, 0,
+					 __ATOMIC_RELAXED, __ATOMIC_RELAXED)
+	  || expected == stack)
+	{
+	  __atomic_fetch_add(&slots[slot].samples, 1, __ATOMIC_RELAXED);
+	  return;
+	}
+      slot = (slot + 1) % PROFILE_SLOTS;
+    }
+  __atomic_fetch_add(&dropped, 1, __ATOMIC_RELAXED);
+}
+
+static void sample(int signum) {
+  countStack(packStack(engineFrames.depth, engineFrames.frame));
+}
+
+#endif
+
+int startProfiler(int hz) {
+#ifdef ENGINE_PROFILE
+  struct sigaction action;
+  struct itimerval timer;
+
+  if (running || hz < 1 || hz > 1000000)
+    return -1;
+  memset(slots, 0, sizeof(slots));
+  dropped = 0;
+
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = sample;
+  action.sa_flags = SA_RESTART;
+  sigemptyset(&action.sa_mask);
+  if (sigaction(SIGPROF, &action, NULL) != 0)
+    return -1;
+
+  memset(&timer, 0, sizeof(timer));
+  timer.it_interval.tv_sec = hz == 1;
+  timer.it_interval.tv_usec = hz == 1 ? 0 : 1000000 / hz;
+  timer.it_value = timer.it_interval;
+  if (setitimer(ITIMER_PROF, &timer, NULL) != 0)
+    return -1;
+  running = 1;
+  return 0;
+#else
+  return -1;
+#endif
+}
+
+static void writeFrameName(FILE *out, int frame) {
+  if (frame < FRAME_CARD)
+    fprintf(out, ";%s", frameNames[frame]);
+  else if (cardName(frame - FRAME_CARD) != NULL)
+    fprintf(out, ";%s", cardName(frame - FRAME_CARD));
+  else
+    fprintf(out, ";card%d", frame - FRAME_CARD);
+}
+
+static int compareSlots(const void *a, const void *b) {
+  long x = ((const struct profileSlot*)a)->samples;
+  long y = ((const struct profileSlot*)b)->samples;
+  return (x < y) - (x > y);
+}
+
+long stopProfiler(const char *path) {
+  static struct profileSlot sorted[PROFILE_SLOTS];
+  struct itimerval timer;
+  long total = 0;
+  int numStacks = 0;
+  int depth;
+  FILE *out;
+  int i, f;
+
+  if (!running)
+    return -1;
+  memset(&timer, 0, sizeof(timer));
+  setitimer(ITIMER_PROF, &timer, NULL);
+  //ignored rather than defaulted, as a signal still in flight would
+  //otherwise end the process
+  signal(SIGPROF, SIG_IGN);
+  running = 0;
+
+  for (i = 0; i < PROFILE_SLOTS; i++)
+    if (slots[i].stack != 0)
+      sorted[numStacks++] = slots[i];
+  qsort(sorted, numStacks, sizeof(struct profileSlot), compareSlots);
+
+  out = fopen(path, "w");
+  if (out == NULL)
+    return -1;
+  for (i = 0; i < numStacks; i++)
+    {
+      depth = (int)(sorted[i].stack >> (MAX_FRAME_DEPTH * FRAME_BITS)) - 1;
+      fprintf(out, "sim");
+      for (f = 0; f < depth; f++)
+	writeFrameName(out, (sorted[i].stack >> (f * FRAME_BITS))
+		       & ((1 << FRAME_BITS) - 1));
+      fprintf(out, " %ld\n", sorted[i].samples);
+      total += sorted[i].samples;
+    }
+  if (dropped > 0)
+    fprintf(out, "sim;[overflow] %ld\n", dropped);
+  if (fclose(out) != 0)
+    return -1;
+  return total + dropped;
+}
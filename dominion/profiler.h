@@ -0,0 +1,27 @@
+#ifndef _PROFILER_H
+#define _PROFILER_H
+
+/* Sampling profiler for the engine's frames (see engineprofile.h).
+
+   SIGPROF arrives hz times per second of the process's CPU time, on
+   whichever thread is running, and its handler counts that thread's
+   current stack of engine frames in a fixed table with atomic updates,
+   so it neither allocates nor locks.  The profile is written as folded
+   stacks, one line per distinct stack with its sample count,
+
+     sim;game;botTurn;playCard;adventurer;drawCard;shuffle 412
+
+   as flame graph tools read them.  "sim" alone is time outside the
+   engine's frames.  The kernel delivers at most one signal per clock
+   tick, so rates above its tick rate (often 250 Hz) give fewer samples
+   than asked for. */
+
+int startProfiler(int hz);
+/* -1 if the engine was built without ENGINE_PROFILE, the timer cannot
+   be set, or a profile is already running */
+
+long stopProfiler(const char *path);
+/* Stops sampling and writes the profile; returns the number of samples,
+   -1 if the file cannot be written */
+
+#endif
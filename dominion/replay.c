@@ -0,0 +1,201 @@
+/* Replays compact game records (see gamerecord.h)
+
+   replay [-q] recordFile
+   replay -a archiveFile [game [turn]]
+
+   Prints a transcript of every game in the file followed by its final
+   scores; -q prints only the scores and the replay rate.  With -a the
+   file is a game archive (see archive.h): without a game it lists the
+   games, otherwise it shows the game as it stood after turn (default:
+   at its end), sought through the archive's keyframes. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "archive.h"
+#include "dominion.h"
+#include "gamerecord.h"
+#include "simulate.h"
+
+static int printAction(const struct recordAction *action,
+		       struct gameState *state, void *ctx) {
+  int *player = ctx;
+
+  switch (action->type)
+    {
+    case ACTION_PLAY:
+      printf("%d: play %s from position %d", *player, cardName(action->card),
+	     action->handPos);
+      if (action->choice1 != -1 || action->choice2 != -1 || action->choice3 != -1)
+	printf(" (%d, %d, %d)", action->choice1, action->choice2, action->choice3);
+      printf("\n");
+      break;
+    case ACTION_BUY:
+      printf("%d: buy %s\n", *player, cardName(action->card));
+      break;
+    case ACTION_END:
+      printf("%d: end turn\n", *player);
+      break;
+    }
+
+  *player = whoseTurn(state);
+  return 0;
+}
+
+static void printState(struct gameState *state) {
+  int card;
+  int i, p;
+
+  printf("Player %d to play, phase %d, %d actions, %d buys\n", whoseTurn(state),
+	 state->phase, state->numActions, state->numBuys);
+  for (p = 0; p < state->numPlayers; p++)
+    {
+      printf("Player %d: score %d, deck %d, discard %d, hand", p,
+	     scoreFor(p, state), state->deckCount[p], state->discardCount[p]);
+      for (i = 0; i < state->handCount[p]; i++)
+	printf(" %s", cardName(state->hand[p][i]));
+      printf("\n");
+    }
+  printf("Supply:");
+  for (card = curse; card <= treasure_map; card++)
+    if (state->supplyCount[card] >= 0)
+      printf(" %s %d", cardName(card), state->supplyCount[card]);
+  printf("\n");
+}
+
+static int showArchive(int argc, char **argv) {
+  struct gameArchive archive;
+  struct recordHeader header;
+  struct gameState G;
+  const unsigned char *data;
+  size_t length;
+  long game;
+  long turn;
+  long reached;
+  long g;
+
+  if (openArchive(&archive, argv[0]) < 0)
+    {
+      printf("Cannot open archive %s\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+
+  if (argc == 1)
+    {
+      printf("%ld games, keyframes every %u turns\n", archiveNumGames(&archive),
+	     archive.header->keyframeInterval);
+      for (g = 0; g < archiveNumGames(&archive); g++)
+	{
+	  data = archiveRecord(&archive, g, &length);
+	  if (data == NULL || readRecordHeader(data, length, &header) < 0)
+	    {
+	      printf("Game %ld is malformed\n", g);
+	      continue;
+	    }
+	  printf("Game %ld: %d players, seed %d, %lu bytes, %u keyframes\n", g,
+		 header.numPlayers, header.seed, (unsigned long)length,
+		 archive.index[g].numKeyframes);
+	}
+      closeArchive(&archive);
+      return EXIT_SUCCESS;
+    }
+
+  game = atol(argv[1]);
+  turn = argc > 2 ? atol(argv[2]) : MAX_GAME_TURNS;
+  reached = archiveSeek(&archive, game, turn, &G);
+  closeArchive(&archive);
+  if (reached < 0)
+    {
+      printf("Cannot seek to turn %ld of game %ld\n", turn, game);
+      return EXIT_FAILURE;
+    }
+
+  printf("Game %ld after turn %ld%s\n", game, reached,
+	 reached < turn ? " (end of game)" : "");
+  printState(&G);
+  return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv) {
+  struct gameRecord record;
+  struct recordHeader header;
+  struct gameState G;
+  FILE *in;
+  int quiet = 0;
+  int games = 0;
+  long bytes = 0;
+  int player;
+  int i;
+  clock_t start;
+  double seconds;
+
+  if (argc > 2 && argc < 6 && strcmp(argv[1], "-a") == 0)
+    return showArchive(argc - 2, argv + 2);
+  if (argc > 1 && strcmp(argv[1], "-q") == 0)
+    {
+      quiet = 1;
+      argc--;
+      argv++;
+    }
+  if (argc != 2)
+    {
+      printf("Usage: replay [-q] recordFile\n");
+      printf("       replay -a archiveFile [game [turn]]\n");
+      return EXIT_FAILURE;
+    }
+
+  in = fopen(argv[1], "rb");
+  if (in == NULL)
+    {
+      printf("Cannot open %s\n", argv[1]);
+      return EXIT_FAILURE;
+    }
+
+  initGameRecord(&record);
+  start = clock();
+  while (readGameRecord(in, &record) == 0)
+    {
+      if (readRecordHeader(record.data, record.length, &header) < 0)
+	{
+	  printf("Record %d is malformed\n", games);
+	  break;
+	}
+      if (!quiet)
+	{
+	  printf("Game %d: %d players, seed %d, kingdom", games,
+		 header.numPlayers, header.seed);
+	  for (i = 0; i < 10; i++)
+	    printf(" %s", cardName(header.kingdom[i]));
+	  printf(", %lu bytes\n", (unsigned long)record.length);
+	}
+
+      player = 0;
+      if (replayGameRecord(record.data, record.length, &G,
+			   quiet ? NULL : printAction, &player) < 0)
+	{
+	  printf("Record %d is malformed\n", games);
+	  break;
+	}
+
+      printf("Game %d scores:", games);
+      for (i = 0; i < header.numPlayers; i++)
+	printf(" %d", scoreFor(i, &G));
+      printf("\n");
+
+      games++;
+      bytes += record.length;
+    }
+  seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+  printf("%d games, %ld bytes", games, bytes);
+  if (games > 0)
+    printf(", %.1f bytes per game", (double)bytes / games);
+  if (quiet && seconds > 0)
+    printf(", %.0f games/sec", games / seconds);
+  printf("\n");
+
+  fclose(in);
+  freeGameRecord(&record);
+  return EXIT_SUCCESS;
+}
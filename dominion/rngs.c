@@ -43,9 +43,12 @@
 #define A256       22925      /* jump multiplier, DON'T CHANGE THIS VALUE */
 #define DEFAULT    123456789  /* initial seed, use 0 < DEFAULT < MODULUS  */
       
-static long seed[STREAMS] = {DEFAULT};  /* current state of each stream   */
-static int  stream        = 0;          /* stream index, 0 is the default */
-static int  initialized   = 0;          /* test for stream initialization */
+/* Generator state is per thread so concurrent simulations do not share */
+/* (and race on) one set of streams; a single-threaded program sees no  */
+/* difference.                                                           */
+static __thread long seed[STREAMS] = {DEFAULT};  /* current state of each stream   */
+static __thread int  stream        = 0;          /* stream index, 0 is the default */
+static __thread int  initialized   = 0;          /* test for stream initialization */
 
 
    double Random(void)
@@ -137,6 +140,27 @@ static int  initialized   = 0;          /* test for stream initialization */
 }
 
 
+   long JumpSeed(long x, int jumps)
+/* ------------------------------------------------------------------
+ * Use this function to find the state that is jumps stream spacings
+ * (8,367,782 calls to Random() each) ahead of state x, the same
+ * spacing PlantSeeds puts between neighbouring streams.  x must be a
+ * valid state, 0 < x < MODULUS.
+ * ------------------------------------------------------------------
+ */
+{
+  const long Q = MODULUS / A256;
+  const long R = MODULUS % A256;
+
+  while (jumps-- > 0) {
+    x = A256 * (x % Q) - R * (x / Q);
+    if (x <= 0)
+      x += MODULUS;
+  }
+  return x;
+}
+
+
    void SelectStream(int index)
 /* ------------------------------------------------------------------
  * Use this function to set the current random number generator
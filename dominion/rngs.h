@@ -14,6 +14,7 @@ void   PlantSeeds(long x);
 void   GetSeed(long *x);
 void   PutSeed(long x);
 void   SelectStream(int index);
+long   JumpSeed(long x, int jumps);
 void   TestRandom(void);
 
 #endif
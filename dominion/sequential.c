@@ -0,0 +1,64 @@
+#include "sequential.h"
+#include <math.h>
+#include <string.h>
+
+int initSprt(struct sprt *test, double delta, double alpha, double beta) {
+  if (delta <= 0.0 || delta >= 0.5 || alpha <= 0.0 || alpha >= 0.5
+      || beta <= 0.0 || beta >= 0.5)
+    return -1;
+
+  memset(test, 0, sizeof(struct sprt));
+  test->delta = delta;
+  test->logEdge = log((0.5 + delta) / 0.5);
+  test->logNoEdge = log((0.5 - delta) / 0.5);
+  test->lower = log(beta / (1.0 - alpha));
+  test->upper = log((1.0 - beta) / alpha);
+  test->decision = SPRT_CONTINUE;
+  return 0;
+}
+
+/* Steps one test unless it has accepted p = 0.5; returns 1 once its
+   strategy's edge is accepted */
+static int stepTest(struct sprt *test, double *llr, int *done, double step) {
+  if (*done)
+    return 0;
+  *llr += step;
+  if (*llr >= test->upper)
+    return 1;
+  if (*llr <= test->lower)
+    *done = 1;
+  return 0;
+}
+
+int sprtUpdate(struct sprt *test, int outcome) {
+  if (test->decision != SPRT_CONTINUE)
+    return test->decision;
+
+  if (outcome > 0)
+    {
+      test->wins++;
+      if (stepTest(test, &test->llrFirst, &test->firstDone, test->logEdge))
+	test->decision = SPRT_FIRST_BETTER;
+      stepTest(test, &test->llrSecond, &test->secondDone, test->logNoEdge);
+    }
+  else if (outcome < 0)
+    {
+      test->losses++;
+      stepTest(test, &test->llrFirst, &test->firstDone, test->logNoEdge);
+      if (stepTest(test, &test->llrSecond, &test->secondDone, test->logEdge))
+	test->decision = SPRT_SECOND_BETTER;
+    }
+  else
+    {
+      test->ties++;
+    }
+
+  if (test->decision == SPRT_CONTINUE && test->firstDone && test->secondDone)
+    test->decision = SPRT_EQUIVALENT;
+
+  return test->decision;
+}
+
+long sprtGames(struct sprt *test) {
+  return test->wins + test->losses + test->ties;
+}
@@ -0,0 +1,46 @@
+#ifndef _SEQUENTIAL_H
+#define _SEQUENTIAL_H
+
+/* Sequential test of a head-to-head win rate p, the chance that the
+   first strategy wins a decisive game, as two one-sided Wald SPRTs run
+   on the same games.
+
+   Ties carry no information and are only counted.  One test weighs
+   p = 0.5 + delta against p = 0.5, the other p = 0.5 - delta against
+   p = 0.5.  A strategy is better once its test accepts its edge; the
+   two are within +-delta of each other once both tests accept 0.5.
+   Either strategy is called better with probability at most alpha when
+   p = 0.5, and the stronger one is missed with probability at most
+   beta when p is delta or more away from it. */
+
+#define SPRT_CONTINUE 0
+#define SPRT_FIRST_BETTER 1    /* accepted p = 0.5 + delta */
+#define SPRT_SECOND_BETTER 2   /* accepted p = 0.5 - delta */
+#define SPRT_EQUIVALENT 3      /* accepted p = 0.5 in both tests */
+
+struct sprt {
+  double delta;
+  double logEdge;    //LLR step of a one-sided test for a game its strategy won
+  double logNoEdge;  //and for one it lost
+  double lower;      //a test accepts p = 0.5 at or below
+  double upper;      //and its strategy's edge at or above
+  double llrFirst;   //the first strategy's test
+  double llrSecond;
+  int firstDone;     //that test accepted a hypothesis
+  int secondDone;
+  long wins;
+  long losses;
+  long ties;
+  int decision;
+};
+
+int initSprt(struct sprt *test, double delta, double alpha, double beta);
+/* -1 unless 0 < delta < 0.5 and 0 < alpha, beta < 0.5 */
+
+int sprtUpdate(struct sprt *test, int outcome);
+/* outcome > 0 first strategy won, < 0 second won, 0 tie.  Returns the
+   decision, which sticks once made */
+
+long sprtGames(struct sprt *test);
+
+#endif
@@ -0,0 +1,1213 @@
+/* Batch Dominion simulator
+
+   Every mode also takes --streams shared|player to pick the engine's
+   shuffle streams (see initializeGameStreams), and --profile file to
+   sample where the engine spends its time into a folded-stack profile
+   (see profiler.h), in a sim built by make simprof.
+
+   sim tournament [-n seeds] [-t threads] [-s firstSeed] [-k kingdom]
+                  [--stats file] [--aggregate file]
+                  [--checkpoint file [--checkpoint-every seconds]]
+                  [--shard i/K] [strategy ...]
+   sim compare    [-n maxGames] [--alpha a] [--beta b] [--delta d]
+                  [--batch games] [-t threads] [-s firstSeed] [-k kingdom]
+                  first second
+   sim paired     [-n seeds] [-t threads] [-s firstSeed] [-k kingdom]
+                  candidateA candidateB opponent
+   sim archive    -o file [--keyframes turns] [-n seeds] [-t threads]
+                  [-s firstSeed] [-k kingdom] first second
+   sim sweep      [-n seeds] [-t threads] [-s firstSeed] [--ranks lo:hi]
+                  [--shard i/K] first second
+   sim merge      -o file part.agg ...
+
+   A tournament's games can be split between K processes, on one host
+   or several sharing a filesystem, by running the same command with
+   --shard 0/K to --shard K-1/K and --aggregate.  sim merge combines
+   their aggregator files into exactly the file one process writes.
+
+   A sweep plays first against second in every kingdom, numbered by
+   kingdomRank, or in ranks lo to hi - 1, and prints a table row per
+   kingdom; --shard splits the ranks the same way.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "aggregator.h"
+#include "archive.h"
+#include "checkpoint.h"
+#include "dominion.h"
+#include "gamerecord.h"
+#include "gamestats.h"
+#include "profiler.h"
+#include "sequential.h"
+#include "simulate.h"
+#include "strategy.h"
+#include "threadpool.h"
+
+#define Z_95 1.959964
+#define PROFILE_HZ 997          /* prime, so samples do not lock step with periodic work */
+
+struct simOptions {
+  long games;          //seeds per matchup and seat order
+  int threads;
+  int firstSeed;
+  int kingdom[10];
+  int numStrategies;
+  int strategyIds[MAX_STRATEGIES];
+  double alpha;        //sequential test error rates
+  double beta;
+  double delta;        //smallest win-rate edge over 50% worth detecting
+  long batch;          //games simulated between sequential checks
+  int rngMode;         //RNG_SHARED or RNG_PER_PLAYER
+  const char *output;  //archive file
+  const char *stats;   //per-game statistics file (see gamestats.h)
+  const char *aggregate;  //summary of every game (see aggregator.h)
+  const char *checkpoint; //progress file a tournament resumes from
+  int checkpointEvery; //seconds between checkpoints
+  int shard;           //this process plays shard of numShards slices
+  int numShards;
+  long firstRank;      //kingdoms swept
+  long lastRank;
+  int keyframes;       //turns between archive keyframes, 0 for none
+  const char *profile; //folded-stack profile file
+  struct gameTemplate game;  //two-player setup of kingdom, for playTemplateGame
+};
+
+static void printUsage(void) {
+  int i;
+  printf("Usage: sim tournament [-n seeds] [-t threads] [-s firstSeed] [-k card,...] [--stats file]\n");
+  printf("                      [--aggregate file] [--checkpoint file [--checkpoint-every seconds]]\n");
+  printf("                      [--shard i/K] [strategy ...]\n");
+  printf("       sim compare [-n maxGames] [--alpha a] [--beta b] [--delta d] [--batch games]\n");
+  printf("                   [-t threads] [-s firstSeed] [-k card,...] first second\n");
+  printf("       sim paired [-n seeds] [-t threads] [-s firstSeed] [-k card,...]\n");
+  printf("                  candidateA candidateB opponent\n");
+  printf("       sim archive -o file [--keyframes turns] [-n seeds] [-t threads] [-s firstSeed]\n");
+  printf("                   [-k card,...] first second\n");
+  printf("       sim sweep [-n seeds] [-t threads] [-s firstSeed] [--ranks lo:hi] [--shard i/K]\n");
+  printf("                 first second\n");
+  printf("       sim merge -o file part.agg ...\n");
+  printf("Options for every mode: --streams shared|player --profile file\n");
+  printf("Strategies:");
+  for (i = 0; i < numStrategies(); i++)
+    printf(" %s", getStrategy(i)->name);
+  printf("\n");
+}
+
+static int parseOptions(int argc, char **argv, struct simOptions *opt) {
+  int i;
+  int id;
+
+  opt->games = 1000;
+  opt->threads = 0;
+  opt->firstSeed = 1;
+  opt->numStrategies = 0;
+  opt->alpha = 0.05;
+  opt->beta = 0.05;
+  opt->delta = 0.02;
+  opt->batch = 4096;
+  opt->output = NULL;
+  opt->stats = NULL;
+  opt->aggregate = NULL;
+  opt->checkpoint = NULL;
+  opt->checkpointEvery = 60;
+  opt->shard = 0;
+  opt->numShards = 1;
+  opt->firstRank = 0;
+  opt->lastRank = NUM_KINGDOMS;
+  opt->keyframes = 0;
+  opt->profile = NULL;
+  //paired replays only stay paired if a player's buys cannot reshuffle
+  //the opponent, so they default to per-player streams
+  opt->rngMode = strcmp(argv[1], "paired") == 0 ? RNG_PER_PLAYER : RNG_SHARED;
+  defaultKingdom(opt->kingdom);
+
+  for (i = 2; i < argc; i++)
+    {
+      if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+	opt->games = atol(argv[++i]);
+      else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+	opt->threads = atoi(argv[++i]);
+      else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+	opt->firstSeed = atoi(argv[++i]);
+      else if (strcmp(argv[i], "--alpha") == 0 && i + 1 < argc)
+	opt->alpha = atof(argv[++i]);
+      else if (strcmp(argv[i], "--beta") == 0 && i + 1 < argc)
+	opt->beta = atof(argv[++i]);
+      else if (strcmp(argv[i], "--delta") == 0 && i + 1 < argc)
+	opt->delta = atof(argv[++i]);
+      else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc)
+	opt->batch = atol(argv[++i]);
+      else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+	opt->output = argv[++i];
+      else if (strcmp(argv[i], "--stats") == 0 && i + 1 < argc)
+	opt->stats = argv[++i];
+      else if (strcmp(argv[i], "--aggregate") == 0 && i + 1 < argc)
+	opt->aggregate = argv[++i];
+      else if (strcmp(argv[i], "--checkpoint") == 0 && i + 1 < argc)
+	opt->checkpoint = argv[++i];
+      else if (strcmp(argv[i], "--checkpoint-every") == 0 && i + 1 < argc)
+	opt->checkpointEvery = atoi(argv[++i]);
+      else if (strcmp(argv[i], "--shard") == 0 && i + 1 < argc)
+	{
+	  if (sscanf(argv[++i], "%d/%d", &opt->shard, &opt->numShards) != 2
+	      || opt->numShards < 1 || opt->shard < 0 || opt->shard >= opt->numShards)
+	    {
+	      printf("Bad shard: %s\n", argv[i]);
+	      return -1;
+	    }
+	}
+      else if (strcmp(argv[i], "--ranks") == 0 && i + 1 < argc)
+	{
+	  if (sscanf(argv[++i], "%ld:%ld", &opt->firstRank, &opt->lastRank) != 2
+	      || opt->firstRank < 0 || opt->lastRank > NUM_KINGDOMS
+	      || opt->firstRank >= opt->lastRank)
+	    {
+	      printf("Bad ranks: %s (kingdoms are numbered 0 to %ld)\n", argv[i],
+		     NUM_KINGDOMS - 1);
+	      return -1;
+	    }
+	}
+      else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc)
+	opt->profile = argv[++i];
+      else if (strcmp(argv[i], "--keyframes") == 0 && i + 1 < argc)
+	opt->keyframes = atoi(argv[++i]);
+      else if (strcmp(argv[i], "--streams") == 0 && i + 1 < argc)
+	{
+	  i++;
+	  if (strcmp(argv[i], "shared") == 0)
+	    opt->rngMode = RNG_SHARED;
+	  else if (strcmp(argv[i], "player") == 0)
+	    opt->rngMode = RNG_PER_PLAYER;
+	  else
+	    return -1;
+	}
+      else if (strcmp(argv[i], "-k") == 0 && i + 1 < argc)
+	{
+	  if (parseKingdom(argv[++i], opt->kingdom) < 0)
+	    {
+	      printf("Bad kingdom: %s\n", argv[i]);
+	      return -1;
+	    }
+	}
+      else
+	{
+	  id = findStrategy(argv[i]);
+	  if (id < 0 || opt->numStrategies == MAX_STRATEGIES)
+	    {
+	      printf("Unknown strategy: %s\n", argv[i]);
+	      return -1;
+	    }
+	  opt->strategyIds[opt->numStrategies++] = id;
+	}
+    }
+
+  if (opt->numStrategies == 0)
+    {
+      for (i = 0; i < numStrategies() && i < MAX_STRATEGIES; i++)
+	opt->strategyIds[opt->numStrategies++] = i;
+    }
+  if (opt->games < 1 || opt->firstSeed < 1 || opt->batch < 1 || opt->keyframes < 0)
+    return -1;
+  return 0;
+}
+
+static void printKingdom(int kingdom[10]) {
+  int i;
+  for (i = 0; i < 10; i++)
+    printf("%s%s", i ? "," : "", cardName(kingdom[i]));
+}
+
+/* Tournament */
+/* --------------------------------------------------------------- */
+
+/* Outcomes by seat for one ordered matchup */
+struct matchupCounts {
+  long games;
+  long firstWins;     //seat 0 wins outright
+  long secondWins;    //seat 1 wins outright
+  long ties;          //shared wins
+  long unfinished;    //hit the turn cap
+};
+
+struct tournamentTotals {
+  struct matchupCounts matchups[MAX_STRATEGIES][MAX_STRATEGIES];  //[seat 0][seat 1]
+  struct aggregator agg;  //indexed by registry id
+};
+
+/* Workers only play games; the results of a batch are then folded into
+   the totals in game order, so every total, floating point included,
+   is the same whatever the thread count and wherever a run resumed */
+struct tournament {
+  struct simOptions *opt;
+  int pairs[MAX_STRATEGIES * MAX_STRATEGIES][2];
+  int numPairs;
+  long batchStart;
+  struct gameResult *results;  //per game of the batch, numPlayers 0 if not played
+  struct statsRow *rows;       //per game of the batch when writing statistics
+};
+
+static void tournamentGame(struct tournament *t, long g, int ids[2],
+			   int *seed) {
+  int pair = (int)(g / t->opt->games);
+  *seed = t->opt->firstSeed + (int)(g % t->opt->games);
+  ids[0] = t->opt->strategyIds[t->pairs[pair][0]];
+  ids[1] = t->opt->strategyIds[t->pairs[pair][1]];
+}
+
+static void tournamentRange(long lo, long hi, int worker, void *accum,
+			    void *ctx) {
+  struct tournament *t = ctx;
+  struct gameState state;
+  struct gameResult *result;
+  int ids[2];
+  int seed;
+  long g;
+
+  for (g = lo; g < hi; g++)
+    {
+      tournamentGame(t, g, ids, &seed);
+      result = &t->results[g - t->batchStart];
+      if (playTemplateGame(&t->opt->game, ids, seed, &state, result) < 0)
+	{
+	  result->numPlayers = 0;
+	  continue;
+	}
+      if (t->rows != NULL)
+	fillStatsRow(&t->rows[g - t->batchStart], 2, ids, t->opt->kingdom, seed,
+		     t->opt->rngMode, &state, result);
+    }
+}
+
+static void foldTournamentGame(struct tournament *t, long g,
+			       struct tournamentTotals *total) {
+  struct gameResult *result = &t->results[g - t->batchStart];
+  struct matchupCounts *m;
+  int pair = (int)(g / t->opt->games);
+  int ids[2];
+  int seed;
+
+  if (result->numPlayers == 0)
+    return;
+  tournamentGame(t, g, ids, &seed);
+  aggregateGame(&total->agg, ids, result);
+  m = &total->matchups[t->pairs[pair][0]][t->pairs[pair][1]];
+  m->games++;
+  if (!result->finished)
+    m->unfinished++;
+  if (result->winners[0] && result->winners[1])
+    m->ties++;
+  else if (result->winners[0])
+    m->firstWins++;
+  else
+    m->secondWins++;
+}
+
+/* A checkpoint is the run's parameters, the number of games done and
+   the totals so far.  Every game reseeds the RNG streams from its own
+   seed, so the next game index is all the position there is to keep */
+static void encodeTournamentRun(struct checkpointBuffer *buffer,
+				struct simOptions *opt) {
+  int i;
+
+  putCheckpointWord(buffer, opt->games);
+  putCheckpointWord(buffer, opt->firstSeed);
+  putCheckpointWord(buffer, opt->rngMode);
+  putCheckpointWord(buffer, opt->shard);
+  putCheckpointWord(buffer, opt->numShards);
+  for (i = 0; i < 10; i++)
+    putCheckpointWord(buffer, opt->kingdom[i]);
+  putCheckpointWord(buffer, opt->numStrategies);
+  for (i = 0; i < opt->numStrategies; i++)
+    putCheckpointBytes(buffer, getStrategy(opt->strategyIds[i])->name,
+		       strlen(getStrategy(opt->strategyIds[i])->name) + 1);
+}
+
+static int saveTournament(struct simOptions *opt, long done,
+			  struct tournamentTotals *total) {
+  struct checkpointBuffer buffer;
+  unsigned char *agg;
+  int a, b, r;
+
+  agg = malloc(aggregatorSize());
+  if (agg == NULL)
+    return -1;
+  serializeAggregator(&total->agg, agg, aggregatorSize());
+
+  initCheckpointBuffer(&buffer);
+  encodeTournamentRun(&buffer, opt);
+  putCheckpointWord(&buffer, done);
+  for (a = 0; a < MAX_STRATEGIES; a++)
+    for (b = 0; b < MAX_STRATEGIES; b++)
+      {
+	struct matchupCounts *m = &total->matchups[a][b];
+	putCheckpointWord(&buffer, m->games);
+	putCheckpointWord(&buffer, m->firstWins);
+	putCheckpointWord(&buffer, m->secondWins);
+	putCheckpointWord(&buffer, m->ties);
+	putCheckpointWord(&buffer, m->unfinished);
+      }
+  putCheckpointBytes(&buffer, agg, aggregatorSize());
+
+  r = writeCheckpoint(opt->checkpoint, &buffer);
+  freeCheckpointBuffer(&buffer);
+  free(agg);
+  return r;
+}
+
+/* Games already done by the checkpointed run, 0 when there is no
+   checkpoint, -1 if the file is damaged or belongs to a different run */
+static long resumeTournament(struct simOptions *opt,
+			     struct tournamentTotals *total) {
+  struct checkpointBuffer saved;
+  struct checkpointBuffer expected;
+  unsigned char *agg;
+  uint64_t done;
+  uint64_t v[5];
+  int a, b;
+  long r = -1;
+  FILE *exists;
+
+  exists = fopen(opt->checkpoint, "rb");
+  if (exists == NULL)
+    return 0;
+  fclose(exists);
+  initCheckpointBuffer(&saved);
+  if (readCheckpoint(opt->checkpoint, &saved) < 0)
+    return -1;
+  initCheckpointBuffer(&expected);
+  encodeTournamentRun(&expected, opt);
+  agg = malloc(aggregatorSize());
+
+  if (agg != NULL && saved.length > expected.length
+      && memcmp(saved.data, expected.data, expected.length) == 0)
+    {
+      saved.offset = expected.length;
+      r = getCheckpointWord(&saved, &done) < 0 ? -1 : (long)done;
+      for (a = 0; a < MAX_STRATEGIES && r >= 0; a++)
+	for (b = 0; b < MAX_STRATEGIES && r >= 0; b++)
+	  {
+	    struct matchupCounts *m = &total->matchups[a][b];
+	    if (getCheckpointWord(&saved, &v[0]) < 0 || getCheckpointWord(&saved, &v[1]) < 0
+		|| getCheckpointWord(&saved, &v[2]) < 0 || getCheckpointWord(&saved, &v[3]) < 0
+		|| getCheckpointWord(&saved, &v[4]) < 0)
+	      r = -1;
+	    m->games = v[0];
+	    m->firstWins = v[1];
+	    m->secondWins = v[2];
+	    m->ties = v[3];
+	    m->unfinished = v[4];
+	  }
+      if (r >= 0 && (getCheckpointBytes(&saved, agg, aggregatorSize()) < 0
+		     || deserializeAggregator(agg, aggregatorSize(), &total->agg) < 0))
+	r = -1;
+    }
+
+  free(agg);
+  freeCheckpointBuffer(&saved);
+  freeCheckpointBuffer(&expected);
+  return r;
+}
+
+static int runTournament(struct simOptions *opt) {
+  struct tournament t;
+  struct tournamentTotals total;
+  struct threadPool *pool;
+  struct statsWriter stats;
+  int a, b;
+  long unfinished = 0;
+  long games;
+  long first, last;   //this shard's games
+  long end;
+  long g;
+  time_t lastCheckpoint;
+
+  if (opt->numStrategies < 2)
+    {
+      printf("A tournament needs at least two strategies\n");
+      return -1;
+    }
+  if (opt->checkpoint != NULL && opt->stats != NULL)
+    {
+      printf("--stats cannot be resumed, so it does not combine with --checkpoint\n");
+      return -1;
+    }
+
+  //every ordered pair, so each matchup is played from both seats
+  t.opt = opt;
+  t.numPairs = 0;
+  for (a = 0; a < opt->numStrategies; a++)
+    for (b = 0; b < opt->numStrategies; b++)
+      if (a != b)
+	{
+	  t.pairs[t.numPairs][0] = a;
+	  t.pairs[t.numPairs][1] = b;
+	  t.numPairs++;
+	}
+  games = opt->games * t.numPairs;
+  //each shard a contiguous slice of game indices, so every game's seed
+  //and seats are those it has in a single-process run
+  first = games * opt->shard / opt->numShards;
+  last = games * (opt->shard + 1) / opt->numShards;
+
+  memset(&total, 0, sizeof(total));
+  initAggregator(&total.agg);
+  t.batchStart = first;
+  if (opt->checkpoint != NULL)
+    {
+      g = resumeTournament(opt, &total);
+      if (g > 0)
+	t.batchStart = g;
+      if (g < 0 || g > last)
+	{
+	  printf("%s is not a checkpoint of this run\n", opt->checkpoint);
+	  return -1;
+	}
+    }
+
+  pool = newThreadPool(opt->threads, 0);
+  t.results = malloc(opt->batch * sizeof(struct gameResult));
+  t.rows = NULL;
+  if (opt->stats != NULL)
+    t.rows = malloc(opt->batch * sizeof(struct statsRow));
+  if (pool == NULL || t.results == NULL || (opt->stats != NULL && t.rows == NULL))
+    {
+      printf("Could not start worker threads\n");
+      freeThreadPool(pool);
+      free(t.results);
+      free(t.rows);
+      return -1;
+    }
+  if (opt->stats != NULL && openStatsWriter(&stats, opt->stats, 0) < 0)
+    {
+      printf("Cannot create %s\n", opt->stats);
+      freeThreadPool(pool);
+      free(t.results);
+      free(t.rows);
+      return -1;
+    }
+
+  printf("Tournament: %d strategies, %ld seeds per seat order, %ld games, %d threads\n",
+	 opt->numStrategies, opt->games, games, poolNumWorkers(pool));
+  printf("Kingdom: ");
+  printKingdom(opt->kingdom);
+  printf("\n\n");
+  if (opt->numShards > 1)
+    printf("Shard %d of %d: games %ld to %ld\n\n", opt->shard, opt->numShards,
+	   first, last - 1);
+  if (t.batchStart > first)
+    printf("Resuming from %s after %ld games\n\n", opt->checkpoint,
+	   t.batchStart - first);
+
+  lastCheckpoint = time(NULL);
+  for (; t.batchStart < last; t.batchStart = end)
+    {
+      end = t.batchStart + opt->batch;
+      if (end > last)
+	end = last;
+      poolParallelFor(pool, t.batchStart, end, 64, tournamentRange, &t);
+      for (g = t.batchStart; g < end; g++)
+	{
+	  foldTournamentGame(&t, g, &total);
+	  if (t.rows != NULL && t.results[g - t.batchStart].numPlayers > 0)
+	    statsAppend(&stats, &t.rows[g - t.batchStart]);
+	}
+
+      if (opt->checkpoint != NULL && end < last
+	  && difftime(time(NULL), lastCheckpoint) >= opt->checkpointEvery)
+	{
+	  if (saveTournament(opt, end, &total) < 0)
+	    printf("Could not write checkpoint %s\n", opt->checkpoint);
+	  lastCheckpoint = time(NULL);
+	}
+    }
+  if (t.rows != NULL && closeStatsWriter(&stats) < 0)
+    printf("Error writing %s\n", opt->stats);
+  //finished runs start afresh
+  if (opt->checkpoint != NULL)
+    remove(opt->checkpoint);
+
+  free(t.results);
+  free(t.rows);
+  freeThreadPool(pool);
+
+  printf("Win rate of row against column over both seat orders, 95%% interval\n");
+  printf("%-16s", "");
+  for (b = 0; b < opt->numStrategies; b++)
+    printf(" %-22s", getStrategy(opt->strategyIds[b])->name);
+  printf("\n");
+  for (a = 0; a < opt->numStrategies; a++)
+    {
+      printf("%-16s", getStrategy(opt->strategyIds[a])->name);
+      for (b = 0; b < opt->numStrategies; b++)
+	{
+	  struct matchupCounts *first = &total.matchups[a][b];
+	  struct matchupCounts *second = &total.matchups[b][a];
+	  long n = first->games + second->games;
+	  long wins = first->firstWins + second->secondWins;
+	  double lo, hi;
+	  if (a == b)
+	    {
+	      printf(" %-22s", "-");
+	      continue;
+	    }
+	  wilsonInterval(wins, n, Z_95, &lo, &hi);
+	  printf(" %5.1f%% [%5.1f,%5.1f] ", n ? 100.0 * wins / n : 0.0,
+		 100.0 * lo, 100.0 * hi);
+	}
+      printf("\n");
+    }
+
+  printf("\nWin/tie/loss of row against column (as first seat + as second seat)\n");
+  for (a = 0; a < opt->numStrategies; a++)
+    for (b = a + 1; b < opt->numStrategies; b++)
+      {
+	struct matchupCounts *first = &total.matchups[a][b];
+	struct matchupCounts *second = &total.matchups[b][a];
+	printf("%-16s vs %-16s W %ld T %ld L %ld  (first seat W %ld T %ld L %ld; second seat W %ld T %ld L %ld)\n",
+	       getStrategy(opt->strategyIds[a])->name,
+	       getStrategy(opt->strategyIds[b])->name,
+	       first->firstWins + second->secondWins,
+	       first->ties + second->ties,
+	       first->secondWins + second->firstWins,
+	       first->firstWins, first->ties, first->secondWins,
+	       second->secondWins, second->ties, second->firstWins);
+	unfinished += first->unfinished + second->unfinished;
+      }
+
+  if (unfinished > 0)
+    printf("\n%ld games hit the %d turn limit and were scored as they stood\n",
+	   unfinished, MAX_GAME_TURNS);
+
+  if (opt->aggregate != NULL)
+    {
+      printf("\n");
+      printAggregator(stdout, &total.agg);
+      if (writeAggregatorFile(opt->aggregate, &total.agg) < 0)
+	{
+	  printf("Error writing %s\n", opt->aggregate);
+	  return -1;
+	}
+    }
+
+  return 0;
+}
+
+/* Head-to-head comparison with sequential stopping */
+/* --------------------------------------------------------------- */
+
+/* Game g uses seed firstSeed + g/2 with the first strategy in seat g%2,
+   so every seed is played from both seats */
+struct comparison {
+  struct simOptions *opt;
+  long batchStart;
+  signed char *outcomes;   //per game of the batch, from the first strategy's view
+};
+
+static void compareRange(long lo, long hi, int worker, void *accum,
+			 void *ctx) {
+  struct comparison *c = ctx;
+  struct gameState state;
+  struct gameResult result;
+  int ids[2];
+  int seat;
+  long g;
+
+  for (g = lo; g < hi; g++)
+    {
+      int seed = c->opt->firstSeed + (int)(g / 2);
+      seat = (int)(g % 2);
+      ids[seat] = c->opt->strategyIds[0];
+      ids[1 - seat] = c->opt->strategyIds[1];
+      c->outcomes[g - c->batchStart] = 0;
+      if (playTemplateGame(&c->opt->game, ids, seed, &state, &result) < 0)
+	continue;
+      if (result.winners[seat] && !result.winners[1 - seat])
+	c->outcomes[g - c->batchStart] = 1;
+      else if (!result.winners[seat] && result.winners[1 - seat])
+	c->outcomes[g - c->batchStart] = -1;
+    }
+}
+
+static int runCompare(struct simOptions *opt) {
+  struct comparison c;
+  struct sprt test;
+  struct threadPool *pool;
+  long simulated = 0;
+  long end;
+  long g;
+  double lo, hi;
+  const char *first;
+  const char *second;
+
+  if (opt->numStrategies != 2)
+    {
+      printf("compare needs exactly two strategies\n");
+      return -1;
+    }
+  if (initSprt(&test, opt->delta, opt->alpha, opt->beta) < 0)
+    {
+      printf("Need 0 < delta < 0.5 and 0 < alpha, beta < 0.5\n");
+      return -1;
+    }
+
+  pool = newThreadPool(opt->threads, 0);
+  c.opt = opt;
+  c.outcomes = malloc(opt->batch);
+  if (pool == NULL || c.outcomes == NULL)
+    {
+      printf("Could not start worker threads\n");
+      freeThreadPool(pool);
+      free(c.outcomes);
+      return -1;
+    }
+
+  first = getStrategy(opt->strategyIds[0])->name;
+  second = getStrategy(opt->strategyIds[1])->name;
+  printf("Compare: %s vs %s, at most %ld games, alpha %g beta %g delta %g, %d threads\n",
+	 first, second, opt->games, opt->alpha, opt->beta, opt->delta, poolNumWorkers(pool));
+  printf("Kingdom: ");
+  printKingdom(opt->kingdom);
+  printf("\n\n");
+
+  //outcomes are fed to the test in game order, so the stopping point
+  //does not depend on the batch size or the number of threads
+  for (c.batchStart = 0; c.batchStart < opt->games && test.decision == SPRT_CONTINUE;
+       c.batchStart = end)
+    {
+      end = c.batchStart + opt->batch;
+      if (end > opt->games)
+	end = opt->games;
+      poolParallelFor(pool, c.batchStart, end, 16, compareRange, &c);
+      simulated = end;
+
+      for (g = c.batchStart; g < end; g++)
+	{
+	  if (sprtUpdate(&test, c.outcomes[g - c.batchStart]) != SPRT_CONTINUE)
+	    break;
+	}
+    }
+
+  freeThreadPool(pool);
+  free(c.outcomes);
+
+  wilsonInterval(test.wins, test.wins + test.losses, Z_95, &lo, &hi);
+  printf("%s W %ld T %ld L %ld against %s\n", first, test.wins, test.ties,
+	 test.losses, second);
+  printf("Decisive win rate %.2f%% [%.2f,%.2f]\n",
+	 test.wins + test.losses ? 100.0 * test.wins / (test.wins + test.losses) : 0.0,
+	 100.0 * lo, 100.0 * hi);
+  printf("Log likelihood ratios %.3f for %s, %.3f for %s, bounds (%.3f, %.3f)\n",
+	 test.llrFirst, first, test.llrSecond, second, test.lower, test.upper);
+
+  if (test.decision == SPRT_FIRST_BETTER)
+    printf("Decided: %s is better, accepted win rate %.1f%%", first,
+	   100.0 * (0.5 + test.delta));
+  else if (test.decision == SPRT_SECOND_BETTER)
+    printf("Decided: %s is better, accepted win rate %.1f%%", second,
+	   100.0 * (0.5 + test.delta));
+  else if (test.decision == SPRT_EQUIVALENT)
+    printf("Decided: within +-%g of even, accepted win rate 50%% in both tests",
+	   test.delta);
+  else
+    printf("Undecided within the budget");
+  printf(" after %ld games (%ld simulated); %ld of the %ld game budget saved\n",
+	 sprtGames(&test), simulated, opt->games - sprtGames(&test), opt->games);
+
+  return 0;
+}
+
+/* Paired (common random numbers) evaluation */
+/* --------------------------------------------------------------- */
+
+/* Sums over replays; points are in half-point units (win 2, tie 1,
+   loss 0) so everything stays an exact integer whatever the split
+   between workers */
+struct pairedAccum {
+  long n;
+  long sumA, sumB, sumAA, sumBB, sumAB;
+  long marginA, marginB, marginAA, marginBB, marginAB;
+};
+
+struct pairedRun {
+  struct simOptions *opt;
+};
+
+static int halfPoints(struct gameResult *result, int seat) {
+  if (!result->winners[seat])
+    return 0;
+  if (result->winners[0] && result->winners[1])
+    return 1;
+  return 2;
+}
+
+/* Replay r is seed firstSeed + r/2 with the candidate in seat r%2; both
+   candidates face the opponent on exactly the same seed and seat */
+static void pairedRange(long lo, long hi, int worker, void *accum,
+			void *ctx) {
+  struct pairedRun *p = ctx;
+  struct pairedAccum *a = accum;
+  struct gameState state;
+  struct gameResult resultA;
+  struct gameResult resultB;
+  int ids[2];
+  int seat;
+  long r;
+  long pa, pb, ma, mb;
+
+  for (r = lo; r < hi; r++)
+    {
+      int seed = p->opt->firstSeed + (int)(r / 2);
+      seat = (int)(r % 2);
+      ids[1 - seat] = p->opt->strategyIds[2];
+
+      ids[seat] = p->opt->strategyIds[0];
+      if (playTemplateGame(&p->opt->game, ids, seed, &state, &resultA) < 0)
+	continue;
+      ids[seat] = p->opt->strategyIds[1];
+      if (playTemplateGame(&p->opt->game, ids, seed, &state, &resultB) < 0)
+	continue;
+
+      pa = halfPoints(&resultA, seat);
+      pb = halfPoints(&resultB, seat);
+      ma = resultA.scores[seat] - resultA.scores[1 - seat];
+      mb = resultB.scores[seat] - resultB.scores[1 - seat];
+
+      a->n++;
+      a->sumA += pa;
+      a->sumB += pb;
+      a->sumAA += pa * pa;
+      a->sumBB += pb * pb;
+      a->sumAB += pa * pb;
+      a->marginA += ma;
+      a->marginB += mb;
+      a->marginAA += ma * ma;
+      a->marginBB += mb * mb;
+      a->marginAB += ma * mb;
+    }
+}
+
+/* Prints the paired difference of x - y given raw sums, scaled by unit */
+static void printPaired(const char *label, long n, long sx, long sy,
+			long sxx, long syy, long sxy, double unit) {
+  double mx = (double)sx / n;
+  double my = (double)sy / n;
+  double vx = ((double)sxx - n * mx * mx) / (n - 1);
+  double vy = ((double)syy - n * my * my) / (n - 1);
+  double cov = ((double)sxy - n * mx * my) / (n - 1);
+  double vd = vx + vy - 2.0 * cov;
+  double se = sqrt(vd / n);
+  double seUnpaired = sqrt((vx + vy) / n);
+
+  printf("%s: A %.4f  B %.4f  difference %+.4f +/- %.4f (95%%)\n", label,
+	 mx * unit, my * unit, (mx - my) * unit, Z_95 * se * unit);
+  printf("  paired variance %.5f, independent-seed variance %.5f, correlation %.3f",
+	 vd * unit * unit, (vx + vy) * unit * unit,
+	 vx > 0 && vy > 0 ? cov / sqrt(vx * vy) : 0.0);
+  if (se > 0)
+    printf(", %.2fx fewer games for the same precision", (seUnpaired * seUnpaired) / (se * se));
+  printf("\n");
+}
+
+static int runPaired(struct simOptions *opt) {
+  struct pairedRun p;
+  struct pairedAccum total;
+  struct threadPool *pool;
+  int w;
+
+  if (opt->numStrategies != 3)
+    {
+      printf("paired needs two candidates and an opponent\n");
+      return -1;
+    }
+
+  pool = newThreadPool(opt->threads, sizeof(struct pairedAccum));
+  if (pool == NULL)
+    {
+      printf("Could not start worker threads\n");
+      return -1;
+    }
+
+  printf("Paired: %s (A) and %s (B) against %s, %ld seeds from both seats, %s streams, %d threads\n",
+	 getStrategy(opt->strategyIds[0])->name, getStrategy(opt->strategyIds[1])->name,
+	 getStrategy(opt->strategyIds[2])->name, opt->games,
+	 opt->rngMode == RNG_PER_PLAYER ? "per-player" : "shared", poolNumWorkers(pool));
+  printf("Kingdom: ");
+  printKingdom(opt->kingdom);
+  printf("\n\n");
+
+  p.opt = opt;
+  poolParallelFor(pool, 0, 2 * opt->games, 16, pairedRange, &p);
+
+  memset(&total, 0, sizeof(total));
+  for (w = 0; w < poolNumWorkers(pool); w++)
+    {
+      struct pairedAccum *a = poolAccumulator(pool, w);
+      total.n += a->n;
+      total.sumA += a->sumA;
+      total.sumB += a->sumB;
+      total.sumAA += a->sumAA;
+      total.sumBB += a->sumBB;
+      total.sumAB += a->sumAB;
+      total.marginA += a->marginA;
+      total.marginB += a->marginB;
+      total.marginAA += a->marginAA;
+      total.marginBB += a->marginBB;
+      total.marginAB += a->marginAB;
+    }
+  freeThreadPool(pool);
+
+  if (total.n < 2)
+    {
+      printf("Not enough games\n");
+      return -1;
+    }
+
+  printf("%ld paired replays\n", total.n);
+  printPaired("Points per game", total.n, total.sumA, total.sumB,
+	      total.sumAA, total.sumBB, total.sumAB, 0.5);
+  printPaired("Score margin", total.n, total.marginA, total.marginB,
+	      total.marginAA, total.marginBB, total.marginAB, 1.0);
+
+  return 0;
+}
+
+/* Recording games to an archive */
+/* --------------------------------------------------------------- */
+
+/* Game g is seed firstSeed + g/2 with the first strategy in seat g%2,
+   as in compare.  Workers record a batch in parallel and the main
+   thread appends it in game order */
+struct recording {
+  struct simOptions *opt;
+  long batchStart;
+  struct gameRecord *records;   //per game of the batch
+  long unfinished;
+};
+
+static void recordRange(long lo, long hi, int worker, void *accum,
+			void *ctx) {
+  struct recording *rec = ctx;
+  struct gameState state;
+  struct gameResult result;
+  int ids[2];
+  int seat;
+  long g;
+
+  for (g = lo; g < hi; g++)
+    {
+      int seed = rec->opt->firstSeed + (int)(g / 2);
+      seat = (int)(g % 2);
+      ids[seat] = rec->opt->strategyIds[0];
+      ids[1 - seat] = rec->opt->strategyIds[1];
+      rec->records[g - rec->batchStart].length = 0;
+      if (playRecordedGame(2, ids, rec->opt->kingdom, seed, rec->opt->rngMode,
+			   &state, &result, &rec->records[g - rec->batchStart]) == 0
+	  && !result.finished)
+	__atomic_add_fetch(&rec->unfinished, 1, __ATOMIC_RELAXED);
+    }
+}
+
+static int runArchive(struct simOptions *opt) {
+  struct recording rec;
+  struct archiveWriter writer;
+  struct threadPool *pool;
+  long games = 2 * opt->games;
+  long batch = opt->batch < games ? opt->batch : games;
+  long end;
+  long g;
+  int r = 0;
+
+  if (opt->numStrategies != 2 || opt->output == NULL)
+    {
+      printf("archive needs an output file and exactly two strategies\n");
+      return -1;
+    }
+
+  pool = newThreadPool(opt->threads, 0);
+  rec.opt = opt;
+  rec.unfinished = 0;
+  rec.records = malloc(batch * sizeof(struct gameRecord));
+  if (pool == NULL || rec.records == NULL)
+    {
+      printf("Could not start worker threads\n");
+      freeThreadPool(pool);
+      free(rec.records);
+      return -1;
+    }
+  for (g = 0; g < batch; g++)
+    initGameRecord(&rec.records[g]);
+
+  if (openArchiveWriter(&writer, opt->output, opt->keyframes) < 0)
+    {
+      printf("Cannot create %s\n", opt->output);
+      r = -1;
+    }
+
+  for (rec.batchStart = 0; r == 0 && rec.batchStart < games; rec.batchStart = end)
+    {
+      end = rec.batchStart + batch;
+      if (end > games)
+	end = games;
+      poolParallelFor(pool, rec.batchStart, end, 16, recordRange, &rec);
+
+      for (g = rec.batchStart; g < end && r == 0; g++)
+	{
+	  struct gameRecord *record = &rec.records[g - rec.batchStart];
+	  if (record->length > 0 && archiveAppend(&writer, record->data, record->length) < 0)
+	    r = -1;
+	}
+    }
+
+  if (writer.out != NULL && closeArchiveWriter(&writer) < 0)
+    r = -1;
+  if (r < 0)
+    printf("Error writing %s\n", opt->output);
+  else
+    printf("Archived %ld games of %s vs %s to %s, %ld bytes (keyframes every %d turns)\n",
+	   writer.numGames, getStrategy(opt->strategyIds[0])->name,
+	   getStrategy(opt->strategyIds[1])->name, opt->output,
+	   (long)writer.offset, opt->keyframes);
+  if (rec.unfinished > 0)
+    printf("%ld games hit the %d turn limit\n", rec.unfinished, MAX_GAME_TURNS);
+
+  for (g = 0; g < batch; g++)
+    freeGameRecord(&rec.records[g]);
+  free(rec.records);
+  freeThreadPool(pool);
+  return r;
+}
+
+/* Kingdom sweep */
+/* --------------------------------------------------------------- */
+
+/* Game g is seed firstSeed + g % seeds of the kingdom of rank
+   firstRank + g / (2 * seeds), with the seats swapped in its second
+   half */
+struct sweep {
+  struct simOptions *opt;
+  long firstRank;
+  long batchStart;
+  struct gameResult *results;  //per game of the batch, numPlayers 0 if not played
+};
+
+struct sweepRow {
+  long games;
+  long wins;          //for first
+  long ties;
+  long losses;
+  long unfinished;
+  long turns;
+};
+
+static void sweepRange(long lo, long hi, int worker, void *accum, void *ctx) {
+  struct sweep *s = ctx;
+  struct gameState state;
+  struct gameResult *result;
+  int kingdom[10];
+  int ids[2];
+  long perKingdom = 2 * s->opt->games;
+  long j;
+  long g;
+
+  for (g = lo; g < hi; g++)
+    {
+      result = &s->results[g - s->batchStart];
+      j = g % perKingdom;
+      ids[0] = s->opt->strategyIds[j >= s->opt->games];
+      ids[1] = s->opt->strategyIds[j < s->opt->games];
+      kingdomUnrank(s->firstRank + g / perKingdom, kingdom);
+      if (playGame(2, ids, kingdom, s->opt->firstSeed + (int)(j % s->opt->games),
+		   s->opt->rngMode, &state, result) < 0)
+	result->numPlayers = 0;
+    }
+}
+
+static int runSweep(struct simOptions *opt) {
+  struct sweep s;
+  struct sweepRow row;
+  struct threadPool *pool;
+  struct gameResult *result;
+  int kingdom[10];
+  long perKingdom = 2 * opt->games;
+  long ranks;
+  long games;
+  long end;
+  long g;
+  int seat;
+
+  if (opt->numStrategies != 2)
+    {
+      printf("A sweep needs exactly two strategies\n");
+      return -1;
+    }
+
+  ranks = opt->lastRank - opt->firstRank;
+  s.opt = opt;
+  s.firstRank = opt->firstRank + ranks * opt->shard / opt->numShards;
+  games = (opt->firstRank + ranks * (opt->shard + 1) / opt->numShards - s.firstRank)
+    * perKingdom;
+
+  pool = newThreadPool(opt->threads, 0);
+  s.results = malloc(opt->batch * sizeof(struct gameResult));
+  if (pool == NULL || s.results == NULL)
+    {
+      printf("Could not start worker threads\n");
+      freeThreadPool(pool);
+      free(s.results);
+      return -1;
+    }
+
+  printf("# Sweep: %s vs %s, kingdoms %ld to %ld, %ld seeds per seat order, %d threads\n",
+	 getStrategy(opt->strategyIds[0])->name, getStrategy(opt->strategyIds[1])->name,
+	 s.firstRank, s.firstRank + games / perKingdom - 1, opt->games,
+	 poolNumWorkers(pool));
+  printf("rank\tkingdom\tgames\twins\tties\tlosses\twin_rate\tmean_turns\tunfinished\n");
+
+  memset(&row, 0, sizeof(row));
+  for (s.batchStart = 0; s.batchStart < games; s.batchStart = end)
+    {
+      end = s.batchStart + opt->batch;
+      if (end > games)
+	end = games;
+      poolParallelFor(pool, s.batchStart, end, 16, sweepRange, &s);
+
+      for (g = s.batchStart; g < end; g++)
+	{
+	  result = &s.results[g - s.batchStart];
+	  if (result->numPlayers > 0)
+	    {
+	      //first's seat
+	      seat = g % perKingdom >= opt->games;
+	      row.games++;
+	      row.turns += result->turns;
+	      if (!result->finished)
+		row.unfinished++;
+	      if (result->winners[0] && result->winners[1])
+		row.ties++;
+	      else if (result->winners[seat])
+		row.wins++;
+	      else
+		row.losses++;
+	    }
+	  if (g % perKingdom == perKingdom - 1)
+	    {
+	      kingdomUnrank(s.firstRank + g / perKingdom, kingdom);
+	      printf("%ld\t", s.firstRank + g / perKingdom);
+	      printKingdom(kingdom);
+	      printf("\t%ld\t%ld\t%ld\t%ld\t%.4f\t%.2f\t%ld\n", row.games, row.wins,
+		     row.ties, row.losses,
+		     row.games ? (row.wins + 0.5 * row.ties) / row.games : 0.0,
+		     row.games ? (double)row.turns / row.games : 0.0, row.unfinished);
+	      memset(&row, 0, sizeof(row));
+	    }
+	}
+      fflush(stdout);
+    }
+
+  free(s.results);
+  freeThreadPool(pool);
+  return 0;
+}
+
+/* Merge of shard aggregates */
+/* --------------------------------------------------------------- */
+
+static int runMerge(int argc, char **argv) {
+  struct aggregator total;
+  struct aggregator part;
+  const char *output = NULL;
+  int parts = 0;
+  int i;
+
+  initAggregator(&total);
+  for (i = 2; i < argc; i++)
+    {
+      if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+	{
+	  output = argv[++i];
+	  continue;
+	}
+      if (readAggregatorFile(argv[i], &part) < 0)
+	{
+	  printf("Cannot read aggregator file %s\n", argv[i]);
+	  return -1;
+	}
+      if (mergeAggregator(&total, &part) < 0)
+	{
+	  printf("%s is bucketed differently from the files before it\n", argv[i]);
+	  return -1;
+	}
+      parts++;
+    }
+  if (output == NULL || parts == 0)
+    {
+      printUsage();
+      return -1;
+    }
+
+  printf("Merged %d files, %ld games\n\n", parts, total.games);
+  printAggregator(stdout, &total);
+  if (writeAggregatorFile(output, &total) < 0)
+    {
+      printf("Error writing %s\n", output);
+      return -1;
+    }
+  return 0;
+}
+
+static int runMode(const char *mode, struct simOptions *opt) {
+  if (strcmp(mode, "tournament") == 0)
+    return runTournament(opt);
+  if (strcmp(mode, "compare") == 0)
+    return runCompare(opt);
+  if (strcmp(mode, "paired") == 0)
+    return runPaired(opt);
+  if (strcmp(mode, "archive") == 0)
+    return runArchive(opt);
+  if (strcmp(mode, "sweep") == 0)
+    return runSweep(opt);
+
+  printUsage();
+  return -1;
+}
+
+int main(int argc, char **argv) {
+  struct simOptions opt;
+  long samples;
+  int status;
+
+  if (argc >= 2 && strcmp(argv[1], "merge") == 0)
+    return runMerge(argc, argv) < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+  if (argc < 2 || parseOptions(argc, argv, &opt) < 0)
+    {
+      printUsage();
+      return EXIT_FAILURE;
+    }
+  if (initGameTemplate(2, opt.kingdom, opt.rngMode, &opt.game) < 0)
+    {
+      printf("Cannot set up a game in this kingdom\n");
+      return EXIT_FAILURE;
+    }
+
+  if (opt.profile != NULL && startProfiler(PROFILE_HZ) < 0)
+    {
+      printf("Cannot profile: --profile needs a sim built with -DENGINE_PROFILE (make simprof)\n");
+      return EXIT_FAILURE;
+    }
+  status = runMode(argv[1], &opt);
+  if (opt.profile != NULL)
+    {
+      samples = stopProfiler(opt.profile);
+      if (samples < 0)
+	{
+	  printf("Cannot write %s\n", opt.profile);
+	  return EXIT_FAILURE;
+	}
+      fprintf(stderr, "%ld profile samples in %s\n", samples, opt.profile);
+    }
+  return status < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
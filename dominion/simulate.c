@@ -0,0 +1,237 @@
+#include "simulate.h"
+#include "engineprofile.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *cardNames[treasure_map+1] = {
+  "curse", "estate", "duchy", "province",
+  "copper", "silver", "gold",
+  "adventurer", "council_room", "feast", "gardens", "mine", "remodel",
+  "smithy", "village",
+  "baron", "great_hall", "minion", "steward", "tribute",
+  "ambassador", "cutpurse", "embargo", "outpost", "salvager", "sea_hag",
+  "treasure_map"
+};
+
+int playGame(int numPlayers, const int strategyIds[], int kingdom[10],
+	     int seed, int rngMode, struct gameState *state,
+	     struct gameResult *result) {
+  return playRecordedGame(numPlayers, strategyIds, kingdom, seed, rngMode,
+			  state, result, NULL);
+}
+
+static int lookupBots(int numPlayers, const int strategyIds[],
+		      const struct strategy *bots[]) {
+  int i;
+
+  for (i = 0; i < numPlayers && i < MAX_PLAYERS; i++)
+    {
+      bots[i] = getStrategy(strategyIds[i]);
+      if (bots[i] == NULL)
+	return -1;
+    }
+  return 0;
+}
+
+/* Plays out a freshly dealt game */
+static void playDealtGame(const struct strategy *bots[],
+			  struct gameState *state, struct gameResult *result,
+			  struct gameRecord *record) {
+  struct botMemory memory[MAX_PLAYERS];
+  int player;
+  int i;
+  ENGINE_FRAME(FRAME_GAME);
+
+  memset(memory, 0, sizeof(memory));
+  for (i = 0; i < state->numPlayers; i++)
+    {
+      memory[i].record = record;
+    }
+  memset(result, 0, sizeof(struct gameResult));
+  result->numPlayers = state->numPlayers;
+
+  while (!isGameOver(state))
+    {
+      if (result->turns >= MAX_GAME_TURNS)
+	break;
+      player = whoseTurn(state);
+      {
+	ENGINE_FRAME(FRAME_BOT_TURN);
+	bots[player]->playTurn(player, state, &memory[player]);
+      }
+      recordedEndTurn(record, state);
+      result->turns++;
+    }
+
+  result->finished = isGameOver(state);
+  for (i = 0; i < state->numPlayers; i++)
+    {
+      result->scores[i] = scoreFor(i, state);
+    }
+  getWinners(result->winners, state);
+}
+
+int playRecordedGame(int numPlayers, const int strategyIds[],
+		     int kingdom[10], int seed, int rngMode,
+		     struct gameState *state, struct gameResult *result,
+		     struct gameRecord *record) {
+  const struct strategy *bots[MAX_PLAYERS];
+
+  if (seed < 1 || lookupBots(numPlayers, strategyIds, bots) < 0)
+    return -1;
+  //initializeGame leaves parts of the state untouched and scoreFor reads
+  //past the live deck, so start from a clean slate to keep games
+  //reproducible whatever memory the caller passes in
+  memset(state, 0, sizeof(struct gameState));
+  if (initializeGameStreams(numPlayers, kingdom, seed, rngMode, state) < 0)
+    return -1;
+
+  if (record != NULL
+      && beginGameRecord(record, numPlayers, kingdom, seed, rngMode) < 0)
+    return -1;
+
+  playDealtGame(bots, state, result, record);
+  return 0;
+}
+
+int playTemplateGame(const struct gameTemplate *tmpl, const int strategyIds[],
+		     int seed, struct gameState *state,
+		     struct gameResult *result) {
+  const struct strategy *bots[MAX_PLAYERS];
+
+  if (seed < 1 || lookupBots(tmpl->state.numPlayers, strategyIds, bots) < 0)
+    return -1;
+  if (resetGame(tmpl, seed, state) < 0)
+    return -1;
+  playDealtGame(bots, state, result, NULL);
+  return 0;
+}
+
+const char* cardName(int card) {
+  if (card < curse || card > treasure_map)
+    return NULL;
+  return cardNames[card];
+}
+
+int cardByName(const char *name) {
+  int i;
+  char *end;
+  long n;
+
+  for (i = curse; i <= treasure_map; i++)
+    {
+      if (strcmp(cardNames[i], name) == 0)
+	return i;
+    }
+
+  n = strtol(name, &end, 10);
+  if (*name != '\0' && *end == '\0' && n >= curse && n <= treasure_map)
+    return (int)n;
+
+  return -1;
+}
+
+int parseKingdom(const char *list, int kingdom[10]) {
+  char buf[512];
+  char *tok;
+  int count = 0;
+  int card;
+  int i;
+
+  if (strlen(list) >= sizeof(buf))
+    return -1;
+  strcpy(buf, list);
+
+  for (tok = strtok(buf, ","); tok != NULL; tok = strtok(NULL, ","))
+    {
+      card = cardByName(tok);
+      if (card < adventurer || count == 10)
+	return -1;
+      for (i = 0; i < count; i++)
+	{
+	  if (kingdom[i] == card)
+	    return -1;
+	}
+      kingdom[count++] = card;
+    }
+
+  return count == 10 ? 0 : -1;
+}
+
+void defaultKingdom(int kingdom[10]) {
+  int k[10] = {adventurer, gardens, embargo, village, minion, mine, cutpurse,
+	       sea_hag, tribute, smithy};
+  memcpy(kingdom, k, sizeof(k));
+}
+
+static long binomial(int n, int k) {
+  long c = 1;
+  int i;
+
+  if (k > n)
+    return 0;
+  for (i = 1; i <= k; i++)
+    c = c * (n - k + i) / i;
+  return c;
+}
+
+long kingdomRank(const int kingdom[10]) {
+  int chosen[NUM_KINGDOM_CARDS] = {0};
+  long rank = 0;
+  int k = 0;
+  int c;
+  int i;
+
+  for (i = 0; i < 10; i++)
+    {
+      c = kingdom[i] - adventurer;
+      if (c < 0 || c >= NUM_KINGDOM_CARDS || chosen[c])
+	return -1;
+      chosen[c] = 1;
+    }
+  for (c = 0; c < NUM_KINGDOM_CARDS; c++)
+    if (chosen[c])
+      rank += binomial(c, ++k);
+  return rank;
+}
+
+int kingdomUnrank(long rank, int kingdom[10]) {
+  int c = NUM_KINGDOM_CARDS - 1;
+  int k;
+
+  if (rank < 0 || rank >= NUM_KINGDOMS)
+    return -1;
+  //greedily the largest card whose term fits, then the next below it
+  for (k = 10; k >= 1; k--)
+    {
+      while (binomial(c, k) > rank)
+	c--;
+      rank -= binomial(c, k);
+      kingdom[k - 1] = adventurer + c;
+      c--;
+    }
+  return 0;
+}
+
+void wilsonInterval(double successes, long n, double z,
+		    double *lo, double *hi) {
+  double p;
+  double center;
+  double half;
+  double denom;
+
+  if (n <= 0)
+    {
+      *lo = 0.0;
+      *hi = 1.0;
+      return;
+    }
+
+  p = successes / n;
+  denom = 1.0 + z * z / n;
+  center = (p + z * z / (2.0 * n)) / denom;
+  half = z * sqrt(p * (1.0 - p) / n + z * z / (4.0 * n * n)) / denom;
+  *lo = center - half < 0.0 ? 0.0 : center - half;
+  *hi = center + half > 1.0 ? 1.0 : center + half;
+}
@@ -0,0 +1,67 @@
+#ifndef _SIMULATE_H
+#define _SIMULATE_H
+
+/* Batch game simulation: plays whole games between registered
+   strategies with no console output. */
+
+#include "dominion.h"
+#include "strategy.h"
+
+#define MAX_GAME_TURNS 1000  /* games still running after this many turns are abandoned */
+#define NUM_KINGDOM_CARDS (treasure_map - adventurer + 1)
+#define NUM_KINGDOMS 184756L /* C(20, 10) */
+
+struct gameResult {
+  int numPlayers;
+  int turns;                  //turns taken, summed over all players
+  int finished;               //0 if the game hit MAX_GAME_TURNS
+  int scores[MAX_PLAYERS];
+  int winners[MAX_PLAYERS];   //1 for each winner, as getWinners
+};
+
+int playGame(int numPlayers, const int strategyIds[], int kingdom[10],
+	     int seed, int rngMode, struct gameState *state,
+	     struct gameResult *result);
+/* Seat i is played by strategy strategyIds[i].  seed must be positive,
+   rngMode is RNG_SHARED or RNG_PER_PLAYER.  Returns -1 if the game
+   cannot be initialized */
+
+int playRecordedGame(int numPlayers, const int strategyIds[],
+		     int kingdom[10], int seed, int rngMode,
+		     struct gameState *state, struct gameResult *result,
+		     struct gameRecord *record);
+/* playGame, also logging the game to record when it is not NULL */
+
+int playTemplateGame(const struct gameTemplate *tmpl, const int strategyIds[],
+		     int seed, struct gameState *state,
+		     struct gameResult *result);
+/* playGame in the template's kingdom, player count and rngMode, with
+   the same outcome; setting up from a template is a copy, a seeding
+   and two shuffles */
+
+const char* cardName(int card);
+/* Enum-style name ("council_room"), NULL if card is out of range */
+
+int cardByName(const char *name);
+/* Accepts enum-style names or card numbers; -1 if unknown */
+
+int parseKingdom(const char *list, int kingdom[10]);
+/* Comma separated list of exactly 10 distinct kingdom cards */
+
+void defaultKingdom(int kingdom[10]);
+/* The kingdom used by playdom.c and player.c */
+
+long kingdomRank(const int kingdom[10]);
+int kingdomUnrank(long rank, int kingdom[10]);
+/* Numbering of every kingdom from 0 to NUM_KINGDOMS - 1 by the
+   combinatorial number system: a kingdom whose cards, less adventurer
+   and sorted, are c1 < ... < c10 has rank C(c1,1) + ... + C(c10,10).
+   Unranking takes at most 30 steps whatever the rank, so sweeps split
+   the kingdom space by rank range.  Unranked kingdoms are sorted; both
+   return -1 for an invalid kingdom or rank */
+
+void wilsonInterval(double successes, long n, double z,
+		    double *lo, double *hi);
+/* Wilson score interval for a binomial proportion */
+
+#endif
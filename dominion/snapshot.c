@@ -0,0 +1,208 @@
+#include "snapshot.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define HEADER_INTS 5  /* version and the four limits, after the magic */
+#define STREAM_INTS (1 + MAX_PLAYERS)
+
+/* Moves n ints between the state and the snapshot buffer in either
+   direction.  On little-endian hosts the encoding is the in-memory
+   layout, so whole arrays are copied at once */
+struct cursor {
+  unsigned char *p;
+  int loading;
+};
+
+static void transfer(struct cursor *c, int *v, int n) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  if (c->loading)
+    memcpy(v, c->p, n * sizeof(int32_t));
+  else
+    memcpy(c->p, v, n * sizeof(int32_t));
+  c->p += n * sizeof(int32_t);
+#else
+  int i;
+  uint32_t u;
+  for (i = 0; i < n; i++, c->p += 4)
+    {
+      if (c->loading)
+	{
+	  u = (uint32_t)c->p[0] | (uint32_t)c->p[1] << 8
+	    | (uint32_t)c->p[2] << 16 | (uint32_t)c->p[3] << 24;
+	  v[i] = (int32_t)u;
+	}
+      else
+	{
+	  u = (uint32_t)v[i];
+	  c->p[0] = u & 0xff;
+	  c->p[1] = (u >> 8) & 0xff;
+	  c->p[2] = (u >> 16) & 0xff;
+	  c->p[3] = u >> 24;
+	}
+    }
+#endif
+}
+
+/* Whether every card in cards[0..count) is one the engine knows */
+static int validCards(const int *cards, int count) {
+  int i;
+  for (i = 0; i < count; i++)
+    if (cards[i] < curse || cards[i] > treasure_map)
+      return 0;
+  return 1;
+}
+
+/* The gameState fields, in declaration order */
+static void transferState(struct cursor *c, struct gameState *state) {
+  transfer(c, &state->numPlayers, 1);
+  transfer(c, state->supplyCount, treasure_map + 1);
+  transfer(c, state->embargoTokens, treasure_map + 1);
+  transfer(c, &state->outpostPlayed, 1);
+  transfer(c, &state->outpostTurn, 1);
+  transfer(c, &state->whoseTurn, 1);
+  transfer(c, &state->phase, 1);
+  transfer(c, &state->numActions, 1);
+  transfer(c, &state->coins, 1);
+  transfer(c, &state->numBuys, 1);
+  transfer(c, &state->hand[0][0], MAX_PLAYERS * MAX_HAND);
+  transfer(c, state->handCount, MAX_PLAYERS);
+  transfer(c, &state->deck[0][0], MAX_PLAYERS * MAX_DECK);
+  transfer(c, state->deckCount, MAX_PLAYERS);
+  transfer(c, &state->discard[0][0], MAX_PLAYERS * MAX_DECK);
+  transfer(c, state->discardCount, MAX_PLAYERS);
+  transfer(c, state->playedCards, MAX_DECK);
+  transfer(c, &state->playedCardCount, 1);
+  transfer(c, &state->rngMode, 1);
+}
+
+static const int stateInts = 1 + 2 * (treasure_map + 1) + 7
+  + MAX_PLAYERS * (MAX_HAND + 2 * MAX_DECK + 3) + MAX_DECK + 2;
+
+size_t snapshotSize(void) {
+  return sizeof(SNAPSHOT_MAGIC) + 4 * (HEADER_INTS + stateInts + STREAM_INTS);
+}
+
+int saveSnapshot(const struct gameState *state, unsigned char *buffer,
+		 size_t size) {
+  struct cursor c;
+  struct rngPosition rng;
+  int header[HEADER_INTS] = {SNAPSHOT_VERSION, MAX_PLAYERS, MAX_HAND,
+			     MAX_DECK, treasure_map + 1};
+  int streams[STREAM_INTS];
+  int i;
+
+  if (size < snapshotSize())
+    return -1;
+
+  saveRngPosition(&rng);
+  streams[0] = (int)rng.game;
+  for (i = 0; i < MAX_PLAYERS; i++)
+    streams[1 + i] = (int)rng.players[i];
+
+  memcpy(buffer, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+  c.p = buffer + sizeof(SNAPSHOT_MAGIC);
+  c.loading = 0;
+  transfer(&c, header, HEADER_INTS);
+  transferState(&c, (struct gameState*)state);
+  transfer(&c, streams, STREAM_INTS);
+  return 0;
+}
+
+int loadSnapshot(const unsigned char *buffer, size_t size,
+		 struct gameState *state) {
+  struct cursor c;
+  struct rngPosition rng;
+  struct gameState *loaded;
+  int header[HEADER_INTS];
+  int streams[STREAM_INTS];
+  int ok;
+  int i;
+
+  if (size < snapshotSize()
+      || memcmp(buffer, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0)
+    return -1;
+  c.p = (unsigned char*)buffer + sizeof(SNAPSHOT_MAGIC);
+  c.loading = 1;
+  transfer(&c, header, HEADER_INTS);
+  if (header[0] != SNAPSHOT_VERSION || header[1] != MAX_PLAYERS
+      || header[2] != MAX_HAND || header[3] != MAX_DECK
+      || header[4] != treasure_map + 1)
+    return -1;
+
+  loaded = malloc(sizeof(struct gameState));
+  if (loaded == NULL)
+    return -1;
+  transferState(&c, loaded);
+  transfer(&c, streams, STREAM_INTS);
+
+  //counts index the arrays and cards index supplyCount and
+  //embargoTokens, so both must stay in bounds
+  ok = loaded->numPlayers >= 2 && loaded->numPlayers <= MAX_PLAYERS
+    && loaded->whoseTurn >= 0 && loaded->whoseTurn < loaded->numPlayers
+    && loaded->playedCardCount >= 0 && loaded->playedCardCount <= MAX_DECK
+    && validCards(loaded->playedCards, loaded->playedCardCount)
+    && (loaded->rngMode == RNG_SHARED || loaded->rngMode == RNG_PER_PLAYER);
+  for (i = 0; ok && i < MAX_PLAYERS; i++)
+    ok = loaded->handCount[i] >= 0 && loaded->handCount[i] <= MAX_HAND
+      && loaded->deckCount[i] >= 0 && loaded->deckCount[i] <= MAX_DECK
+      && loaded->discardCount[i] >= 0 && loaded->discardCount[i] <= MAX_DECK
+      && validCards(loaded->hand[i], loaded->handCount[i])
+      && validCards(loaded->deck[i], loaded->deckCount[i])
+      && validCards(loaded->discard[i], loaded->discardCount[i]);
+  for (i = 0; ok && i < STREAM_INTS; i++)
+    ok = streams[i] > 0;
+  if (!ok)
+    {
+      free(loaded);
+      return -1;
+    }
+
+  memcpy(state, loaded, sizeof(struct gameState));
+  free(loaded);
+  rng.game = streams[0];
+  for (i = 0; i < MAX_PLAYERS; i++)
+    rng.players[i] = streams[1 + i];
+  restoreRngPosition(&rng);
+  return 0;
+}
+
+int saveSnapshotFile(const char *path, const struct gameState *state) {
+  unsigned char *buffer;
+  FILE *out;
+  int r = -1;
+
+  buffer = malloc(snapshotSize());
+  if (buffer == NULL)
+    return -1;
+  if (saveSnapshot(state, buffer, snapshotSize()) == 0
+      && (out = fopen(path, "wb")) != NULL)
+    {
+      if (fwrite(buffer, 1, snapshotSize(), out) == snapshotSize())
+	r = 0;
+      if (fclose(out) != 0)
+	r = -1;
+    }
+  free(buffer);
+  return r;
+}
+
+int loadSnapshotFile(const char *path, struct gameState *state) {
+  unsigned char *buffer;
+  FILE *in;
+  int r = -1;
+
+  buffer = malloc(snapshotSize());
+  if (buffer == NULL)
+    return -1;
+  in = fopen(path, "rb");
+  if (in != NULL)
+    {
+      if (fread(buffer, 1, snapshotSize(), in) == snapshotSize())
+	r = loadSnapshot(buffer, snapshotSize(), state);
+      fclose(in);
+    }
+  free(buffer);
+  return r;
+}
@@ -0,0 +1,41 @@
+#ifndef _SNAPSHOT_H
+#define _SNAPSHOT_H
+
+/* Binary snapshots of a game: every gameState field plus the position
+   of every RNG stream, so a loaded game plays on exactly as the saved
+   one would have.  Every value is a 32-bit little-endian integer
+   whatever the host, in this order:
+
+     magic       SNAPSHOT_MAGIC, 8 bytes NUL padded
+     version     SNAPSHOT_VERSION
+     limits      MAX_PLAYERS, MAX_HAND, MAX_DECK, treasure_map + 1
+     gameState   fields in declaration order, arrays row by row
+     streams     GAME_STREAM, then PLAYER_STREAM_BASE + p for each p
+
+   A snapshot taken with different limits is rejected rather than
+   reshaped. */
+
+#include <stddef.h>
+#include "dominion.h"
+
+#define SNAPSHOT_MAGIC "DOMSNAP"
+#define SNAPSHOT_VERSION 1
+
+size_t snapshotSize(void);
+/* Bytes in every snapshot written by this build */
+
+int saveSnapshot(const struct gameState *state, unsigned char *buffer,
+		 size_t size);
+/* Encodes state and the current RNG positions; buffer must hold
+   snapshotSize() bytes */
+
+int loadSnapshot(const unsigned char *buffer, size_t size,
+		 struct gameState *state);
+/* Decodes a snapshot into state and restores the RNG positions.
+   Rejects snapshots with a bad header or counts outside the engine's
+   limits, leaving state and the streams untouched */
+
+int saveSnapshotFile(const char *path, const struct gameState *state);
+int loadSnapshotFile(const char *path, struct gameState *state);
+
+#endif
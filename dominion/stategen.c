@@ -0,0 +1,191 @@
+#include "stategen.h"
+#include <string.h>
+
+#define NUM_CARDS (treasure_map + 1)
+
+void defaultStateShape(struct stateShape *shape) {
+  shape->minPlayers = 2;
+  shape->maxPlayers = MAX_PLAYERS;
+  shape->minGained = 0;
+  shape->maxGained = 25;
+  shape->maxTrashed = 0;
+  shape->minHand = 3;
+  shape->maxHand = 7;
+  shape->maxPlayed = 3;
+  shape->minActions = 0;
+  shape->maxActions = 3;
+  shape->minBuys = 1;
+  shape->maxBuys = 2;
+  shape->maxBonus = 4;
+  shape->buyPhase = 25;
+  shape->maxEmbargo = 2;
+}
+
+static int validRange(int min, int max, int limit) {
+  return min >= 0 && min <= max && max <= limit;
+}
+
+int initStateGenerator(struct stateGenerator *gen, int kingdom[10],
+		       const struct stateShape *shape, uint64_t seed) {
+  struct gameTemplate tmpl;
+  int n;
+
+  if (shape->minPlayers < 2
+      || !validRange(shape->minPlayers, shape->maxPlayers, MAX_PLAYERS)
+      || !validRange(shape->minGained, shape->maxGained, MAX_DECK - 10)
+      || !validRange(0, shape->maxTrashed, 10)
+      || !validRange(shape->minHand, shape->maxHand, MAX_HAND)
+      || !validRange(0, shape->maxPlayed, MAX_DECK)
+      || !validRange(shape->minActions, shape->maxActions, 1 << 20)
+      || !validRange(shape->minBuys, shape->maxBuys, 1 << 20)
+      || !validRange(0, shape->maxBonus, 1 << 20)
+      || !validRange(0, shape->buyPhase, 100)
+      || !validRange(0, shape->maxEmbargo, 1 << 20))
+    return -1;
+
+  for (n = shape->minPlayers; n <= shape->maxPlayers; n++)
+    {
+      if (initGameTemplate(n, kingdom, RNG_SHARED, &tmpl) < 0)
+	return -1;
+      memcpy(gen->supply[n], tmpl.state.supplyCount, sizeof(gen->supply[n]));
+    }
+  gen->shape = *shape;
+  gen->rng = seed;
+  return 0;
+}
+
+/* splitmix64 */
+static uint64_t nextRandom(struct stateGenerator *gen) {
+  uint64_t z = (gen->rng += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+int stateRandom(struct stateGenerator *gen, int n) {
+  return (int)(((nextRandom(gen) >> 32) * (uint64_t)n) >> 32);
+}
+
+static int between(struct stateGenerator *gen, int min, int max) {
+  return min + stateRandom(gen, max - min + 1);
+}
+
+static void shuffleCards(struct stateGenerator *gen, int *cards, int count) {
+  int i, j, card;
+
+  for (i = count - 1; i > 0; i--)
+    {
+      j = stateRandom(gen, i + 1);
+      card = cards[i];
+      cards[i] = cards[j];
+      cards[j] = card;
+    }
+}
+
+void randomState(struct stateGenerator *gen, struct gameState *state) {
+  static const int starting[10] = {copper, copper, copper, copper, copper,
+				   copper, copper, estate, estate, estate};
+  const struct stateShape *shape = &gen->shape;
+  int owned[MAX_PLAYERS][MAX_DECK];
+  int ownedCount[MAX_PLAYERS];
+  int gained[MAX_PLAYERS];
+  int piles[NUM_CARDS];
+  int numPiles = 0;
+  int numPlayers, player, card, round, mostGained, played;
+  int i, n, rest;
+
+  numPlayers = between(gen, shape->minPlayers, shape->maxPlayers);
+  state->numPlayers = numPlayers;
+  state->whoseTurn = stateRandom(gen, numPlayers);
+  memcpy(state->supplyCount, gen->supply[numPlayers], sizeof(state->supplyCount));
+  for (card = curse; card <= treasure_map; card++)
+    if (state->supplyCount[card] > 0)
+      piles[numPiles++] = card;
+
+  memset(state->embargoTokens, 0, sizeof(state->embargoTokens));
+  if (state->supplyCount[embargo] != -1)
+    for (n = between(gen, 0, shape->maxEmbargo); n > 0; n--)
+      state->embargoTokens[piles[stateRandom(gen, numPiles)]]++;
+
+  //what is left of the starting cards, then gains in turn order so no
+  //player empties the piles before the others have gained
+  mostGained = 0;
+  for (player = 0; player < numPlayers; player++)
+    {
+      memcpy(owned[player], starting, sizeof(starting));
+      shuffleCards(gen, owned[player], 10);
+      ownedCount[player] = 10 - between(gen, 0, shape->maxTrashed);
+      gained[player] = between(gen, shape->minGained, shape->maxGained);
+      if (gained[player] > mostGained)
+	mostGained = gained[player];
+    }
+  for (round = 0; round < mostGained && numPiles > 0; round++)
+    for (player = 0; player < numPlayers && numPiles > 0; player++)
+      if (round < gained[player])
+	{
+	  i = stateRandom(gen, numPiles);
+	  card = piles[i];
+	  owned[player][ownedCount[player]++] = card;
+	  if (--state->supplyCount[card] == 0)
+	    piles[i] = piles[--numPiles];
+	}
+
+  state->playedCardCount = 0;
+  for (player = 0; player < numPlayers; player++)
+    {
+      n = ownedCount[player];
+      shuffleCards(gen, owned[player], n);
+
+      state->handCount[player] = between(gen, shape->minHand, shape->maxHand);
+      if (state->handCount[player] > n)
+	state->handCount[player] = n;
+      memcpy(state->hand[player], owned[player], state->handCount[player] * sizeof(int));
+
+      //the first actions after the hand were played, the rest keep their order
+      rest = 0;
+      i = state->handCount[player];
+      if (player == state->whoseTurn)
+	{
+	  played = stateRandom(gen, shape->maxPlayed + 1);
+	  for (; i < n; i++)
+	    {
+	      card = owned[player][i];
+	      if (state->playedCardCount < played && card >= adventurer && card != gardens)
+		state->playedCards[state->playedCardCount++] = card;
+	      else
+		owned[player][state->handCount[player] + rest++] = card;
+	    }
+	}
+      else
+	rest = n - i;
+
+      state->deckCount[player] = stateRandom(gen, rest + 1);
+      memcpy(state->deck[player], owned[player] + state->handCount[player],
+	     state->deckCount[player] * sizeof(int));
+      state->discardCount[player] = rest - state->deckCount[player];
+      memcpy(state->discard[player],
+	     owned[player] + state->handCount[player] + state->deckCount[player],
+	     state->discardCount[player] * sizeof(int));
+    }
+  for (; player < MAX_PLAYERS; player++)
+    {
+      state->handCount[player] = 0;
+      state->deckCount[player] = 0;
+      state->discardCount[player] = 0;
+    }
+
+  state->outpostPlayed = 0;
+  state->outpostTurn = 0;
+  state->phase = stateRandom(gen, 100) < shape->buyPhase;
+  state->numActions = between(gen, shape->minActions, shape->maxActions);
+  state->numBuys = between(gen, shape->minBuys, shape->maxBuys);
+  state->coins = between(gen, 0, shape->maxBonus);
+  player = state->whoseTurn;
+  for (i = 0; i < state->handCount[player]; i++)
+    {
+      card = state->hand[player][i];
+      if (card >= copper && card <= gold)
+	state->coins += card - copper + 1;
+    }
+  state->rngMode = RNG_SHARED;
+}
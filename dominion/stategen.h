@@ -0,0 +1,59 @@
+#ifndef _STATEGEN_H
+#define _STATEGEN_H
+
+/* Random game states for random testers.
+
+   Each state is one a game of the generator's kingdom could be in
+   during a turn.  Every player owns the ten starting cards, less some
+   trashed, plus cards gained from piles chosen at random among those
+   not yet empty, and the supply is short by exactly what was gained.
+   What a player owns is shuffled and split between hand, deck and
+   discard; the player whose turn it is may also have played some of
+   their action cards.  Phase, actions, buys and embargo tokens are in
+   range, and coins are the treasure in hand plus a bonus.  Every size
+   is drawn uniformly from the ranges in a stateShape.
+
+   The generator has a random stream of its own, so rngs.c and the
+   engine's streams are left where they were, and a state costs a few
+   random numbers per card rather than one per byte of gameState.  Only
+   the live parts of a state are written: arrays past their counts keep
+   whatever they held. */
+
+#include <stdint.h>
+#include "dominion.h"
+
+struct stateShape {
+  int minPlayers, maxPlayers;   /* 2 to MAX_PLAYERS */
+  int minGained, maxGained;     /* cards each player has gained */
+  int maxTrashed;               /* starting cards each player has trashed */
+  int minHand, maxHand;         /* cut to what the player owns */
+  int maxPlayed;                /* action cards played this turn */
+  int minActions, maxActions;
+  int minBuys, maxBuys;
+  int maxBonus;                 /* coins beyond the treasure in hand */
+  int buyPhase;                 /* percent of states in the buy phase */
+  int maxEmbargo;               /* tokens on the supply, with embargo */
+};
+
+struct stateGenerator {
+  struct stateShape shape;
+  int supply[MAX_PLAYERS + 1][treasure_map + 1]; /* starting piles */
+  uint64_t rng;
+};
+
+void defaultStateShape(struct stateShape *shape);
+/* States from the first turns to about the twentieth: 2 to 4 players
+   having gained up to 25 cards and trashed none, hands of 3 to 7 */
+
+int initStateGenerator(struct stateGenerator *gen, int kingdom[10],
+		       const struct stateShape *shape, uint64_t seed);
+/* -1 if initGameTemplate rejects the kingdom or a range of shape is
+   empty or past the engine's limits */
+
+void randomState(struct stateGenerator *gen, struct gameState *state);
+
+int stateRandom(struct stateGenerator *gen, int n);
+/* Uniform in 0 to n - 1 from the generator's stream, for choices a
+   tester makes about the states it gets */
+
+#endif
@@ -0,0 +1,106 @@
+#include "strategy.h"
+#include "dominion_helpers.h"
+#include <string.h>
+
+int botBuy(int card, struct gameState *state, struct botMemory *memory) {
+  if (recordedBuyCard(memory->record, card, state) < 0)
+    return -1;
+  memory->bought[card]++;
+  return 0;
+}
+
+int botPlay(int handPos, int choice1, int choice2, int choice3,
+	    struct gameState *state, struct botMemory *memory) {
+  return recordedPlayCard(memory->record, handPos, choice1, choice2, choice3,
+			  state);
+}
+
+int findInHand(int card, struct gameState *state) {
+  int i;
+  int player = whoseTurn(state);
+  for (i = 0; i < state->handCount[player]; i++)
+    {
+      if (state->hand[player][i] == card)
+	return i;
+    }
+  return -1;
+}
+
+/* The interactive bot from executeBotTurn in interface.c */
+static void bigMoney(int player, struct gameState *state,
+		     struct botMemory *memory) {
+  int coins = state->coins;
+
+  if (coins >= getCost(province) && supplyCount(province, state) > 0)
+    botBuy(province, state, memory);
+  else if (supplyCount(province, state) == 0 && coins >= getCost(duchy))
+    botBuy(duchy, state, memory);
+  else if (coins >= getCost(gold) && supplyCount(gold, state) > 0)
+    botBuy(gold, state, memory);
+  else if (coins >= getCost(silver) && supplyCount(silver, state) > 0)
+    botBuy(silver, state, memory);
+}
+
+/* Player 0 of playdom.c: play a Smithy if holding one, own up to two */
+static void smithyBigMoney(int player, struct gameState *state,
+			   struct botMemory *memory) {
+  int pos = findInHand(smithy, state);
+
+  if (pos != -1)
+    botPlay(pos, -1, -1, -1, state, memory);
+
+  if (state->coins >= 8)
+    botBuy(province, state, memory);
+  else if (state->coins >= 6)
+    botBuy(gold, state, memory);
+  else if (state->coins >= 4 && memory->bought[smithy] < 2
+	   && supplyCount(smithy, state) > 0)
+    botBuy(smithy, state, memory);
+  else if (state->coins >= 3)
+    botBuy(silver, state, memory);
+}
+
+/* Player 1 of playdom.c: play an Adventurer if holding one, own up to two */
+static void adventurerBigMoney(int player, struct gameState *state,
+			       struct botMemory *memory) {
+  int pos = findInHand(adventurer, state);
+
+  if (pos != -1)
+    botPlay(pos, -1, -1, -1, state, memory);
+
+  if (state->coins >= 8)
+    botBuy(province, state, memory);
+  else if (state->coins >= 6 && memory->bought[adventurer] < 2
+	   && supplyCount(adventurer, state) > 0)
+    botBuy(adventurer, state, memory);
+  else if (state->coins >= 6)
+    botBuy(gold, state, memory);
+  else if (state->coins >= 3)
+    botBuy(silver, state, memory);
+}
+
+static const struct strategy strategies[] = {
+  {"big_money", bigMoney},
+  {"smithy_bm", smithyBigMoney},
+  {"adventurer_bm", adventurerBigMoney},
+};
+
+int numStrategies(void) {
+  return sizeof(strategies) / sizeof(strategies[0]);
+}
+
+const struct strategy* getStrategy(int index) {
+  if (index < 0 || index >= numStrategies())
+    return NULL;
+  return &strategies[index];
+}
+
+int findStrategy(const char *name) {
+  int i;
+  for (i = 0; i < numStrategies(); i++)
+    {
+      if (strcmp(strategies[i].name, name) == 0)
+	return i;
+    }
+  return -1;
+}
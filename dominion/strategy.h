@@ -0,0 +1,44 @@
+#ifndef _STRATEGY_H
+#define _STRATEGY_H
+
+/* Registry of computer strategies for batch simulation.  A strategy
+   plays the action and buy phases of one turn; the caller ends it. */
+
+#include "dominion.h"
+#include "gamerecord.h"
+
+#define MAX_STRATEGIES 16
+
+/* Per-player scratch kept for the length of one game */
+struct botMemory {
+  int bought[treasure_map+1];  //cards bought so far, by enum
+  struct gameRecord *record;   //actions are logged here unless NULL
+};
+
+typedef void (*strategyTurnFn)(int player, struct gameState *state,
+			       struct botMemory *memory);
+
+struct strategy {
+  const char *name;
+  strategyTurnFn playTurn;
+};
+
+int numStrategies(void);
+
+const struct strategy* getStrategy(int index);
+/* NULL if index is out of range */
+
+int findStrategy(const char *name);
+/* Index of the named strategy, -1 if there is none */
+
+int botBuy(int card, struct gameState *state, struct botMemory *memory);
+/* buyCard that also records the purchase in memory */
+
+int botPlay(int handPos, int choice1, int choice2, int choice3,
+	    struct gameState *state, struct botMemory *memory);
+/* playCard as issued by a strategy */
+
+int findInHand(int card, struct gameState *state);
+/* First hand position of card for the current player, -1 if absent */
+
+#endif
@@ -0,0 +1,126 @@
+#include "aggregator.h"
+#include "simulate.h"
+#include <math.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#define SAMPLES 20000
+
+static int compareDoubles(const void *a, const void *b) {
+  double x = *(const double*)a;
+  double y = *(const double*)b;
+  return (x > y) - (x < y);
+}
+
+static int near(double a, double b, double tolerance) {
+  return fabs(a - b) <= tolerance * (1 + fabs(b));
+}
+
+int main () {
+  struct aggregator whole;
+  struct aggregator parts[3];
+  struct aggregator merged;
+  struct aggregator loaded;
+  struct gameState state;
+  struct gameResult result;
+  struct metric m;
+  double *x;
+  double sum = 0;
+  double sq = 0;
+  double mean, exact, estimate;
+  double q;
+  unsigned char *buffer;
+  int kingdom[10];
+  int ids[2];
+  int seed;
+  int i;
+
+  printf ("Testing aggregators.\n");
+
+  //moments, histogram and quantiles of a skewed sample with negatives
+  x = malloc(SAMPLES * sizeof(double));
+  srand(7);
+  memset(&m, 0, sizeof(m));
+  m.histogram.lo = -10;
+  m.histogram.width = 5;
+  for (i = 0; i < SAMPLES; i++) {
+    x[i] = floor(pow((double)rand() / RAND_MAX, 3) * 400) - 20;
+    addSample(&m, (long)x[i]);
+    sum += x[i];
+  }
+  mean = sum / SAMPLES;
+  for (i = 0; i < SAMPLES; i++)
+    sq += (x[i] - mean) * (x[i] - mean);
+  assert(m.moments.n == SAMPLES);
+  assert(near(metricMean(&m), mean, 1e-12));
+  assert(near(metricVariance(&m), sq / (SAMPLES - 1), 1e-9));
+
+  {
+    long counted = m.histogram.below + m.histogram.above;
+    for (i = 0; i < HISTOGRAM_BUCKETS; i++)
+      counted += m.histogram.counts[i];
+    assert(counted == SAMPLES);
+    assert(m.histogram.below > 0 && m.histogram.above > 0);
+  }
+
+  qsort(x, SAMPLES, sizeof(double), compareDoubles);
+  for (q = 0.01; q < 1; q += 0.07) {
+    exact = x[(long)(q * (SAMPLES - 1))];
+    estimate = metricQuantile(&m, q);
+    assert(fabs(estimate - exact) <= SKETCH_ACCURACY * fabs(exact) + 1e-9);
+  }
+  assert(metricQuantile(&m, 0) == x[0]);
+  assert(metricQuantile(&m, 1) == x[SAMPLES - 1]);
+
+  //games split three ways merge to the whole
+  defaultKingdom(kingdom);
+  initAggregator(&whole);
+  for (i = 0; i < 3; i++)
+    initAggregator(&parts[i]);
+  for (seed = 1; seed <= 600; seed++) {
+    ids[0] = seed % numStrategies();
+    ids[1] = (seed / 2) % numStrategies();
+    assert(playGame(2, ids, kingdom, seed, RNG_SHARED, &state, &result) == 0);
+    aggregateGame(&whole, ids, &result);
+    aggregateGame(&parts[seed % 3], ids, &result);
+  }
+  initAggregator(&merged);
+  for (i = 2; i >= 0; i--)
+    assert(mergeAggregator(&merged, &parts[i]) == 0);
+
+  //exactly, whatever the split and merge order
+  assert(merged.games == 600 && merged.score.moments.n == 1200);
+  assert(memcmp(&merged, &whole, sizeof(struct aggregator)) == 0);
+  initAggregator(&merged);
+  for (i = 0; i < 3; i++)
+    assert(mergeAggregator(&merged, &parts[i]) == 0);
+  assert(memcmp(&merged, &whole, sizeof(struct aggregator)) == 0);
+
+  //differently bucketed histograms do not merge
+  parts[0].turns.histogram.width = 3;
+  assert(mergeAggregator(&merged, &parts[0]) == -1);
+
+  //serialization round trips exactly
+  buffer = malloc(aggregatorSize());
+  assert(serializeAggregator(&whole, buffer, aggregatorSize()) == 0);
+  assert(deserializeAggregator(buffer, aggregatorSize(), &loaded) == 0);
+  assert(memcmp(&loaded, &whole, sizeof(struct aggregator)) == 0);
+  assert(deserializeAggregator(buffer, aggregatorSize() - 1, &loaded) == -1);
+  buffer[8] = AGGREGATOR_VERSION + 1;
+  assert(deserializeAggregator(buffer, aggregatorSize(), &loaded) == -1);
+
+  assert(writeAggregatorFile("testAggregator.agg", &whole) == 0);
+  memset(&loaded, 0, sizeof(loaded));
+  assert(readAggregatorFile("testAggregator.agg", &loaded) == 0);
+  assert(memcmp(&loaded, &whole, sizeof(struct aggregator)) == 0);
+  remove("testAggregator.agg");
+
+  free(buffer);
+  free(x);
+
+  printf ("ALL TESTS OK\n");
+
+  return 0;
+}
@@ -0,0 +1,121 @@
+#include "dominion.h"
+#include "archive.h"
+#include "gamerecord.h"
+#include "simulate.h"
+#include <string.h>
+#include <stdio.h>
+#include <assert.h>
+
+#define GAMES 60
+#define ARCHIVE_FILE "testArchive.arc"
+
+/* State after turn end-turn actions, replayed from the start */
+static void replayTo(const unsigned char *data, size_t length, long turn,
+		     struct gameState *state, size_t *offset) {
+  struct recordHeader header;
+
+  assert(startReplay(data, length, &header, state) == 0);
+  *offset = header.actionsOffset;
+  assert(replayActions(data, length, offset, turn, state, NULL, NULL) >= 0);
+}
+
+static int sameCards(const int *a, int countA, const int *b, int countB) {
+  return countA == countB && memcmp(a, b, countA * sizeof(int)) == 0;
+}
+
+/* Keyframes keep each array only up to its count */
+static int sameGame(const struct gameState *a, const struct gameState *b) {
+  int p;
+
+  if (a->numPlayers != b->numPlayers
+      || memcmp(a->supplyCount, b->supplyCount, sizeof(a->supplyCount)) != 0
+      || memcmp(a->embargoTokens, b->embargoTokens, sizeof(a->embargoTokens)) != 0
+      || a->outpostPlayed != b->outpostPlayed || a->outpostTurn != b->outpostTurn
+      || a->whoseTurn != b->whoseTurn || a->phase != b->phase
+      || a->numActions != b->numActions || a->coins != b->coins
+      || a->numBuys != b->numBuys || a->rngMode != b->rngMode
+      || !sameCards(a->playedCards, a->playedCardCount,
+		    b->playedCards, b->playedCardCount))
+    return 0;
+  for (p = 0; p < MAX_PLAYERS; p++)
+    if (!sameCards(a->hand[p], a->handCount[p], b->hand[p], b->handCount[p])
+	|| !sameCards(a->deck[p], a->deckCount[p], b->deck[p], b->deckCount[p])
+	|| !sameCards(a->discard[p], a->discardCount[p],
+		      b->discard[p], b->discardCount[p]))
+      return 0;
+  return 1;
+}
+
+int main () {
+  struct gameRecord record;
+  struct archiveWriter writer;
+  struct gameArchive archive;
+  struct gameState played[GAMES];
+  struct gameState expected;
+  struct gameState sought;
+  struct gameResult result;
+  int kingdom[10];
+  int ids[2];
+  const unsigned char *data;
+  size_t length;
+  size_t offset;
+  long turn;
+  long reached;
+  int interval;
+  int g;
+
+  printf ("Testing game archives.\n");
+
+  defaultKingdom(kingdom);
+  for (interval = 0; interval <= 4; interval += 4) {
+    initGameRecord(&record);
+    assert(openArchiveWriter(&writer, ARCHIVE_FILE, interval) == 0);
+    for (g = 0; g < GAMES; g++) {
+      ids[0] = g % numStrategies();
+      ids[1] = (g / 2) % numStrategies();
+      assert(playRecordedGame(2, ids, kingdom, g + 1, g % 2, &played[g],
+			      &result, &record) == 0);
+      assert(archiveAppend(&writer, record.data, record.length) == 0);
+    }
+    assert(closeArchiveWriter(&writer) == 0);
+    freeGameRecord(&record);
+    //keyframes hold only the live state, not the 26K struct
+    printf ("keyframes every %d turns: %.0f bytes per game\n", interval,
+	    (double)writer.offset / GAMES);
+    assert(writer.offset / GAMES < 2048);
+
+    assert(openArchive(&archive, ARCHIVE_FILE) == 0);
+    assert(archiveNumGames(&archive) == GAMES);
+    assert(archiveRecord(&archive, GAMES, &length) == NULL);
+
+    for (g = 0; g < GAMES; g++) {
+      //records are read in place from the mapping
+      data = archiveRecord(&archive, g, &length);
+      assert(data != NULL && data > archive.base);
+
+      //every turn sought matches a replay from the start, and play
+      //continued from it reaches the same end, so the RNG streams were
+      //restored along with the state
+      for (turn = 0; ; turn++) {
+	reached = archiveSeek(&archive, g, turn, &sought);
+	assert(reached >= 0 && reached <= turn);
+	replayTo(data, length, turn, &expected, &offset);
+	assert(sameGame(&sought, &expected));
+
+	assert(replayActions(data, length, &offset, -1, &sought, NULL, NULL) >= 0);
+	assert(sameGame(&sought, &played[g]));
+	if (reached < turn)
+	  break;
+      }
+    }
+    closeArchive(&archive);
+  }
+
+  //anything else is rejected
+  assert(openArchive(&archive, "testArchive.c") == -1);
+  remove(ARCHIVE_FILE);
+
+  printf ("ALL TESTS OK\n");
+
+  return 0;
+}
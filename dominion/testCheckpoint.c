@@ -0,0 +1,75 @@
+#include "checkpoint.h"
+#include <string.h>
+#include <stdio.h>
+#include <assert.h>
+
+#define PATH "testCheckpoint.ckpt"
+
+int main () {
+  struct checkpointBuffer buffer;
+  struct checkpointBuffer loaded;
+  uint64_t word;
+  char text[6];
+  unsigned char head[100];
+  FILE *f;
+  int i;
+
+  printf ("Testing checkpoints.\n");
+
+  //words and bytes round trip through a file
+  initCheckpointBuffer(&buffer);
+  for (i = 0; i < 1000; i++)
+    assert(putCheckpointWord(&buffer, (uint64_t)i * 0x0102030405ULL) == 0);
+  assert(putCheckpointBytes(&buffer, "hello", 6) == 0);
+  assert(writeCheckpoint(PATH, &buffer) == 0);
+
+  initCheckpointBuffer(&loaded);
+  assert(readCheckpoint(PATH, &loaded) == 0);
+  assert(loaded.length == buffer.length);
+  for (i = 0; i < 1000; i++) {
+    assert(getCheckpointWord(&loaded, &word) == 0);
+    assert(word == (uint64_t)i * 0x0102030405ULL);
+  }
+  assert(getCheckpointBytes(&loaded, text, 6) == 0);
+  assert(strcmp(text, "hello") == 0);
+  assert(getCheckpointWord(&loaded, &word) == -1);
+
+  //a later checkpoint replaces the earlier one
+  assert(putCheckpointWord(&buffer, 42) == 0);
+  assert(writeCheckpoint(PATH, &buffer) == 0);
+  assert(readCheckpoint(PATH, &loaded) == 0);
+  assert(loaded.length == buffer.length && loaded.offset == 0);
+
+  //a corrupted byte fails the checksum
+  f = fopen(PATH, "r+b");
+  assert(f != NULL);
+  fseek(f, 100, SEEK_SET);
+  i = fgetc(f);
+  fseek(f, 100, SEEK_SET);
+  fputc(i ^ 1, f);
+  fclose(f);
+  assert(readCheckpoint(PATH, &loaded) == -1);
+
+  //so does a truncated file
+  assert(writeCheckpoint(PATH, &buffer) == 0);
+  f = fopen(PATH, "rb");
+  assert(f != NULL);
+  assert(fread(head, 1, sizeof(head), f) == sizeof(head));
+  fclose(f);
+  f = fopen(PATH, "wb");
+  assert(f != NULL);
+  fwrite(head, 1, sizeof(head), f);
+  fclose(f);
+  assert(readCheckpoint(PATH, &loaded) == -1);
+
+  //and a missing one reads as no checkpoint
+  remove(PATH);
+  assert(readCheckpoint(PATH, &loaded) == -1);
+
+  freeCheckpointBuffer(&buffer);
+  freeCheckpointBuffer(&loaded);
+
+  printf ("ALL TESTS OK\n");
+
+  return 0;
+}
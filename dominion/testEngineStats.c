@@ -0,0 +1,107 @@
+#include "dominion.h"
+#include "dominion_helpers.h"
+#include <string.h>
+#include <stdio.h>
+#include <assert.h>
+#include <pthread.h>
+
+/* Built with -DENGINE_STATS; see the Makefile */
+
+static int kingdom[10] = {adventurer, gardens, embargo, village, minion,
+			  mine, cutpurse, sea_hag, tribute, smithy};
+
+static void* dealInThread(void *arg) {
+  struct gameState G;
+  struct engineStats *stats = arg;
+
+  memset(&G, 0, sizeof(G));
+  assert(initializeGame(3, kingdom, 2, &G) == 0);
+  assert(getEngineStats(stats) == 0);
+  return NULL;
+}
+
+int main () {
+  struct gameState G;
+  struct engineStats stats;
+  struct engineStats other;
+  pthread_t thread;
+  int draws;
+
+  printf ("Testing engine statistics.\n");
+
+  memset(&G, 0, sizeof(G));
+  assert(initializeGame(2, kingdom, 1, &G) == 0);
+  assert(getEngineStats(&stats) == 0);
+  assert(stats.shuffles == 2);
+  assert(stats.shuffledCards == 20);
+  assert(stats.draws == 5);
+  assert(stats.reshuffles == 0);
+
+  resetEngineStats();
+  assert(getEngineStats(&stats) == 0);
+  assert(stats.shuffles == 0 && stats.draws == 0);
+
+  //each refusal is counted under its reason
+  G.numBuys = 0;
+  assert(buyCard(silver, &G) == -1);
+  G.numBuys = 1;
+  G.coins = 0;
+  assert(buyCard(province, &G) == -1);
+  assert(buyCard(feast, &G) == -1);
+  G.hand[0][0] = copper;
+  assert(playCard(0, -1, -1, -1, &G) == -1);
+  G.numActions = 0;
+  assert(playCard(0, -1, -1, -1, &G) == -1);
+  G.numActions = 1;
+  G.phase = 1;
+  assert(playCard(0, -1, -1, -1, &G) == -1);
+  G.phase = 0;
+  G.hand[0][0] = mine;
+  G.hand[0][1] = estate;
+  assert(playCard(0, 1, silver, -1, &G) == -1);
+  assert(getEngineStats(&stats) == 0);
+  assert(stats.buyFailures[BUY_NO_BUYS] == 1);
+  assert(stats.buyFailures[BUY_TOO_EXPENSIVE] == 1);
+  assert(stats.buyFailures[BUY_EMPTY_PILE] == 1);
+  assert(stats.playFailures[PLAY_NOT_ACTION] == 1);
+  assert(stats.playFailures[PLAY_NO_ACTIONS] == 1);
+  assert(stats.playFailures[PLAY_WRONG_PHASE] == 1);
+  assert(stats.playFailures[PLAY_REJECTED] == 1);
+  assert(stats.plays[mine] == 1);
+
+  //plays, draws and gains
+  G.hand[0][0] = smithy;
+  assert(playCard(0, -1, -1, -1, &G) == 0);
+  G.coins = 3;
+  assert(buyCard(silver, &G) == 0);
+  assert(getEngineStats(&stats) == 0);
+  assert(stats.plays[smithy] == 1);
+  assert(stats.draws == 3);
+  assert(stats.gains[silver] == 1);
+  assert(stats.gains[province] == 0);
+
+  //drawing from an empty deck shuffles the discards back
+  G.deckCount[0] = 0;
+  G.discard[0][0] = copper;
+  G.discard[0][1] = estate;
+  G.discardCount[0] = 2;
+  draws = stats.draws;
+  assert(drawCard(0, &G) == 0);
+  assert(getEngineStats(&stats) == 0);
+  assert(stats.reshuffles == 1);
+  assert(stats.shuffles == 1);
+  assert(stats.shuffledCards == 2);
+  assert(stats.draws == draws + 1);
+
+  //another thread counts into its own block
+  assert(pthread_create(&thread, NULL, dealInThread, &other) == 0);
+  assert(pthread_join(thread, NULL) == 0);
+  assert(other.shuffles == 3);
+  assert(other.draws == 5);
+  assert(other.buyFailures[BUY_NO_BUYS] == 0);
+  assert(getEngineStats(&stats) == 0);
+  assert(stats.shuffles == 1);
+
+  printf("ALL TESTS OK\n");
+  return 0;
+}
@@ -0,0 +1,114 @@
+#include "dominion.h"
+#include "gamerecord.h"
+#include "simulate.h"
+#include <string.h>
+#include <stdio.h>
+#include <assert.h>
+
+static int countActions(const struct recordAction *action,
+			struct gameState *state, void *ctx) {
+  (*(int*)ctx)++;
+  return 0;
+}
+
+int main () {
+  struct gameRecord record;
+  struct gameState played;
+  struct gameState replayed;
+  struct gameResult result;
+  struct recordHeader header;
+  struct recordAction action;
+  int kingdom[10];
+  int ids[2];
+  int seed;
+  int mode;
+  int actions;
+  long bytes = 0;
+  int games = 0;
+  size_t offset;
+  unsigned long v;
+  unsigned long values[] = {0, 1, 127, 128, 300, 16383, 16384, 2147483647UL};
+  int i;
+
+  printf ("Testing game records.\n");
+
+  //varints round trip
+  initGameRecord(&record);
+  for (i = 0; i < 8; i++)
+    putVarint(&record, values[i]);
+  offset = 0;
+  for (i = 0; i < 8; i++) {
+    assert(getVarint(record.data, record.length, &offset, &v) == 0);
+    assert(v == values[i]);
+  }
+  assert(offset == record.length);
+  assert(getVarint(record.data, record.length, &offset, &v) == -1);
+
+  //every recorded game replays to the identical final state
+  defaultKingdom(kingdom);
+  for (mode = RNG_SHARED; mode <= RNG_PER_PLAYER; mode++) {
+    for (seed = 1; seed <= 100; seed++) {
+      ids[0] = seed % numStrategies();
+      ids[1] = (seed / 3) % numStrategies();
+      assert(playRecordedGame(2, ids, kingdom, seed, mode, &played, &result,
+			      &record) == 0);
+
+      assert(readRecordHeader(record.data, record.length, &header) == 0);
+      assert(header.seed == seed && header.numPlayers == 2 && header.rngMode == mode);
+
+      actions = 0;
+      assert(replayGameRecord(record.data, record.length, &replayed,
+			      countActions, &actions) > 0);
+      assert(actions > result.turns);
+      assert(memcmp(&played, &replayed, sizeof(struct gameState)) == 0);
+
+      bytes += record.length;
+      games++;
+    }
+  }
+  printf ("%d games, %.1f bytes per record\n", games, (double)bytes / games);
+  assert(bytes / games < 256);
+
+  //a truncated play with choices is malformed, not misread
+  beginGameRecord(&record, 2, kingdom, 1, RNG_SHARED);
+  putVarint(&record, ACTION_PLAY_EX << 5);
+  putVarint(&record, 2);
+  assert(replayGameRecord(record.data, record.length, &replayed, NULL, NULL) == -1);
+
+  //so are operands that would index past the engine's arrays
+  beginGameRecord(&record, 2, kingdom, 1, RNG_SHARED);
+  putVarint(&record, ACTION_BUY << 5 | 31);
+  putVarint(&record, 2 * (treasure_map + 1));  //zigzag of treasure_map + 1
+  assert(replayGameRecord(record.data, record.length, &replayed, NULL, NULL) == -1);
+  beginGameRecord(&record, 2, kingdom, 1, RNG_SHARED);
+  putVarint(&record, ACTION_PLAY << 5 | 31);
+  putVarint(&record, 1);  //zigzag of -1
+  assert(replayGameRecord(record.data, record.length, &replayed, NULL, NULL) == -1);
+  beginGameRecord(&record, 2, kingdom, 1, RNG_SHARED);
+  putVarint(&record, ACTION_PLAY << 5 | 5);  //the hand holds 0 to 4
+  assert(replayGameRecord(record.data, record.length, &replayed, NULL, NULL) == -1);
+  beginGameRecord(&record, 2, kingdom, 1, RNG_SHARED);
+  putVarint(&record, ACTION_PLAY << 5 | 31);
+  putVarint(&record, 2 * MAX_HAND);
+  assert(readRecordHeader(record.data, record.length, &header) == 0);
+  offset = header.actionsOffset;
+  assert(readAction(record.data, record.length, &offset, &action) == -1);
+  assert(recordedPlayCard(&record, MAX_HAND, -1, -1, -1, &replayed) == -1);
+  assert(recordedPlayCard(&record, -1, -1, -1, -1, &replayed) == -1);
+
+  //and headers naming cards past treasure_map or an unknown rngMode
+  beginGameRecord(&record, 2, kingdom, 1, RNG_SHARED);
+  assert(readRecordHeader(record.data, record.length, &header) == 0);
+  record.length = 3;
+  putVarint(&record, 0x3ffUL | 1UL << (treasure_map - adventurer + 1));
+  assert(readRecordHeader(record.data, record.length, &header) == -1);
+  beginGameRecord(&record, 2, kingdom, 1, RNG_SHARED);
+  record.data[1] = 2 | 2 << 4;
+  assert(readRecordHeader(record.data, record.length, &header) == -1);
+
+  freeGameRecord(&record);
+
+  printf ("ALL TESTS OK\n");
+
+  return 0;
+}
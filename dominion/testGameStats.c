@@ -0,0 +1,145 @@
+#include "dominion.h"
+#include "gamestats.h"
+#include "simulate.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#define GAMES 1050
+#define GROUP 100
+#define STATS_FILE "testGameStats.cols"
+#define BAD_FILE "testGameStats.bad"
+
+/* Writes a copy of file with the 8 bytes at offset replaced by value */
+static void writeCorrupted(const struct statsFile *file, size_t offset,
+			   uint64_t value) {
+  FILE *out = fopen(BAD_FILE, "wb");
+  assert(out != NULL);
+  assert(fwrite(file->base, 1, offset, out) == offset);
+  assert(fwrite(&value, 8, 1, out) == 1);
+  assert(fwrite(file->base + offset + 8, 1, file->size - offset - 8, out)
+	 == file->size - offset - 8);
+  assert(fclose(out) == 0);
+}
+
+int main () {
+  struct statsWriter writer;
+  struct statsFile file;
+  struct statsRow *rows;
+  struct gameState state;
+  struct gameResult result;
+  int kingdom[10];
+  int ids[3];
+  int players;
+  int seed, p, card, c;
+  int owned;
+  long g, total;
+  long kingdomMask;
+  const void *chunk;
+  struct statsFile bad;
+  uint64_t footer;
+
+  printf ("Testing game statistics files.\n");
+
+  rows = malloc(GAMES * sizeof(struct statsRow));
+  assert(rows != NULL);
+  defaultKingdom(kingdom);
+  kingdomMask = 0;
+  for (c = 0; c < 10; c++)
+    kingdomMask |= 1L << (kingdom[c] - adventurer);
+
+  assert(openStatsWriter(&writer, STATS_FILE, GROUP) == 0);
+  for (seed = 1; seed <= GAMES; seed++) {
+    players = 2 + seed % 2;
+    for (p = 0; p < players; p++)
+      ids[p] = (seed + p) % numStrategies();
+    assert(playGame(players, ids, kingdom, seed, RNG_SHARED, &state, &result) == 0);
+    fillStatsRow(&rows[seed - 1], players, ids, kingdom, seed, RNG_SHARED,
+		 &state, &result);
+
+    //the card counts cover every card the player owns
+    for (p = 0; p < players; p++) {
+      owned = 0;
+      for (card = curse; card <= treasure_map; card++)
+	owned += rows[seed - 1].cards[p][card];
+      assert(owned == state.deckCount[p] + state.handCount[p] + state.discardCount[p]);
+      assert(rows[seed - 1].cards[p][gold] == fullDeckCount(p, gold, &state));
+    }
+    assert(statsAppend(&writer, &rows[seed - 1]) == 0);
+  }
+  assert(closeStatsWriter(&writer) == 0);
+
+  assert(openStatsFile(&file, STATS_FILE) == 0);
+  assert(file.header->numRows == GAMES);
+  assert(file.header->numGroups == (GAMES + GROUP - 1) / GROUP);
+  assert(statsGroupRows(&file, 0) == GROUP);
+  assert(statsGroupRows(&file, GAMES / GROUP) == GAMES % GROUP);
+  assert(statsColumnIndex(&file, "nothing") == -1);
+  assert(strcmp(file.header->strategyNames[0], getStrategy(0)->name) == 0);
+
+  //every value reads back as written, column by column
+  for (g = 0; g < GAMES; g++) {
+    struct statsRow *row = &rows[g];
+    long group = g / GROUP;
+    long i = g % GROUP;
+
+#define VALUE(name) \
+    (chunk = statsChunk(&file, statsColumnIndex(&file, name), group), \
+     statsValue(&file, statsColumnIndex(&file, name), chunk, i))
+
+    assert(VALUE("seed") == row->seed);
+    assert(VALUE("kingdom") == kingdomMask);
+    assert(VALUE("players") == row->numPlayers);
+    assert(VALUE("rng_mode") == RNG_SHARED);
+    assert(VALUE("turns") == row->turns);
+    assert(VALUE("finished") == row->finished);
+    assert(VALUE("winners") == (row->winners[0] | row->winners[1] << 1
+				| row->winners[2] << 2 | row->winners[3] << 3));
+    assert(VALUE("strategy0") == row->strategies[0]);
+    assert(VALUE("strategy3") == STATS_NO_PLAYER);
+    assert(VALUE("score1") == row->scores[1]);
+    assert(VALUE("score2") == (row->numPlayers > 2 ? row->scores[2] : 0));
+    assert(VALUE("p1_province") == row->cards[1][province]);
+    assert(VALUE("p0_copper") == row->cards[0][copper]);
+  }
+
+  //a scan of one column matches the rows
+  c = statsColumnIndex(&file, "score0");
+  total = 0;
+  for (g = 0; g < (long)file.header->numGroups; g++) {
+    long i;
+    chunk = statsChunk(&file, c, g);
+    for (i = 0; i < statsGroupRows(&file, g); i++)
+      total += statsValue(&file, c, chunk, i);
+  }
+  for (g = 0; g < GAMES; g++)
+    total -= rows[g].scores[0];
+  assert(total == 0);
+  assert(statsChunk(&file, c, file.header->numGroups) == NULL);
+
+  //files whose groups would lie past the mapping are refused
+  footer = file.header->footerOffset;
+  writeCorrupted(&file, footer + 8, file.size);
+  assert(openStatsFile(&bad, BAD_FILE) == -1);
+  writeCorrupted(&file, footer + 8, footer - 8);
+  assert(openStatsFile(&bad, BAD_FILE) == -1);
+  writeCorrupted(&file, footer, 0);
+  assert(openStatsFile(&bad, BAD_FILE) == -1);
+  writeCorrupted(&file, offsetof(struct statsFileHeader, numRows),
+		 file.header->numRows + GROUP);
+  assert(openStatsFile(&bad, BAD_FILE) == -1);
+  writeCorrupted(&file, footer, file.groupOffsets[0]);
+  assert(openStatsFile(&bad, BAD_FILE) == 0);
+  closeStatsFile(&bad);
+  remove(BAD_FILE);
+  closeStatsFile(&file);
+
+  assert(openStatsFile(&file, "testGameStats.c") == -1);
+  remove(STATS_FILE);
+  free(rows);
+
+  printf ("ALL TESTS OK\n");
+
+  return 0;
+}
@@ -0,0 +1,98 @@
+#include "dominion.h"
+#include "simulate.h"
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <assert.h>
+
+#define REPEATS 20000
+
+static int sameCards(const int *a, int countA, const int *b, int countB) {
+  return countA == countB && memcmp(a, b, countA * sizeof(int)) == 0;
+}
+
+/* resetGame leaves arrays past their counts as they were */
+static int sameGame(const struct gameState *a, const struct gameState *b) {
+  int p;
+
+  if (memcmp(a, b, offsetof(struct gameState, hand)) != 0
+      || a->rngMode != b->rngMode
+      || !sameCards(a->playedCards, a->playedCardCount,
+		    b->playedCards, b->playedCardCount))
+    return 0;
+  for (p = 0; p < MAX_PLAYERS; p++)
+    if (!sameCards(a->hand[p], a->handCount[p], b->hand[p], b->handCount[p])
+	|| !sameCards(a->deck[p], a->deckCount[p], b->deck[p], b->deckCount[p])
+	|| !sameCards(a->discard[p], a->discardCount[p],
+		      b->discard[p], b->discardCount[p]))
+      return 0;
+  return 1;
+}
+
+int main () {
+  struct gameTemplate tmpl;
+  struct gameState fresh;
+  struct gameState reset;
+  struct gameResult freshResult;
+  struct gameResult resetResult;
+  struct rngPosition freshRng;
+  struct rngPosition resetRng;
+  int kingdom[10];
+  int ids[MAX_PLAYERS] = {0, 1, 2, 0};
+  int players, mode, seed, k;
+  double initTime, resetTime;
+  clock_t start;
+
+  printf ("Testing game templates.\n");
+
+  //a reset game is the game initializeGame deals, RNG positions included
+  for (k = 0; k < 5; k++) {
+    assert(kingdomUnrank(k * 40000L, kingdom) == 0);
+    for (players = 2; players <= MAX_PLAYERS; players++)
+      for (mode = RNG_SHARED; mode <= RNG_PER_PLAYER; mode++) {
+	assert(initGameTemplate(players, kingdom, mode, &tmpl) == 0);
+	for (seed = 1; seed <= 50; seed++) {
+	  memset(&fresh, 0, sizeof(fresh));
+	  assert(initializeGameStreams(players, kingdom, seed, mode, &fresh) == 0);
+	  saveRngPosition(&freshRng);
+	  memset(&reset, 0xa5, sizeof(reset));
+	  assert(resetGame(&tmpl, seed, &reset) == 0);
+	  saveRngPosition(&resetRng);
+	  assert(sameGame(&fresh, &reset));
+	  assert(memcmp(&freshRng, &resetRng, sizeof(freshRng)) == 0);
+	}
+	//and plays out the same way, whatever was left past the counts
+	memset(&reset, 0xa5, sizeof(reset));
+	assert(playGame(players, ids, kingdom, 7, mode, &fresh, &freshResult) == 0);
+	assert(playTemplateGame(&tmpl, ids, 7, &reset, &resetResult) == 0);
+	assert(memcmp(&freshResult, &resetResult, sizeof(freshResult)) == 0);
+	assert(sameGame(&fresh, &reset));
+      }
+  }
+
+  //templates check what initializeGame checks
+  assert(initGameTemplate(1, kingdom, RNG_SHARED, &tmpl) == -1);
+  assert(initGameTemplate(MAX_PLAYERS + 1, kingdom, RNG_SHARED, &tmpl) == -1);
+  kingdom[3] = kingdom[4];
+  assert(initGameTemplate(2, kingdom, RNG_SHARED, &tmpl) == -1);
+
+  defaultKingdom(kingdom);
+  assert(initGameTemplate(2, kingdom, RNG_SHARED, &tmpl) == 0);
+  start = clock();
+  for (seed = 1; seed <= REPEATS; seed++) {
+    memset(&fresh, 0, sizeof(fresh));
+    initializeGame(2, kingdom, seed, &fresh);
+  }
+  initTime = (double)(clock() - start) / CLOCKS_PER_SEC / REPEATS;
+  start = clock();
+  for (seed = 1; seed <= REPEATS; seed++)
+    resetGame(&tmpl, seed, &reset);
+  resetTime = (double)(clock() - start) / CLOCKS_PER_SEC / REPEATS;
+  printf ("game setup: initializeGame %.2f us, resetGame %.2f us\n",
+	  initTime * 1e6, resetTime * 1e6);
+
+  printf ("ALL TESTS OK\n");
+
+  return 0;
+}
@@ -0,0 +1,53 @@
+#include "simulate.h"
+#include <string.h>
+#include <stdio.h>
+#include <assert.h>
+
+int main () {
+  int kingdom[10];
+  int previous[10];
+  int shuffled[10];
+  long rank;
+  int i;
+
+  printf ("Testing kingdom ranks.\n");
+
+  //every rank unranks to a distinct sorted kingdom that ranks back
+  for (rank = 0; rank < NUM_KINGDOMS; rank++) {
+    assert(kingdomUnrank(rank, kingdom) == 0);
+    for (i = 0; i < 10; i++) {
+      assert(kingdom[i] >= adventurer && kingdom[i] <= treasure_map);
+      assert(i == 0 || kingdom[i - 1] < kingdom[i]);
+    }
+    assert(kingdomRank(kingdom) == rank);
+    assert(rank == 0 || memcmp(kingdom, previous, sizeof(kingdom)) != 0);
+    memcpy(previous, kingdom, sizeof(kingdom));
+  }
+
+  //the first and last kingdoms are the lowest and highest ten cards
+  assert(kingdomUnrank(0, kingdom) == 0);
+  assert(kingdom[0] == adventurer && kingdom[9] == adventurer + 9);
+  assert(kingdomUnrank(NUM_KINGDOMS - 1, kingdom) == 0);
+  assert(kingdom[0] == treasure_map - 9 && kingdom[9] == treasure_map);
+
+  //order does not matter
+  for (i = 0; i < 10; i++)
+    shuffled[i] = kingdom[(i * 3) % 10];
+  assert(kingdomRank(shuffled) == NUM_KINGDOMS - 1);
+  defaultKingdom(kingdom);
+  rank = kingdomRank(kingdom);
+  assert(rank >= 0 && kingdomUnrank(rank, shuffled) == 0);
+  assert(kingdomRank(shuffled) == rank);
+
+  //invalid kingdoms and ranks
+  assert(kingdomUnrank(-1, kingdom) == -1);
+  assert(kingdomUnrank(NUM_KINGDOMS, kingdom) == -1);
+  kingdom[1] = kingdom[0];
+  assert(kingdomRank(kingdom) == -1);
+  kingdom[1] = copper;
+  assert(kingdomRank(kingdom) == -1);
+
+  printf ("ALL TESTS OK\n");
+
+  return 0;
+}
@@ -0,0 +1,158 @@
+#include "log.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#define THREADS 4
+#define GAMES 300
+#define LINES 25
+
+static int evaluated = 0;
+
+static int sideEffect(void) {
+  return ++evaluated;
+}
+
+/* Each game is a run of numbered lines, flushed when it ends */
+static void *logGames(void *arg) {
+  int thread = *(int*)arg;
+  int g, l;
+
+  for (g = 0; g < GAMES; g++) {
+    for (l = 0; l < LINES; l++)
+      LOG(LOG_INFO, "game %d line %d\n", thread * GAMES + g, l);
+    LOG(LOG_DEBUG, "never %d\n", sideEffect());
+    logFlush();
+  }
+  return NULL;
+}
+
+/* Steps main and a logging thread take in turn */
+static pthread_mutex_t stepLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t stepped = PTHREAD_COND_INITIALIZER;
+static int step;
+
+static void waitStep(int n) {
+  pthread_mutex_lock(&stepLock);
+  while (step < n)
+    pthread_cond_wait(&stepped, &stepLock);
+  pthread_mutex_unlock(&stepLock);
+}
+
+static void setStep(int n) {
+  pthread_mutex_lock(&stepLock);
+  step = n;
+  pthread_cond_broadcast(&stepped);
+  pthread_mutex_unlock(&stepLock);
+}
+
+/* Holds a buffer across another thread's stopLog */
+static void *logAcrossStop(void *arg) {
+  LOG(LOG_INFO, "before stop\n");
+  setStep(1);
+  waitStep(2);
+  //the buffer was written and freed by stopLog
+  logFlush();
+  logDrain();
+  LOG(LOG_INFO, "while stopped\n");
+  setStep(3);
+  waitStep(4);
+  LOG(LOG_INFO, "after restart\n");
+  logFlush();
+  return NULL;
+}
+
+int main () {
+  pthread_t threads[THREADS];
+  int ids[THREADS];
+  int seen[THREADS * GAMES];
+  char *line;
+  char *longLine;
+  FILE *out;
+  int game, number;
+  int last = -1;
+  int expected = 0;
+  int lines = 0;
+  int i;
+  pthread_t across;
+
+  printf ("Testing the logger.\n");
+
+  //nothing is written, or evaluated, before startLog
+  LOG(LOG_ERROR, "dropped %d\n", sideEffect());
+  assert(evaluated == 0);
+
+  out = tmpfile();
+  assert(out != NULL);
+  assert(startLog(out, LOG_INFO) == 0);
+  assert(startLog(out, LOG_INFO) == -1);
+
+  for (i = 0; i < THREADS; i++) {
+    ids[i] = i;
+    assert(pthread_create(&threads[i], NULL, logGames, &ids[i]) == 0);
+  }
+  for (i = 0; i < THREADS; i++)
+    pthread_join(threads[i], NULL);
+  assert(evaluated == 0);
+
+  //a line longer than a buffer is kept whole
+  longLine = malloc(2 * LOG_BUFFER_SIZE + 1);
+  memset(longLine, 'x', 2 * LOG_BUFFER_SIZE);
+  longLine[2 * LOG_BUFFER_SIZE] = '\0';
+  LOG(LOG_WARN, "%s\n", longLine);
+  stopLog();
+  assert(logLevel == -1);
+
+  //every game's lines are together and in order
+  line = malloc(2 * LOG_BUFFER_SIZE + 2);
+  memset(seen, 0, sizeof(seen));
+  rewind(out);
+  while (fgets(line, 2 * LOG_BUFFER_SIZE + 2, out) != NULL) {
+    if (line[0] == 'x') {
+      assert(strlen(line) == 2 * LOG_BUFFER_SIZE + 1);
+      continue;
+    }
+    assert(sscanf(line, "game %d line %d", &game, &number) == 2);
+    if (number == 0) {
+      assert(expected == 0);
+      assert(!seen[game]);
+      seen[game] = 1;
+      last = game;
+    }
+    assert(game == last && number == expected);
+    expected = (number + 1) % LINES;
+    lines++;
+  }
+  assert(lines == THREADS * GAMES * LINES);
+  fclose(out);
+
+  //a thread logging across stopLog and startLog loses nothing and
+  //touches no freed buffer
+  out = tmpfile();
+  assert(out != NULL);
+  assert(startLog(out, LOG_INFO) == 0);
+  assert(pthread_create(&across, NULL, logAcrossStop, NULL) == 0);
+  waitStep(1);
+  stopLog();
+  setStep(2);
+  waitStep(3);
+  assert(startLog(out, LOG_INFO) == 0);
+  setStep(4);
+  pthread_join(across, NULL);
+  stopLog();
+  rewind(out);
+  assert(fgets(line, 2 * LOG_BUFFER_SIZE + 2, out) != NULL);
+  assert(strcmp(line, "before stop\n") == 0);
+  assert(fgets(line, 2 * LOG_BUFFER_SIZE + 2, out) != NULL);
+  assert(strcmp(line, "after restart\n") == 0);
+  assert(fgets(line, 2 * LOG_BUFFER_SIZE + 2, out) == NULL);
+  fclose(out);
+  free(line);
+  free(longLine);
+
+  printf ("ALL TESTS OK\n");
+
+  return 0;
+}
@@ -0,0 +1,152 @@
+#define _DEFAULT_SOURCE
+#include "dominion.h"
+#include "simulate.h"
+#include "strategy.h"
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#define SEEDS 50
+#define TURNS 20  /* ten turns a seat, past the first reshuffles of both */
+
+/* The hand each turn of a game starts with, the game played turn by
+   turn as playTemplateGame plays it */
+static void dealtHands(const struct gameTemplate *tmpl, const int ids[2],
+		       int seed, int hands[TURNS][5]) {
+  struct gameState state;
+  struct botMemory memory[2];
+  int player;
+  int t;
+
+  memset(memory, 0, sizeof(memory));
+  assert(resetGame(tmpl, seed, &state) == 0);
+  for (t = 0; t < TURNS; t++) {
+    player = whoseTurn(&state);
+    assert(player == t % 2 && numHandCards(&state) == 5);
+    memcpy(hands[t], state.hand[player], sizeof(hands[t]));
+    getStrategy(ids[player])->playTurn(player, &state, &memory[player]);
+    endTurn(&state);
+  }
+}
+
+/* Whether seat's hands on its turns before turn end agree in both games */
+static int sameDeals(int x[TURNS][5], int y[TURNS][5], int seat, int end) {
+  int t;
+  for (t = seat; t < end; t += 2)
+    if (memcmp(x[t], y[t], sizeof(x[t])) != 0)
+      return 0;
+  return 1;
+}
+
+/* How many seeds give the opponent different hands when the candidate
+   in seat changes */
+static int perturbedSeeds(const struct gameTemplate *tmpl, int candidateA,
+			  int candidateB, int opponent, int seat) {
+  int handsA[TURNS][5];
+  int handsB[TURNS][5];
+  int ids[2];
+  int differ = 0;
+  int seed;
+
+  for (seed = 1; seed <= SEEDS; seed++) {
+    ids[1 - seat] = opponent;
+    ids[seat] = candidateA;
+    dealtHands(tmpl, ids, seed, handsA);
+    ids[seat] = candidateB;
+    dealtHands(tmpl, ids, seed, handsB);
+    if (!sameDeals(handsA, handsB, 1 - seat, TURNS))
+      differ++;
+  }
+  return differ;
+}
+
+/* Reads the difference and paired variance of both measures from sim
+   paired's report */
+static void runPaired(const char *strategies, double difference[2],
+		      double variance[2]) {
+  char command[256];
+  char line[512];
+  char *at;
+  int differences = 0;
+  int variances = 0;
+  FILE *out;
+
+  snprintf(command, sizeof(command), "./sim paired -n %d -t 2 %s", SEEDS, strategies);
+  out = popen(command, "r");
+  assert(out != NULL);
+  while (fgets(line, sizeof(line), out) != NULL) {
+    if ((at = strstr(line, "difference ")) != NULL && differences < 2)
+      assert(sscanf(at, "difference %lf", &difference[differences++]) == 1);
+    if ((at = strstr(line, "paired variance ")) != NULL && variances < 2)
+      assert(sscanf(at, "paired variance %lf", &variance[variances++]) == 1);
+  }
+  assert(pclose(out) == 0);
+  assert(differences == 2 && variances == 2);
+}
+
+int main () {
+  struct gameTemplate perPlayer;
+  struct gameTemplate shared;
+  int kingdom[10];
+  int hands[2][2][TURNS][5];   //[seat of smithy_bm][game][turn]
+  int ids[2];
+  int smithy = findStrategy("smithy_bm");
+  int adventurer = findStrategy("adventurer_bm");
+  int bigMoney = findStrategy("big_money");
+  double difference[2];
+  double variance[2];
+  int seat, seed;
+  int differ;
+
+  printf ("Testing paired replays.\n");
+
+  defaultKingdom(kingdom);
+  assert(initGameTemplate(2, kingdom, RNG_PER_PLAYER, &perPlayer) == 0);
+  assert(initGameTemplate(2, kingdom, RNG_SHARED, &shared) == 0);
+
+  //with per-player streams, the opponent is dealt the same hands
+  //whichever candidate sits across from it, from either seat
+  for (seat = 0; seat < 2; seat++)
+    assert(perturbedSeeds(&perPlayer, smithy, adventurer, bigMoney, seat) == 0);
+
+  //and swapping seats on a seed replays the same opening deal to each
+  //seat, whoever sits there
+  for (seed = 1; seed <= SEEDS; seed++) {
+    for (seat = 0; seat < 2; seat++) {
+      ids[seat] = smithy;
+      ids[1 - seat] = bigMoney;
+      dealtHands(&perPlayer, ids, seed, hands[seat][0]);
+      ids[seat] = adventurer;
+      dealtHands(&perPlayer, ids, seed, hands[seat][1]);
+    }
+    for (seat = 0; seat < 2; seat++) {
+      assert(sameDeals(hands[0][0], hands[1][0], seat, 4));
+      assert(sameDeals(hands[0][1], hands[1][1], seat, 4));
+      assert(sameDeals(hands[0][0], hands[1][1], seat, 4));
+    }
+  }
+
+  //which a shared stream does not guarantee
+  differ = perturbedSeeds(&shared, smithy, adventurer, bigMoney, 0)
+    + perturbedSeeds(&shared, smithy, adventurer, bigMoney, 1);
+  printf ("shared stream: %d of %d opponent deals perturbed\n", differ, 2 * SEEDS);
+  assert(differ > 0);
+
+  //a candidate paired with itself differs by exactly nothing
+  runPaired("big_money big_money smithy_bm", difference, variance);
+  assert(difference[0] == 0.0 && difference[1] == 0.0);
+  assert(variance[0] == 0.0 && variance[1] == 0.0);
+  runPaired("adventurer_bm adventurer_bm big_money", difference, variance);
+  assert(difference[0] == 0.0 && difference[1] == 0.0);
+  assert(variance[0] == 0.0 && variance[1] == 0.0);
+
+  //while different candidates do differ
+  runPaired("smithy_bm adventurer_bm big_money", difference, variance);
+  printf ("smithy_bm - adventurer_bm: %+.4f points, %+.4f margin per game\n",
+	  difference[0], difference[1]);
+  assert(variance[0] > 0.0 && variance[1] > 0.0);
+
+  printf ("ALL TESTS OK\n");
+
+  return 0;
+}
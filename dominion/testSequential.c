@@ -0,0 +1,134 @@
+#include "sequential.h"
+#include "rngs.h"
+#include <math.h>
+#include <stdio.h>
+#include <assert.h>
+
+#define DELTA 0.05
+#define ALPHA 0.05
+#define BETA 0.05
+#define RUNS 1000
+#define MAX_GAMES 100000
+
+/* Runs one test on a stream where the first strategy wins a game with
+   probability p * (1 - ties) and ties with probability ties */
+static int runStream(double p, double ties, struct sprt *test) {
+  double u;
+  long g;
+
+  assert(initSprt(test, DELTA, ALPHA, BETA) == 0);
+  for (g = 0; g < MAX_GAMES; g++) {
+    u = Random();
+    if (u < ties)
+      sprtUpdate(test, 0);
+    else if (u < ties + p * (1.0 - ties))
+      sprtUpdate(test, 1);
+    else
+      sprtUpdate(test, -1);
+    if (test->decision != SPRT_CONTINUE)
+      return test->decision;
+  }
+  return SPRT_CONTINUE;
+}
+
+/* How often each decision is reached over RUNS streams */
+static void decisions(double p, double ties, int counts[4], double *meanGames) {
+  struct sprt test;
+  long games = 0;
+  int r;
+
+  counts[0] = counts[1] = counts[2] = counts[3] = 0;
+  for (r = 0; r < RUNS; r++) {
+    counts[runStream(p, ties, &test)]++;
+    games += test.wins + test.losses;
+  }
+  *meanGames = (double)games / RUNS;
+  printf("p %.2f: first better %d, second better %d, within delta %d, undecided %d, %.0f decisive games\n",
+	 p, counts[SPRT_FIRST_BETTER], counts[SPRT_SECOND_BETTER],
+	 counts[SPRT_EQUIVALENT], counts[SPRT_CONTINUE], *meanGames);
+}
+
+int main () {
+  struct sprt test;
+  int counts[4];
+  double meanGames;
+  long n;
+  long i;
+  //three standard deviations of a count of RUNS trials at rate ALPHA
+  int slack = (int)(3.0 * sqrt(RUNS * ALPHA * (1.0 - ALPHA))) + 1;
+
+  printf ("Testing sequential tests.\n");
+
+  //parameters
+  assert(initSprt(&test, 0.0, ALPHA, BETA) == -1);
+  assert(initSprt(&test, 0.5, ALPHA, BETA) == -1);
+  assert(initSprt(&test, DELTA, 0.5, BETA) == -1);
+  assert(initSprt(&test, DELTA, ALPHA, 0.0) == -1);
+  assert(initSprt(&test, DELTA, ALPHA, BETA) == 0);
+
+  //Wald's boundaries and the steps of each one-sided test
+  assert(fabs(test.lower - log(BETA / (1.0 - ALPHA))) < 1e-12);
+  assert(fabs(test.upper - log((1.0 - BETA) / ALPHA)) < 1e-12);
+  assert(fabs(test.logEdge - log(1.0 + 2.0 * DELTA)) < 1e-12);
+  assert(fabs(test.logNoEdge - log(1.0 - 2.0 * DELTA)) < 1e-12);
+
+  //straight wins stop on the first win that reaches the upper boundary
+  n = (long)ceil(test.upper / test.logEdge);
+  for (i = 1; i < n; i++)
+    assert(sprtUpdate(&test, 1) == SPRT_CONTINUE);
+  assert(sprtUpdate(&test, 1) == SPRT_FIRST_BETTER);
+  assert(test.wins == n && test.llrFirst >= test.upper);
+
+  //the decision sticks and stops counting
+  assert(sprtUpdate(&test, -1) == SPRT_FIRST_BETTER);
+  assert(sprtGames(&test) == n);
+
+  //straight losses mirror it, and ties do not move either test
+  initSprt(&test, DELTA, ALPHA, BETA);
+  for (i = 1; i < n; i++) {
+    assert(sprtUpdate(&test, 0) == SPRT_CONTINUE);
+    assert(sprtUpdate(&test, -1) == SPRT_CONTINUE);
+  }
+  assert(sprtUpdate(&test, -1) == SPRT_SECOND_BETTER);
+  assert(test.losses == n && test.ties == n - 1 && sprtGames(&test) == 2 * n - 1);
+
+  //an even split drives both tests to 0.5
+  initSprt(&test, DELTA, ALPHA, BETA);
+  for (i = 0; i < MAX_GAMES && test.decision == SPRT_CONTINUE; i++)
+    sprtUpdate(&test, i % 2 ? -1 : 1);
+  assert(test.decision == SPRT_EQUIVALENT);
+  assert(test.llrFirst <= test.lower && test.llrSecond <= test.lower);
+
+  //error rates on Bernoulli streams
+  PlantSeeds(1);
+  SelectStream(1);
+
+  //equal strategies: neither is called better more than alpha of the time
+  decisions(0.5, 0.0, counts, &meanGames);
+  assert(counts[SPRT_CONTINUE] == 0);
+  assert(counts[SPRT_FIRST_BETTER] <= RUNS * ALPHA + slack);
+  assert(counts[SPRT_SECOND_BETTER] <= RUNS * ALPHA + slack);
+  assert(counts[SPRT_EQUIVALENT] >= RUNS * (1.0 - 2.0 * ALPHA) - 2 * slack);
+
+  //an edge of delta is found at least 1 - beta of the time
+  decisions(0.5 + DELTA, 0.0, counts, &meanGames);
+  assert(counts[SPRT_FIRST_BETTER] >= RUNS * (1.0 - BETA) - slack);
+  assert(counts[SPRT_SECOND_BETTER] <= slack);
+  decisions(0.5 - DELTA, 0.0, counts, &meanGames);
+  assert(counts[SPRT_SECOND_BETTER] >= RUNS * (1.0 - BETA) - slack);
+  assert(counts[SPRT_FIRST_BETTER] <= slack);
+
+  //a larger edge is found with fewer games
+  n = (long)meanGames;
+  decisions(0.5 - 2 * DELTA, 0.0, counts, &meanGames);
+  assert(counts[SPRT_SECOND_BETTER] >= RUNS * (1.0 - BETA) - slack);
+  assert(meanGames < n);
+
+  //ties only lengthen the stream
+  decisions(0.5 + DELTA, 0.3, counts, &meanGames);
+  assert(counts[SPRT_FIRST_BETTER] >= RUNS * (1.0 - BETA) - slack);
+
+  printf ("ALL TESTS OK\n");
+
+  return 0;
+}
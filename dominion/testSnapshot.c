@@ -0,0 +1,120 @@
+#include "dominion.h"
+#include "gamerecord.h"
+#include "simulate.h"
+#include "snapshot.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <time.h>
+
+#define SNAPSHOT_FILE "testSnapshot.snap"
+#define REPEATS 20000
+
+int main () {
+  struct gameRecord record;
+  struct recordHeader header;
+  struct gameState played;
+  struct gameState resumed;
+  struct gameState loaded;
+  struct gameResult result;
+  unsigned char *buffer;
+  int kingdom[10];
+  int ids[2] = {1, 0};
+  size_t offset;
+  size_t saved;
+  int seed;
+  int mode;
+  int turn;
+  int i;
+  clock_t start;
+  double saveTime;
+  double loadTime;
+
+  printf ("Testing snapshots.\n");
+
+  //every field is stored, nothing else
+  assert(snapshotSize() == sizeof(SNAPSHOT_MAGIC) + 4 * 5
+	 + sizeof(struct gameState) + 4 * (1 + MAX_PLAYERS));
+  buffer = malloc(snapshotSize());
+  assert(buffer != NULL);
+
+  //a game saved part way and loaded again plays on to the same end,
+  //including the shuffles drawn from the restored streams
+  defaultKingdom(kingdom);
+  initGameRecord(&record);
+  for (mode = RNG_SHARED; mode <= RNG_PER_PLAYER; mode++) {
+    for (seed = 1; seed <= 40; seed++) {
+      assert(playRecordedGame(2, ids, kingdom, seed, mode, &played, &result,
+			      &record) == 0);
+      for (turn = 0; turn < 30; turn += 7) {
+	assert(startReplay(record.data, record.length, &header, &resumed) == 0);
+	offset = header.actionsOffset;
+	replayActions(record.data, record.length, &offset, turn, &resumed, NULL, NULL);
+	saved = offset;
+	assert(saveSnapshot(&resumed, buffer, snapshotSize()) == 0);
+
+	//disturb the streams and the state before loading
+	memset(&loaded, 0xff, sizeof(struct gameState));
+	initializeGame(3, kingdom, seed + 1000, &resumed);
+	assert(loadSnapshot(buffer, snapshotSize(), &loaded) == 0);
+
+	offset = saved;
+	replayActions(record.data, record.length, &offset, -1, &loaded, NULL, NULL);
+	assert(memcmp(&loaded, &played, sizeof(struct gameState)) == 0);
+      }
+    }
+  }
+  freeGameRecord(&record);
+
+  //files round trip
+  assert(saveSnapshotFile(SNAPSHOT_FILE, &played) == 0);
+  memset(&loaded, 0, sizeof(struct gameState));
+  assert(loadSnapshotFile(SNAPSHOT_FILE, &loaded) == 0);
+  assert(memcmp(&loaded, &played, sizeof(struct gameState)) == 0);
+  remove(SNAPSHOT_FILE);
+
+  //the encoding is little-endian whatever the host
+  assert(saveSnapshot(&played, buffer, snapshotSize()) == 0);
+  assert(buffer[8] == SNAPSHOT_VERSION && buffer[9] == 0 && buffer[10] == 0);
+  assert(buffer[12] == MAX_PLAYERS && buffer[13] == 0);
+
+  //bad snapshots are rejected and leave the state alone
+  memcpy(&loaded, &played, sizeof(struct gameState));
+  assert(saveSnapshot(&played, buffer, snapshotSize() - 1) == -1);
+  assert(loadSnapshot(buffer, snapshotSize() - 1, &loaded) == -1);
+  buffer[8] = SNAPSHOT_VERSION + 1;
+  assert(loadSnapshot(buffer, snapshotSize(), &loaded) == -1);
+  buffer[8] = SNAPSHOT_VERSION;
+  buffer[sizeof(SNAPSHOT_MAGIC) + 4 * 5] = 9;  //numPlayers
+  assert(loadSnapshot(buffer, snapshotSize(), &loaded) == -1);
+  buffer[sizeof(SNAPSHOT_MAGIC) + 4 * 5] = played.numPlayers;
+  assert(played.handCount[0] > 0);
+  i = sizeof(SNAPSHOT_MAGIC) + 4 * (5 + 1 + 2 * (treasure_map + 1) + 7);
+  buffer[i] = treasure_map + 1;  //hand[0][0]
+  assert(loadSnapshot(buffer, snapshotSize(), &loaded) == -1);
+  memset(buffer + i, 0xff, 4);  //-1
+  assert(loadSnapshot(buffer, snapshotSize(), &loaded) == -1);
+  assert(memcmp(&loaded, &played, sizeof(struct gameState)) == 0);
+  assert(saveSnapshot(&played, buffer, snapshotSize()) == 0);
+  assert(loadSnapshot(buffer, snapshotSize(), &loaded) == 0);
+  assert(memcmp(&loaded, &played, sizeof(struct gameState)) == 0);
+
+  //timing
+  start = clock();
+  for (i = 0; i < REPEATS; i++)
+    saveSnapshot(&played, buffer, snapshotSize());
+  saveTime = (double)(clock() - start) / CLOCKS_PER_SEC / REPEATS;
+  start = clock();
+  for (i = 0; i < REPEATS; i++)
+    loadSnapshot(buffer, snapshotSize(), &loaded);
+  loadTime = (double)(clock() - start) / CLOCKS_PER_SEC / REPEATS;
+  printf ("%lu byte snapshots, save %.2f us, load %.2f us\n",
+	  (unsigned long)snapshotSize(), saveTime * 1e6, loadTime * 1e6);
+
+  free(buffer);
+
+  printf ("ALL TESTS OK\n");
+
+  return 0;
+}
@@ -0,0 +1,207 @@
+#include "dominion.h"
+#include "dominion_helpers.h"
+#include "stategen.h"
+#include "rngs.h"
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <assert.h>
+
+#define STATES 200000
+
+static int kingdom[10] = {adventurer, gardens, embargo, village, minion,
+			  mine, cutpurse, sea_hag, tribute, smithy};
+
+static int isTreasure(int card) {
+  return card >= copper && card <= gold;
+}
+
+/* Everything stategen.h promises of a state from gen */
+static void checkState(const struct stateGenerator *gen, struct gameState *G) {
+  const struct stateShape *shape = &gen->shape;
+  int total[treasure_map + 1];
+  int owned, coins, tokens;
+  int p, i, card;
+
+  assert(G->numPlayers >= shape->minPlayers && G->numPlayers <= shape->maxPlayers);
+  assert(G->whoseTurn >= 0 && G->whoseTurn < G->numPlayers);
+  assert(G->phase == 0 || G->phase == 1);
+  assert(G->numActions >= shape->minActions && G->numActions <= shape->maxActions);
+  assert(G->numBuys >= shape->minBuys && G->numBuys <= shape->maxBuys);
+
+  memset(total, 0, sizeof(total));
+  for (p = 0; p < G->numPlayers; p++)
+    {
+      owned = G->handCount[p] + G->deckCount[p] + G->discardCount[p];
+      if (p == G->whoseTurn)
+	owned += G->playedCardCount;
+      assert(G->handCount[p] <= shape->maxHand);
+      assert(G->handCount[p] >= shape->minHand || G->deckCount[p] + G->discardCount[p] == 0);
+      //gains stop early only when every pile is empty
+      assert(owned >= 10 - shape->maxTrashed && owned <= 10 + shape->maxGained);
+      assert(G->deckCount[p] >= 0 && G->discardCount[p] >= 0);
+      for (card = curse; card <= treasure_map; card++)
+	total[card] += fullDeckCount(p, card, G);
+    }
+  for (; p < MAX_PLAYERS; p++)
+    assert(G->handCount[p] == 0 && G->deckCount[p] == 0 && G->discardCount[p] == 0);
+  for (i = 0; i < G->playedCardCount; i++)
+    {
+      assert(G->playedCards[i] >= adventurer && G->playedCards[i] != gardens);
+      total[G->playedCards[i]]++;
+    }
+  assert(G->playedCardCount <= shape->maxPlayed);
+
+  //the supply is short by what was gained
+  tokens = 0;
+  for (card = curse; card <= treasure_map; card++)
+    {
+      if (gen->supply[G->numPlayers][card] == -1)
+	{
+	  assert(G->supplyCount[card] == -1);
+	  assert(total[card] == 0);
+	  assert(G->embargoTokens[card] == 0);
+	  continue;
+	}
+      assert(G->supplyCount[card] >= 0);
+      if (card == copper)
+	assert(total[card] + G->supplyCount[card] == 7 * G->numPlayers
+	       + gen->supply[G->numPlayers][card]);
+      else if (card == estate)
+	assert(total[card] + G->supplyCount[card] == 3 * G->numPlayers
+	       + gen->supply[G->numPlayers][card]);
+      else
+	assert(total[card] + G->supplyCount[card] == gen->supply[G->numPlayers][card]);
+      tokens += G->embargoTokens[card];
+    }
+  assert(tokens <= shape->maxEmbargo);
+
+  coins = 0;
+  for (i = 0; i < G->handCount[G->whoseTurn]; i++)
+    if (isTreasure(G->hand[G->whoseTurn][i]))
+      coins += G->hand[G->whoseTurn][i] - copper + 1;
+  assert(G->coins >= coins && G->coins <= coins + shape->maxBonus);
+}
+
+int main () {
+  struct stateGenerator gen;
+  struct stateGenerator other;
+  struct stateShape shape;
+  struct gameState G;
+  struct gameState H;
+  int seen[MAX_PLAYERS + 1] = {0};
+  int phases[2] = {0, 0};
+  int emptyPiles = 0, played = 0;
+  int p, n, card, hand;
+  double before, after;
+  clock_t start;
+
+  printf ("Testing random state generation.\n");
+
+  //shapes past the engine's limits and bad kingdoms are refused
+  defaultStateShape(&shape);
+  shape.maxPlayers = MAX_PLAYERS + 1;
+  assert(initStateGenerator(&gen, kingdom, &shape, 1) == -1);
+  defaultStateShape(&shape);
+  shape.minHand = 8;
+  assert(initStateGenerator(&gen, kingdom, &shape, 1) == -1);
+  defaultStateShape(&shape);
+  shape.buyPhase = 101;
+  assert(initStateGenerator(&gen, kingdom, &shape, 1) == -1);
+  defaultStateShape(&shape);
+  kingdom[1] = adventurer;
+  assert(initStateGenerator(&gen, kingdom, &shape, 1) == -1);
+  kingdom[1] = gardens;
+
+  //every state is consistent, and the shape's ranges are all reached
+  assert(initStateGenerator(&gen, kingdom, &shape, 1) == 0);
+  for (n = 0; n < STATES; n++)
+    {
+      randomState(&gen, &G);
+      checkState(&gen, &G);
+      seen[G.numPlayers]++;
+      phases[G.phase]++;
+      played += G.playedCardCount > 0;
+      for (card = adventurer; card <= treasure_map; card++)
+	emptyPiles += G.supplyCount[card] == 0;
+    }
+  for (p = 2; p <= MAX_PLAYERS; p++)
+    assert(seen[p] > STATES / 4);
+  assert(phases[1] > STATES / 5 && phases[1] < STATES * 3 / 10);
+  assert(played > 0 && emptyPiles > 0);
+
+  //trashing and a single player count
+  shape.minPlayers = shape.maxPlayers = 3;
+  shape.minGained = shape.maxGained = 0;
+  shape.maxTrashed = 10;
+  shape.maxHand = MAX_HAND;
+  assert(initStateGenerator(&gen, kingdom, &shape, 2) == 0);
+  for (n = 0; n < 10000; n++)
+    {
+      randomState(&gen, &G);
+      assert(G.numPlayers == 3);
+      for (p = 0; p < 3; p++)
+	{
+	  hand = G.handCount[p];
+	  assert(hand + G.deckCount[p] + G.discardCount[p]
+		 + (p == G.whoseTurn ? G.playedCardCount : 0) <= 10);
+	  assert(G.deckCount[p] + G.discardCount[p] == 0 || hand >= shape.minHand);
+	}
+      assert(G.playedCardCount == 0);
+    }
+
+  //the same seed gives the same states, and the engine's streams are
+  //left alone
+  defaultStateShape(&shape);
+  assert(initStateGenerator(&gen, kingdom, &shape, 7) == 0);
+  assert(initStateGenerator(&other, kingdom, &shape, 7) == 0);
+  SelectStream(1);
+  PutSeed(5);
+  before = Random();
+  PutSeed(5);
+  for (n = 0; n < 1000; n++)
+    {
+      memset(&G, 0, sizeof(G));
+      memset(&H, 0, sizeof(H));
+      randomState(&gen, &G);
+      randomState(&other, &H);
+      assert(memcmp(&G, &H, sizeof(G)) == 0);
+    }
+  after = Random();
+  assert(before == after);
+
+  //and the engine takes the states as they are: drawCard moves the top
+  //card of the deck, or reshuffles the discards
+  for (n = 0; n < 20000; n++)
+    {
+      randomState(&gen, &G);
+      p = G.whoseTurn;
+      memcpy(&H, &G, sizeof(G));
+      if (G.deckCount[p] + G.discardCount[p] == 0)
+	continue;
+      assert(drawCard(p, &G) == 0);
+      assert(G.handCount[p] == H.handCount[p] + 1);
+      if (H.deckCount[p] > 0)
+	{
+	  assert(G.hand[p][G.handCount[p] - 1] == H.deck[p][H.deckCount[p] - 1]);
+	  assert(G.deckCount[p] == H.deckCount[p] - 1);
+	}
+      else
+	{
+	  assert(G.deckCount[p] == H.discardCount[p] - 1);
+	  assert(G.discardCount[p] == 0);
+	}
+      for (card = curse; card <= treasure_map; card++)
+	assert(fullDeckCount(p, card, &G) == fullDeckCount(p, card, &H));
+    }
+
+  //cheap enough for millions of states
+  start = clock();
+  for (n = 0; n < STATES; n++)
+    randomState(&gen, &G);
+  printf("%.0f states per second\n",
+	 STATES / ((double)(clock() - start) / CLOCKS_PER_SEC + 1e-9));
+
+  printf("ALL TESTS OK\n");
+  return 0;
+}
@@ -0,0 +1,76 @@
+#include "dominion.h"
+#include "dominion_helpers.h"
+#include <string.h>
+#include <stdio.h>
+#include <assert.h>
+#include "rngs.h"
+
+int main () {
+
+  int k[10] = {adventurer, council_room, feast, gardens, mine,
+	       remodel, smithy, village, baron, great_hall};
+
+  struct gameState A;
+  struct gameState B;
+  int seed;
+
+  printf ("Testing shuffle streams.\n");
+
+  for (seed = 1; seed <= 50; seed++) {
+    //initializeGame is the shared-stream mode, untouched
+    memset(&A, 0, sizeof(struct gameState));
+    memset(&B, 0, sizeof(struct gameState));
+    assert(initializeGame(3, k, seed, &A) == 0);
+    assert(initializeGameStreams(3, k, seed, RNG_SHARED, &B) == 0);
+    assert(memcmp(&A, &B, sizeof(struct gameState)) == 0);
+
+    //per player: an extra shuffle by player 1 must not move player 0's
+    //cards.  Stream state lives in rngs.c, so play the games one at a time
+    memset(&A, 0, sizeof(struct gameState));
+    assert(initializeGameStreams(3, k, seed, RNG_PER_PLAYER, &A) == 0);
+    assert(shuffle(0, &A) == 0);
+    assert(shuffle(2, &A) == 0);
+
+    memset(&B, 0, sizeof(struct gameState));
+    assert(initializeGameStreams(3, k, seed, RNG_PER_PLAYER, &B) == 0);
+    assert(shuffle(1, &B) == 0);
+    assert(shuffle(1, &B) == 0);
+    assert(shuffle(0, &B) == 0);
+    assert(shuffle(2, &B) == 0);
+
+    assert(memcmp(A.deck[0], B.deck[0], sizeof(int) * A.deckCount[0]) == 0);
+    assert(memcmp(A.deck[2], B.deck[2], sizeof(int) * A.deckCount[2]) == 0);
+
+    //shuffling leaves the game stream selected and does not advance it
+    {
+      long before, after;
+      SelectStream(GAME_STREAM);
+      GetSeed(&before);
+      assert(shuffle(2, &A) == 0);
+      GetSeed(&after);
+      assert(before == after);
+    }
+  }
+
+  //the same experiment in shared mode does perturb player 0
+  {
+    int differ = 0;
+    for (seed = 1; seed <= 50; seed++) {
+      memset(&A, 0, sizeof(struct gameState));
+      initializeGame(3, k, seed, &A);
+      shuffle(0, &A);
+      memset(&B, 0, sizeof(struct gameState));
+      initializeGame(3, k, seed, &B);
+      shuffle(1, &B);
+      shuffle(0, &B);
+      if (memcmp(A.deck[0], B.deck[0], sizeof(int) * A.deckCount[0]) != 0)
+	differ++;
+    }
+    printf ("shared stream: %d of 50 seeds perturbed\n", differ);
+    assert(differ > 0);
+  }
+
+  printf ("ALL TESTS OK\n");
+
+  return 0;
+}
@@ -0,0 +1,127 @@
+#include "threadpool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+struct sumAccum {
+  long sum;
+  long items;
+};
+
+static void sumRange(long lo, long hi, int worker, void *accum, void *ctx) {
+  struct sumAccum *a = accum;
+  long i;
+  for (i = lo; i < hi; i++) {
+    a->sum += i;
+    a->items++;
+  }
+}
+
+struct spawnArg {
+  struct threadPool *pool;
+  int depth;
+};
+
+static struct spawnArg spawnArgs[64];
+
+static void countJob(void *arg, int worker, void *accum) {
+  ((struct sumAccum*)accum)->items++;
+}
+
+static void spawnJob(void *arg, int worker, void *accum) {
+  struct spawnArg *s = arg;
+  int i;
+  ((struct sumAccum*)accum)->items++;
+  //jobs submitted from a job land on this worker's deque
+  for (i = 0; i < 100; i++)
+    poolSubmit(s->pool, countJob, NULL);
+}
+
+static void rangeJob(void *arg, int worker, void *accum) {
+  struct spawnArg *s = arg;
+  ((struct sumAccum*)accum)->items++;
+  //waits for its own range while the other rangeJobs are still queued
+  assert(poolParallelFor(s->pool, 0, 1000, 10, sumRange, NULL) == 0);
+}
+
+static long totalItems(struct threadPool *pool, long *sum) {
+  long items = 0;
+  int w;
+  *sum = 0;
+  for (w = 0; w < poolNumWorkers(pool); w++) {
+    struct sumAccum *a = poolAccumulator(pool, w);
+    items += a->items;
+    *sum += a->sum;
+  }
+  return items;
+}
+
+int main () {
+  struct threadPool *pool;
+  long n = 1000003;
+  long sum;
+  long items;
+  int i;
+  int w;
+
+  printf ("Testing thread pool.\n");
+
+  for (w = 1; w <= 4; w++) {
+    pool = newThreadPool(w, sizeof(struct sumAccum));
+    assert(pool != NULL);
+    assert(poolNumWorkers(pool) == w);
+
+    //accumulators must not share cache lines
+    if (w > 1)
+      assert((char*)poolAccumulator(pool, 1) - (char*)poolAccumulator(pool, 0) >= POOL_CACHE_LINE);
+    assert(((long)poolAccumulator(pool, 0) % POOL_CACHE_LINE) == 0);
+
+    assert(poolParallelFor(pool, 0, n, 1000, sumRange, NULL) == 0);
+    items = totalItems(pool, &sum);
+    printf ("%d workers: items %ld sum %ld\n", w, items, sum);
+    assert(items == n);
+    assert(sum == n * (n - 1) / 2);
+
+    //grain larger than the range runs a single chunk
+    resetPoolAccumulators(pool);
+    assert(poolParallelFor(pool, 5, 10, 100, sumRange, NULL) == 0);
+    items = totalItems(pool, &sum);
+    assert(items == 5 && sum == 5 + 6 + 7 + 8 + 9);
+
+    //nested submission from inside running jobs
+    resetPoolAccumulators(pool);
+    for (i = 0; i < 64; i++) {
+      spawnArgs[i].pool = pool;
+      poolSubmit(pool, spawnJob, &spawnArgs[i]);
+    }
+    poolWait(pool);
+    items = totalItems(pool, &sum);
+    assert(items == 64 + 64 * 100);
+
+    //parallel-for from inside jobs, even with a single worker
+    resetPoolAccumulators(pool);
+    for (i = 0; i < 8; i++) {
+      spawnArgs[i].pool = pool;
+      poolSubmit(pool, rangeJob, &spawnArgs[i]);
+    }
+    poolWait(pool);
+    items = totalItems(pool, &sum);
+    assert(items == 8 + 8 * 1000);
+    assert(sum == 8 * (1000 * 999 / 2));
+
+    //more external submissions than the shared queue holds
+    resetPoolAccumulators(pool);
+    for (i = 0; i < 20000; i++)
+      poolSubmit(pool, countJob, NULL);
+    poolWait(pool);
+    items = totalItems(pool, &sum);
+    assert(items == 20000);
+
+    freeThreadPool(pool);
+  }
+
+  printf ("ALL TESTS OK\n");
+
+  return 0;
+}
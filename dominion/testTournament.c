@@ -0,0 +1,91 @@
+#include "aggregator.h"
+#include "dominion.h"
+#include "simulate.h"
+#include "strategy.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#define SEEDS 60
+#define AGG_FILE "testTournament.agg"
+
+/* Runs sim's round robin of every registered strategy on seeds 1 to
+   SEEDS, in batches smaller than the run, and reads back its totals */
+static void runTournament(int threads, struct aggregator *agg) {
+  char command[256];
+
+  remove(AGG_FILE);
+  snprintf(command, sizeof(command),
+	   "./sim tournament -n %d -s 1 -t %d --batch 50 --streams shared --aggregate %s > /dev/null",
+	   SEEDS, threads, AGG_FILE);
+  assert(system(command) == 0);
+  assert(readAggregatorFile(AGG_FILE, agg) == 0);
+  remove(AGG_FILE);
+}
+
+static int sameAggregator(const struct aggregator *a, const struct aggregator *b) {
+  unsigned char *x = malloc(aggregatorSize());
+  unsigned char *y = malloc(aggregatorSize());
+  int same;
+
+  assert(x != NULL && y != NULL);
+  serializeAggregator(a, x, aggregatorSize());
+  serializeAggregator(b, y, aggregatorSize());
+  same = memcmp(x, y, aggregatorSize()) == 0;
+  free(x);
+  free(y);
+  return same;
+}
+
+int main () {
+  struct aggregator expected;
+  struct aggregator played;
+  struct gameState state;
+  struct gameResult result;
+  int kingdom[10];
+  int ids[2];
+  int threads[] = {1, 2, 4};
+  int a, b, seed, i;
+  //big_money, smithy_bm, adventurer_bm over the round robin below;
+  //update only for a deliberate change to the engine or the bots
+  long wins[] = {98, 66, 99};
+  long ties[] = {60, 61, 73};
+
+  printf ("Testing tournaments.\n");
+
+  //every ordered pair from both seats, played one game at a time
+  defaultKingdom(kingdom);
+  initAggregator(&expected);
+  for (a = 0; a < numStrategies(); a++)
+    for (b = 0; b < numStrategies(); b++) {
+      if (a == b)
+	continue;
+      ids[0] = a;
+      ids[1] = b;
+      for (seed = 1; seed <= SEEDS; seed++) {
+	assert(playGame(2, ids, kingdom, seed, RNG_SHARED, &state, &result) == 0);
+	aggregateGame(&expected, ids, &result);
+      }
+    }
+
+  assert(expected.games == (long)SEEDS * numStrategies() * (numStrategies() - 1));
+  for (i = 0; i < numStrategies(); i++) {
+    printf("%s: W %ld T %ld of %ld seats\n", getStrategy(i)->name,
+	   expected.wins[i], expected.ties[i], expected.seats[i]);
+    assert(expected.seats[i] == 2L * SEEDS * (numStrategies() - 1));
+    assert(expected.wins[i] == wins[i]);
+    assert(expected.ties[i] == ties[i]);
+  }
+
+  //the runner's totals are those games', whatever the thread count
+  for (i = 0; i < 3; i++) {
+    runTournament(threads[i], &played);
+    printf("%d threads: %ld games\n", threads[i], played.games);
+    assert(sameAggregator(&expected, &played));
+  }
+
+  printf ("ALL TESTS OK\n");
+
+  return 0;
+}
@@ -0,0 +1,515 @@
+#define _GNU_SOURCE
+#include "threadpool.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define QUEUE_SIZE 4096   /* shared submission queue, must be a power of 2 */
+#define DEQUE_SIZE 4096   /* per-worker deque, must be a power of 2 */
+#define SPIN_ROUNDS 128   /* empty polls before a worker goes to sleep */
+
+#define ALIGNED __attribute__((aligned(POOL_CACHE_LINE)))
+
+struct poolTask {
+  poolJobFn fn;
+  void *arg;
+};
+
+/* One slot of the bounded MPMC queue (Vyukov's sequence-number design) */
+struct queueCell {
+  long sequence;
+  poolJobFn fn;
+  void *arg;
+};
+
+/* Fixed-size Chase-Lev deque: the owner pushes and takes at bottom,
+   thieves steal from top.  top and bottom live on their own lines so the
+   owner's hot end never false-shares with thieves */
+struct poolWorker {
+  long top ALIGNED;
+  long bottom ALIGNED;
+  struct threadPool *pool ALIGNED;
+  int index;
+  unsigned int stealSeed;
+  pthread_t thread;
+  struct poolTask tasks[DEQUE_SIZE];
+};
+
+struct threadPool {
+  long enqueuePos ALIGNED;
+  long dequeuePos ALIGNED;
+  long pending ALIGNED;
+  int sleepers ALIGNED;
+  int shutdown;
+  int numWorkers;
+  size_t accumStride;
+  char *accum;
+  struct poolWorker *workers;
+  pthread_mutex_t lock;
+  pthread_cond_t wake;
+  pthread_cond_t done;
+  struct queueCell queue[QUEUE_SIZE];
+};
+
+static __thread struct poolWorker *currentWorker = NULL;
+
+int onlineCpuCount(void) {
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+  if (n < 1)
+    return 1;
+  if (n > POOL_MAX_WORKERS)
+    return POOL_MAX_WORKERS;
+  return (int)n;
+}
+
+static int queuePush(struct threadPool *pool, poolJobFn fn, void *arg) {
+  struct queueCell *cell;
+  long pos = __atomic_load_n(&pool->enqueuePos, __ATOMIC_RELAXED);
+  long seq;
+
+  for (;;) {
+    cell = &pool->queue[pos & (QUEUE_SIZE - 1)];
+    seq = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
+    if (seq == pos) {
+      if (__atomic_compare_exchange_n(&pool->enqueuePos, &pos, pos + 1, 1,
+				      __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+	break;
+    }
+    else if (seq < pos) {
+      return -1;  //full
+    }
+    else {
+      pos = __atomic_load_n(&pool->enqueuePos, __ATOMIC_RELAXED);
+    }
+  }
+
+  cell->fn = fn;
+  cell->arg = arg;
+  __atomic_store_n(&cell->sequence, pos + 1, __ATOMIC_RELEASE);
+  return 0;
+}
+
+static int queuePop(struct threadPool *pool, struct poolTask *task) {
+  struct queueCell *cell;
+  long pos = __atomic_load_n(&pool->dequeuePos, __ATOMIC_RELAXED);
+  long seq;
+
+  for (;;) {
+    cell = &pool->queue[pos & (QUEUE_SIZE - 1)];
+    seq = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
+    if (seq == pos + 1) {
+      if (__atomic_compare_exchange_n(&pool->dequeuePos, &pos, pos + 1, 1,
+				      __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+	break;
+    }
+    else if (seq < pos + 1) {
+      return -1;  //empty
+    }
+    else {
+      pos = __atomic_load_n(&pool->dequeuePos, __ATOMIC_RELAXED);
+    }
+  }
+
+  task->fn = cell->fn;
+  task->arg = cell->arg;
+  __atomic_store_n(&cell->sequence, pos + QUEUE_SIZE, __ATOMIC_RELEASE);
+  return 0;
+}
+
+static int dequePush(struct poolWorker *w, poolJobFn fn, void *arg) {
+  long b = __atomic_load_n(&w->bottom, __ATOMIC_RELAXED);
+  long t = __atomic_load_n(&w->top, __ATOMIC_ACQUIRE);
+  struct poolTask *slot;
+
+  if (b - t >= DEQUE_SIZE)
+    return -1;
+
+  slot = &w->tasks[b & (DEQUE_SIZE - 1)];
+  __atomic_store_n(&slot->fn, fn, __ATOMIC_RELAXED);
+  __atomic_store_n(&slot->arg, arg, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  __atomic_store_n(&w->bottom, b + 1, __ATOMIC_RELAXED);
+  return 0;
+}
+
+static int dequeTake(struct poolWorker *w, struct poolTask *task) {
+  long b = __atomic_load_n(&w->bottom, __ATOMIC_RELAXED) - 1;
+  long t;
+  int found = 0;
+
+  __atomic_store_n(&w->bottom, b, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  t = __atomic_load_n(&w->top, __ATOMIC_RELAXED);
+
+  if (t <= b) {
+    *task = w->tasks[b & (DEQUE_SIZE - 1)];
+    found = 1;
+    if (t == b) {
+      //last task: race the thieves for it
+      if (!__atomic_compare_exchange_n(&w->top, &t, t + 1, 0,
+				       __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+	found = 0;
+      __atomic_store_n(&w->bottom, b + 1, __ATOMIC_RELAXED);
+    }
+  }
+  else {
+    __atomic_store_n(&w->bottom, b + 1, __ATOMIC_RELAXED);
+  }
+
+  return found ? 0 : -1;
+}
+
+static int dequeSteal(struct poolWorker *w, struct poolTask *task) {
+  long t = __atomic_load_n(&w->top, __ATOMIC_ACQUIRE);
+  long b;
+  struct poolTask *slot;
+
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  b = __atomic_load_n(&w->bottom, __ATOMIC_ACQUIRE);
+  if (t >= b)
+    return -1;
+
+  slot = &w->tasks[t & (DEQUE_SIZE - 1)];
+  task->fn = __atomic_load_n(&slot->fn, __ATOMIC_RELAXED);
+  task->arg = __atomic_load_n(&slot->arg, __ATOMIC_RELAXED);
+  if (!__atomic_compare_exchange_n(&w->top, &t, t + 1, 0,
+				   __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+    return -1;
+  return 0;
+}
+
+static int workAvailable(struct threadPool *pool) {
+  int i;
+  struct poolWorker *w;
+
+  if (__atomic_load_n(&pool->enqueuePos, __ATOMIC_SEQ_CST) !=
+      __atomic_load_n(&pool->dequeuePos, __ATOMIC_SEQ_CST))
+    return 1;
+  for (i = 0; i < pool->numWorkers; i++) {
+    w = &pool->workers[i];
+    if (__atomic_load_n(&w->bottom, __ATOMIC_SEQ_CST) >
+	__atomic_load_n(&w->top, __ATOMIC_SEQ_CST))
+      return 1;
+  }
+  return 0;
+}
+
+static void wakeOne(struct threadPool *pool) {
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  if (__atomic_load_n(&pool->sleepers, __ATOMIC_SEQ_CST) > 0) {
+    pthread_mutex_lock(&pool->lock);
+    pthread_cond_signal(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+  }
+}
+
+static int findTask(struct poolWorker *self, struct poolTask *task) {
+  struct threadPool *pool = self->pool;
+  int n = pool->numWorkers;
+  int start;
+  int i;
+
+  if (dequeTake(self, task) == 0)
+    return 0;
+  if (queuePop(pool, task) == 0)
+    return 0;
+
+  //steal, starting from a pseudo-random victim to spread contention
+  self->stealSeed = self->stealSeed * 1103515245u + 12345u;
+  start = (int)((self->stealSeed >> 16) % (unsigned int)n);
+  for (i = 0; i < n; i++) {
+    struct poolWorker *victim = &pool->workers[(start + i) % n];
+    if (victim != self && dequeSteal(victim, task) == 0)
+      return 0;
+  }
+  return -1;
+}
+
+static void runTask(struct poolWorker *self, struct poolTask *task) {
+  struct threadPool *pool = self->pool;
+
+  task->fn(task->arg, self->index, poolAccumulator(pool, self->index));
+
+  if (__atomic_sub_fetch(&pool->pending, 1, __ATOMIC_ACQ_REL) == 0) {
+    pthread_mutex_lock(&pool->lock);
+    pthread_cond_broadcast(&pool->done);
+    pthread_mutex_unlock(&pool->lock);
+  }
+}
+
+static void* workerMain(void *arg) {
+  struct poolWorker *self = arg;
+  struct threadPool *pool = self->pool;
+  struct poolTask task;
+  int idle = 0;
+  int stop;
+
+  currentWorker = self;
+
+  for (;;) {
+    if (findTask(self, &task) == 0) {
+      runTask(self, &task);
+      idle = 0;
+      continue;
+    }
+
+    if (++idle < SPIN_ROUNDS) {
+      sched_yield();
+      continue;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    __atomic_add_fetch(&pool->sleepers, 1, __ATOMIC_SEQ_CST);
+    while (!pool->shutdown && !workAvailable(pool))
+      pthread_cond_wait(&pool->wake, &pool->lock);
+    __atomic_sub_fetch(&pool->sleepers, 1, __ATOMIC_SEQ_CST);
+    stop = pool->shutdown && !workAvailable(pool);
+    pthread_mutex_unlock(&pool->lock);
+
+    if (stop)
+      break;
+    idle = 0;
+  }
+
+  currentWorker = NULL;
+  return NULL;
+}
+
+struct threadPool* newThreadPool(int numWorkers, size_t accumSize) {
+  struct threadPool *pool;
+  void *mem;
+  int i;
+
+  if (numWorkers < 1)
+    numWorkers = onlineCpuCount();
+  if (numWorkers > POOL_MAX_WORKERS)
+    numWorkers = POOL_MAX_WORKERS;
+
+  if (posix_memalign(&mem, POOL_CACHE_LINE, sizeof(struct threadPool)) != 0)
+    return NULL;
+  pool = mem;
+  memset(pool, 0, sizeof(struct threadPool));
+
+  pool->numWorkers = numWorkers;
+  pool->accumStride = (accumSize + POOL_CACHE_LINE - 1) & ~(size_t)(POOL_CACHE_LINE - 1);
+  if (pool->accumStride == 0)
+    pool->accumStride = POOL_CACHE_LINE;
+
+  for (i = 0; i < QUEUE_SIZE; i++)
+    pool->queue[i].sequence = i;
+
+  if (posix_memalign(&mem, POOL_CACHE_LINE, pool->accumStride * numWorkers) != 0) {
+    free(pool);
+    return NULL;
+  }
+  pool->accum = mem;
+  memset(pool->accum, 0, pool->accumStride * numWorkers);
+
+  if (posix_memalign(&mem, POOL_CACHE_LINE, sizeof(struct poolWorker) * numWorkers) != 0) {
+    free(pool->accum);
+    free(pool);
+    return NULL;
+  }
+  pool->workers = mem;
+  memset(pool->workers, 0, sizeof(struct poolWorker) * numWorkers);
+
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->wake, NULL);
+  pthread_cond_init(&pool->done, NULL);
+
+  for (i = 0; i < numWorkers; i++) {
+    pool->workers[i].pool = pool;
+    pool->workers[i].index = i;
+    pool->workers[i].stealSeed = 2654435761u * (unsigned int)(i + 1);
+  }
+  for (i = 0; i < numWorkers; i++) {
+    if (pthread_create(&pool->workers[i].thread, NULL, workerMain,
+		       &pool->workers[i]) != 0) {
+      //run with the workers we managed to start
+      pool->numWorkers = i;
+      break;
+    }
+  }
+
+  if (pool->numWorkers == 0) {
+    freeThreadPool(pool);
+    return NULL;
+  }
+
+  return pool;
+}
+
+int poolSubmit(struct threadPool *pool, poolJobFn fn, void *arg) {
+  struct poolWorker *self = currentWorker;
+  struct poolTask task;
+
+  if (pool == NULL || fn == NULL)
+    return -1;
+
+  __atomic_add_fetch(&pool->pending, 1, __ATOMIC_ACQ_REL);
+
+  if (self != NULL && self->pool == pool && dequePush(self, fn, arg) == 0) {
+    wakeOne(pool);
+    return 0;
+  }
+
+  while (queuePush(pool, fn, arg) < 0) {
+    //queue is full: a worker helps drain it, anyone else backs off
+    if (self != NULL && self->pool == pool && findTask(self, &task) == 0)
+      runTask(self, &task);
+    else
+      sched_yield();
+  }
+  wakeOne(pool);
+
+  return 0;
+}
+
+void poolWait(struct threadPool *pool) {
+  pthread_mutex_lock(&pool->lock);
+  while (__atomic_load_n(&pool->pending, __ATOMIC_ACQUIRE) > 0)
+    pthread_cond_wait(&pool->done, &pool->lock);
+  pthread_mutex_unlock(&pool->lock);
+}
+
+struct rangeJob;
+
+struct rangeBatch {
+  struct threadPool *pool;
+  poolRangeFn fn;
+  void *ctx;
+  long grain;
+  long nextJob;
+  long remaining;               /* items not yet processed */
+  struct rangeJob *jobs;
+};
+
+struct rangeJob {
+  struct rangeBatch *batch;
+  long lo;
+  long hi;
+};
+
+static void runRange(void *arg, int worker, void *accum) {
+  struct rangeJob *job = arg;
+  struct rangeBatch *batch = job->batch;
+  long lo = job->lo;
+  long hi = job->hi;
+  long chunks;
+  long mid;
+  struct rangeJob *half;
+  struct threadPool *pool;
+
+  //keep the lower half, expose the upper half to thieves
+  while (hi - lo > batch->grain) {
+    chunks = (hi - lo + batch->grain - 1) / batch->grain;
+    mid = lo + (chunks / 2) * batch->grain;
+    half = &batch->jobs[__atomic_fetch_add(&batch->nextJob, 1, __ATOMIC_RELAXED)];
+    half->batch = batch;
+    half->lo = mid;
+    half->hi = hi;
+    poolSubmit(batch->pool, runRange, half);
+    hi = mid;
+  }
+
+  batch->fn(lo, hi, worker, accum, batch->ctx);
+
+  //the batch lives on the waiter's stack: touch only the pool after this
+  pool = batch->pool;
+  if (__atomic_sub_fetch(&batch->remaining, hi - lo, __ATOMIC_ACQ_REL) == 0) {
+    pthread_mutex_lock(&pool->lock);
+    pthread_cond_broadcast(&pool->done);
+    pthread_mutex_unlock(&pool->lock);
+  }
+}
+
+int poolParallelFor(struct threadPool *pool, long begin, long end,
+		    long grain, poolRangeFn fn, void *ctx) {
+  struct rangeBatch batch;
+  struct poolWorker *self = currentWorker;
+  struct poolTask task;
+  long chunks;
+
+  if (pool == NULL || fn == NULL || end < begin)
+    return -1;
+  if (end == begin)
+    return 0;
+  if (grain < 1)
+    grain = 1;
+
+  chunks = (end - begin + grain - 1) / grain;
+  batch.pool = pool;
+  batch.fn = fn;
+  batch.ctx = ctx;
+  batch.grain = grain;
+  batch.nextJob = 1;
+  batch.remaining = end - begin;
+  batch.jobs = malloc(sizeof(struct rangeJob) * (chunks + 1));
+  if (batch.jobs == NULL)
+    return -1;
+
+  batch.jobs[0].batch = &batch;
+  batch.jobs[0].lo = begin;
+  batch.jobs[0].hi = end;
+  poolSubmit(pool, runRange, &batch.jobs[0]);
+
+  //wait for this batch only; a worker of the pool runs tasks meanwhile,
+  //as sleeping would deadlock a pool it is the only worker of
+  if (self != NULL && self->pool == pool) {
+    while (__atomic_load_n(&batch.remaining, __ATOMIC_ACQUIRE) > 0) {
+      if (findTask(self, &task) == 0)
+	runTask(self, &task);
+      else
+	sched_yield();
+    }
+  }
+  else {
+    pthread_mutex_lock(&pool->lock);
+    while (__atomic_load_n(&batch.remaining, __ATOMIC_ACQUIRE) > 0)
+      pthread_cond_wait(&pool->done, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+  }
+
+  free(batch.jobs);
+  return 0;
+}
+
+int poolNumWorkers(struct threadPool *pool) {
+  return pool->numWorkers;
+}
+
+void* poolAccumulator(struct threadPool *pool, int worker) {
+  if (worker < 0 || worker >= pool->numWorkers)
+    return NULL;
+  return pool->accum + pool->accumStride * worker;
+}
+
+void resetPoolAccumulators(struct threadPool *pool) {
+  memset(pool->accum, 0, pool->accumStride * pool->numWorkers);
+}
+
+void freeThreadPool(struct threadPool *pool) {
+  int i;
+
+  if (pool == NULL)
+    return;
+
+  poolWait(pool);
+
+  pthread_mutex_lock(&pool->lock);
+  pool->shutdown = 1;
+  pthread_cond_broadcast(&pool->wake);
+  pthread_mutex_unlock(&pool->lock);
+
+  for (i = 0; i < pool->numWorkers; i++)
+    pthread_join(pool->workers[i].thread, NULL);
+
+  pthread_mutex_destroy(&pool->lock);
+  pthread_cond_destroy(&pool->wake);
+  pthread_cond_destroy(&pool->done);
+  free(pool->workers);
+  free(pool->accum);
+  free(pool);
+}
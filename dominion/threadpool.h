@@ -0,0 +1,58 @@
+#ifndef _THREADPOOL_H
+#define _THREADPOOL_H
+
+/* Work-stealing thread pool for simulation jobs.
+
+   Jobs submitted from outside the pool go through a lock-free bounded
+   MPMC queue; jobs submitted from inside a running job go to that
+   worker's own deque.  Idle workers pop their own deque, then the
+   shared queue, then steal from the other workers' deques. */
+
+#include <stddef.h>
+
+#define POOL_CACHE_LINE 64
+#define POOL_MAX_WORKERS 256
+
+typedef void (*poolJobFn)(void *arg, int worker, void *accum);
+/* worker is the 0-based index of the thread running the job, accum is
+   that worker's accumulator block (see newThreadPool) */
+
+typedef void (*poolRangeFn)(long lo, long hi, int worker, void *accum,
+			    void *ctx);
+/* Process items [lo, hi) */
+
+struct threadPool;
+
+struct threadPool* newThreadPool(int numWorkers, size_t accumSize);
+/* numWorkers < 1 means one worker per online CPU.  Every worker gets a
+   zeroed, cache-line-aligned accumulator block of accumSize bytes.
+   Returns NULL on failure */
+
+int poolSubmit(struct threadPool *pool, poolJobFn fn, void *arg);
+/* Queue a job; safe from any thread, including from inside a job */
+
+void poolWait(struct threadPool *pool);
+/* Block until every submitted job has finished.  Must not be called
+   from inside a job */
+
+int poolParallelFor(struct threadPool *pool, long begin, long end,
+		    long grain, poolRangeFn fn, void *ctx);
+/* Run fn over [begin, end) in chunks of at most grain items and wait
+   for all of them, but not for other jobs in the pool.  Ranges are
+   split lazily, so idle workers steal large halves instead of
+   contending on one counter.  May be called from inside a job, whose
+   worker then runs queued jobs until the range is done */
+
+int poolNumWorkers(struct threadPool *pool);
+
+void* poolAccumulator(struct threadPool *pool, int worker);
+
+void resetPoolAccumulators(struct threadPool *pool);
+/* Zero every worker's accumulator block; only valid while idle */
+
+void freeThreadPool(struct threadPool *pool);
+/* Waits for outstanding jobs, then joins the workers */
+
+int onlineCpuCount(void);
+
+#endif